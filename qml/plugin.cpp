@@ -15,13 +15,26 @@
  */
 
 #include "plugin.h"
+#include "batchwriterequest.h"
+#include "catalogmirror.h"
+#include "circuitbreaker.h"
 #include "countriesmodel.h"
+#include "endpointselector.h"
+#include "favourites.h"
 #include "genresmodel.h"
 #include "languagesmodel.h"
+#include "pagesrequest.h"
+#include "playedstationsjournal.h"
+#include "playlistresolver.h"
+#include "ratelimiter.h"
 #include "resourcesmodel.h"
 #include "resourcesrequest.h"
 #include "searchesmodel.h"
+#include "searchsuggestionsmodel.h"
+#include "stationfiltermodel.h"
+#include "stationsearchmodel.h"
 #include "stationsmodel.h"
+#include "streamprober.h"
 #if QT_VERSION >= 0x050000
 #include <qqml.h>
 #else
@@ -33,24 +46,50 @@ namespace CuteRadio {
 void Plugin::registerTypes(const char *uri) {
     Q_ASSERT(uri == QLatin1String("CuteRadio"));
     
+    qmlRegisterType<BatchWriteRequest>(uri, 1, 0, "BatchWriteRequest");
+    qmlRegisterType<CatalogMirror>(uri, 1, 0, "CatalogMirror");
+    qmlRegisterType<CircuitBreaker>(uri, 1, 0, "CircuitBreaker");
     qmlRegisterType<CountriesModel>(uri, 1, 0, "CountriesModel");
+    qmlRegisterType<EndpointSelector>(uri, 1, 0, "EndpointSelector");
+    qmlRegisterType<Favourites>(uri, 1, 0, "Favourites");
     qmlRegisterType<GenresModel>(uri, 1, 0, "GenresModel");
     qmlRegisterType<LanguagesModel>(uri, 1, 0, "LanguagesModel");
+    qmlRegisterType<PagesRequest>(uri, 1, 0, "PagesRequest");
+    qmlRegisterType<PlayedStationsJournal>(uri, 1, 0, "PlayedStationsJournal");
+    qmlRegisterType<PlaylistResolver>(uri, 1, 0, "PlaylistResolver");
+    qmlRegisterType<RateLimiter>(uri, 1, 0, "RateLimiter");
     qmlRegisterType<ResourcesModel>(uri, 1, 0, "ResourcesModel");
     qmlRegisterType<ResourcesRequest>(uri, 1, 0, "ResourcesRequest");
     qmlRegisterType<SearchesModel>(uri, 1, 0, "SearchesModel");
+    qmlRegisterType<SearchSuggestionsModel>(uri, 1, 0, "SearchSuggestionsModel");
+    qmlRegisterType<StationFilterModel>(uri, 1, 0, "StationFilterModel");
+    qmlRegisterType<StationSearchModel>(uri, 1, 0, "StationSearchModel");
     qmlRegisterType<StationsModel>(uri, 1, 0, "StationsModel");
+    qmlRegisterType<StreamProber>(uri, 1, 0, "StreamProber");
 }
 
 }
 
+QML_DECLARE_TYPE(CuteRadio::BatchWriteRequest)
+QML_DECLARE_TYPE(CuteRadio::CatalogMirror)
+QML_DECLARE_TYPE(CuteRadio::CircuitBreaker)
 QML_DECLARE_TYPE(CuteRadio::CountriesModel)
+QML_DECLARE_TYPE(CuteRadio::EndpointSelector)
+QML_DECLARE_TYPE(CuteRadio::Favourites)
 QML_DECLARE_TYPE(CuteRadio::GenresModel)
 QML_DECLARE_TYPE(CuteRadio::LanguagesModel)
+QML_DECLARE_TYPE(CuteRadio::PagesRequest)
+QML_DECLARE_TYPE(CuteRadio::PlayedStationsJournal)
+QML_DECLARE_TYPE(CuteRadio::PlaylistResolver)
+QML_DECLARE_TYPE(CuteRadio::RateLimiter)
 QML_DECLARE_TYPE(CuteRadio::ResourcesModel)
 QML_DECLARE_TYPE(CuteRadio::ResourcesRequest)
 QML_DECLARE_TYPE(CuteRadio::SearchesModel)
+QML_DECLARE_TYPE(CuteRadio::SearchSuggestionsModel)
+QML_DECLARE_TYPE(CuteRadio::StationFilterModel)
+QML_DECLARE_TYPE(CuteRadio::StationSearchModel)
 QML_DECLARE_TYPE(CuteRadio::StationsModel)
+QML_DECLARE_TYPE(CuteRadio::StreamProber)
 #if QT_VERSION < 0x050000
 Q_EXPORT_PLUGIN2(cuteradioplugin, CuteRadio::Plugin)
 #endif
@@ -0,0 +1,515 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batchwriterequest.h"
+#include "batchwriterequest_p.h"
+#include "resourcesrequest.h"
+#ifdef CUTERADIO_DEBUG
+#include <QDebug>
+#endif
+
+namespace CuteRadio {
+
+static const int DEFAULT_CONCURRENT_WRITES = 4;
+
+static QString normalizedPath(const QString &resourcePath) {
+    QString path = resourcePath.startsWith('/') ? resourcePath : "/" + resourcePath;
+    
+    while ((path.size() > 1) && (path.endsWith('/'))) {
+        path.chop(1);
+    }
+    
+    return path;
+}
+
+/*!
+    \class BatchWriteRequest
+    \brief Writes many cuteRadio resources concurrently.
+    
+    \ingroup requests
+    
+    BatchWriteRequest is used for bulk changes, such as importing favourites or editing several stations. Writes 
+    are added with insert(), update() and del(), and sent when start() is called. Up to maximumConcurrentWrites 
+    writes are in progress at once, each using its own ResourcesRequest.
+    
+    Writes are only ordered where they conflict. Updates and deletions of the same resource path are sent one at 
+    a time, in the order they were added. An insert conflicts with writes to the resource it creates, which is 
+    the resource path followed by the "id" or "stationId" property of the resource, if it has one. All other 
+    writes may finish in any order.
+    
+    A failed write does not stop the others. itemFinished() is emitted as each write finishes, and finished() 
+    when all have finished. The status is then Ready if every write succeeded, or Failed otherwise, and the result 
+    of each write is available from itemResult().
+    
+    Example usage:
+    
+    \code
+    using namespace CuteRadio;
+    
+    ...
+    
+    BatchWriteRequest *request = new BatchWriteRequest(this);
+    request->setAccessToken(USER_ACCESS_TOKEN);
+    connect(request, SIGNAL(finished(CuteRadio::BatchWriteRequest*)),
+            this, SLOT(onImportFinished(CuteRadio::BatchWriteRequest*)));
+    
+    foreach (const QString &id, stationIds) {
+        QVariantMap favourite;
+        favourite["stationId"] = id;
+        request->insert(favourite, "/favourites");
+    }
+    
+    request->start();
+    \endcode
+*/
+BatchWriteRequest::BatchWriteRequest(QObject *parent) :
+    QObject(parent),
+    d_ptr(new BatchWriteRequestPrivate(this))
+{
+}
+
+BatchWriteRequest::~BatchWriteRequest() {
+    Q_D(BatchWriteRequest);
+    
+    d->abortWrites();
+}
+
+/*!
+    \property QString BatchWriteRequest::accessToken
+    \brief The access token used when making requests to the cuteRadio Data API.
+*/
+
+/*!
+    \fn void BatchWriteRequest::accessTokenChanged()
+    \brief Emitted when the accessToken changes.
+*/
+QString BatchWriteRequest::accessToken() const {
+    Q_D(const BatchWriteRequest);
+    
+    return d->accessToken;
+}
+
+void BatchWriteRequest::setAccessToken(const QString &token) {
+    Q_D(BatchWriteRequest);
+    
+    if (token != d->accessToken) {
+        d->accessToken = token;
+        emit accessTokenChanged();
+    }
+}
+
+/*!
+    \property int BatchWriteRequest::maximumConcurrentWrites
+    \brief The maximum number of writes that are in progress at the same time.
+    
+    The default value is 4.
+*/
+
+/*!
+    \fn void BatchWriteRequest::maximumConcurrentWritesChanged()
+    \brief Emitted when the maximumConcurrentWrites changes.
+*/
+int BatchWriteRequest::maximumConcurrentWrites() const {
+    Q_D(const BatchWriteRequest);
+    
+    return d->maxConcurrent;
+}
+
+void BatchWriteRequest::setMaximumConcurrentWrites(int writes) {
+    Q_D(BatchWriteRequest);
+    
+    writes = qMax(1, writes);
+    
+    if (writes != d->maxConcurrent) {
+        d->maxConcurrent = writes;
+        
+        if (d->status == Request::Loading) {
+            d->startWrites();
+        }
+        
+        emit maximumConcurrentWritesChanged();
+    }
+}
+
+/*!
+    \property int BatchWriteRequest::count
+    \brief The number of writes that have been added.
+*/
+int BatchWriteRequest::count() const {
+    Q_D(const BatchWriteRequest);
+    
+    return d->writes.size();
+}
+
+/*!
+    \property int BatchWriteRequest::finishedCount
+    \brief The number of writes that have finished, successfully or not.
+*/
+int BatchWriteRequest::finishedCount() const {
+    Q_D(const BatchWriteRequest);
+    
+    return d->finished;
+}
+
+/*!
+    \property int BatchWriteRequest::failedCount
+    \brief The number of writes that have failed.
+*/
+int BatchWriteRequest::failedCount() const {
+    Q_D(const BatchWriteRequest);
+    
+    return d->failed;
+}
+
+/*!
+    \property enum BatchWriteRequest::status
+    \brief The status of the batch.
+    
+    \sa Request::status
+*/
+Request::Status BatchWriteRequest::status() const {
+    Q_D(const BatchWriteRequest);
+    
+    return d->status;
+}
+
+/*!
+    \brief Sets the QNetworkAccessManager instance to be used by each write.
+    
+    BatchWriteRequest does not take ownership of \a manager.
+*/
+void BatchWriteRequest::setNetworkAccessManager(QNetworkAccessManager *manager) {
+    Q_D(BatchWriteRequest);
+    
+    d->manager = manager;
+}
+
+/*!
+    \brief Adds a write that inserts \a resource into \a resourcePath, and returns its item number.
+    
+    \sa ResourcesRequest::insert()
+*/
+int BatchWriteRequest::insert(const QVariantMap &resource, const QString &resourcePath) {
+    Q_D(BatchWriteRequest);
+    
+    return d->add(Request::PostOperation, resourcePath, resource);
+}
+
+/*!
+    \brief Adds a write that updates the resource at \a resourcePath, and returns its item number.
+    
+    \sa ResourcesRequest::update()
+*/
+int BatchWriteRequest::update(const QString &resourcePath, const QVariantMap &resource) {
+    Q_D(BatchWriteRequest);
+    
+    return d->add(Request::PutOperation, resourcePath, resource);
+}
+
+/*!
+    \brief Adds a write that deletes the resource at \a resourcePath, and returns its item number.
+    
+    \sa ResourcesRequest::del()
+*/
+int BatchWriteRequest::del(const QString &resourcePath) {
+    Q_D(BatchWriteRequest);
+    
+    return d->add(Request::DeleteOperation, resourcePath, QVariantMap());
+}
+
+/*!
+    \brief Returns the result of the write with number \a item.
+    
+    The map contains the operation, resourcePath, status, error, errorString and result of the write.
+*/
+QVariantMap BatchWriteRequest::itemResult(int item) const {
+    Q_D(const BatchWriteRequest);
+    
+    QVariantMap map;
+    
+    if ((item < 0) || (item >= d->writes.size())) {
+        return map;
+    }
+    
+    const BatchWrite &write = d->writes.at(item);
+    map["operation"] = int(write.operation);
+    map["resourcePath"] = write.resourcePath;
+    map["status"] = int(write.status);
+    map["error"] = int(write.error);
+    map["errorString"] = write.errorString;
+    map["result"] = write.result;
+    return map;
+}
+
+/*!
+    \brief Returns the results of all writes, in the order they were added.
+    
+    \sa itemResult()
+*/
+QVariantList BatchWriteRequest::results() const {
+    QVariantList list;
+    
+    for (int i = 0; i < count(); i++) {
+        list << itemResult(i);
+    }
+    
+    return list;
+}
+
+/*!
+    \brief Starts sending the writes that have been added.
+    
+    Writes that are added while the batch is in progress are sent as well.
+*/
+void BatchWriteRequest::start() {
+    Q_D(BatchWriteRequest);
+    
+    if (d->status == Request::Loading) {
+        return;
+    }
+    
+    if (d->queue.isEmpty()) {
+        d->setStatus(d->failed > 0 ? Request::Failed : Request::Ready);
+        emit finished(this);
+        return;
+    }
+    
+    d->setStatus(Request::Loading);
+    d->startWrites();
+}
+
+/*!
+    \brief Cancels the writes that are in progress or have not been sent.
+    
+    Writes that are in progress may still be applied by the server.
+*/
+void BatchWriteRequest::cancel() {
+    Q_D(BatchWriteRequest);
+    
+    if (d->status == Request::Loading) {
+        d->abortWrites();
+        d->setStatus(Request::Canceled);
+        emit progressChanged();
+        emit finished(this);
+    }
+}
+
+/*!
+    \brief Cancels any writes in progress and removes all writes.
+*/
+void BatchWriteRequest::clear() {
+    Q_D(BatchWriteRequest);
+    
+    d->abortWrites();
+    d->writes.clear();
+    d->finished = 0;
+    d->failed = 0;
+    d->setStatus(Request::Null);
+    emit countChanged(0);
+    emit progressChanged();
+}
+
+/*!
+    \fn void BatchWriteRequest::itemFinished(int item, CuteRadio::Request::Status status)
+    \brief Emitted when the write with number \a item has finished.
+*/
+
+/*!
+    \fn void BatchWriteRequest::finished(CuteRadio::BatchWriteRequest *request)
+    \brief Emitted when all writes have finished, or the batch is canceled.
+*/
+
+BatchWriteRequestPrivate::BatchWriteRequestPrivate(BatchWriteRequest *parent) :
+    q_ptr(parent),
+    manager(0),
+    maxConcurrent(DEFAULT_CONCURRENT_WRITES),
+    finished(0),
+    failed(0),
+    status(Request::Null)
+{
+}
+
+int BatchWriteRequestPrivate::add(Request::Operation operation, const QString &resourcePath,
+                                  const QVariantMap &resource) {
+    Q_Q(BatchWriteRequest);
+    
+    BatchWrite write;
+    write.operation = operation;
+    write.resourcePath = resourcePath;
+    write.resource = resource;
+    write.status = Request::Null;
+    write.error = Request::NoError;
+    
+    if (operation == Request::PostOperation) {
+        const QString id = resource.contains("id") ? resource.value("id").toString()
+                                                   : resource.value("stationId").toString();
+        
+        if (!id.isEmpty()) {
+            write.key = normalizedPath(resourcePath) + "/" + id;
+        }
+    }
+    else {
+        write.key = normalizedPath(resourcePath);
+    }
+    
+    const int item = writes.size();
+    writes << write;
+    queue << item;
+    emit q->countChanged(writes.size());
+    
+    if (status == Request::Loading) {
+        startWrites();
+    }
+    
+    return item;
+}
+
+void BatchWriteRequestPrivate::setStatus(Request::Status s) {
+    if (s != status) {
+        Q_Q(BatchWriteRequest);
+        status = s;
+        emit q->statusChanged(s);
+    }
+}
+
+/*!
+    \internal
+    \brief Sends queued writes until maxConcurrent writes are in progress.
+    
+    A write is skipped while an earlier write with the same key is in progress or still queued, so conflicting 
+    writes are sent in order.
+*/
+void BatchWriteRequestPrivate::startWrites() {
+    Q_Q(BatchWriteRequest);
+    
+    QSet<QString> blocked = activeKeys;
+    int i = 0;
+    
+    while ((active.size() < maxConcurrent) && (i < queue.size())) {
+        const int item = queue.at(i);
+        BatchWrite &write = writes[item];
+        
+        if (!write.key.isEmpty()) {
+            if (blocked.contains(write.key)) {
+                i++;
+                continue;
+            }
+            
+            blocked.insert(write.key);
+            activeKeys.insert(write.key);
+        }
+        
+        queue.removeAt(i);
+        
+        ResourcesRequest *request = new ResourcesRequest(q);
+        request->setAccessToken(accessToken);
+        
+        if (manager) {
+            request->setNetworkAccessManager(manager);
+        }
+        
+        BatchWriteRequest::connect(request, SIGNAL(finished(CuteRadio::Request*)),
+                                   q, SLOT(_q_onWriteFinished(CuteRadio::Request*)));
+        active.insert(request, item);
+        write.status = Request::Loading;
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::BatchWriteRequestPrivate::startWrites" << item << write.operation
+                 << write.resourcePath;
+#endif
+        switch (write.operation) {
+        case Request::PostOperation:
+            request->insert(write.resource, write.resourcePath);
+            break;
+        case Request::PutOperation:
+            request->update(write.resourcePath, write.resource);
+            break;
+        default:
+            request->del(write.resourcePath);
+            break;
+        }
+    }
+}
+
+/*!
+    \internal
+    \brief Cancels writes in progress and marks them, and any queued writes, as canceled.
+*/
+void BatchWriteRequestPrivate::abortWrites() {
+    QHashIterator<ResourcesRequest*, int> iterator(active);
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        ResourcesRequest *request = iterator.key();
+        request->disconnect(q_ptr);
+        request->cancel();
+        request->deleteLater();
+        writes[iterator.value()].status = Request::Canceled;
+        finished++;
+    }
+    
+    foreach (int item, queue) {
+        writes[item].status = Request::Canceled;
+        finished++;
+    }
+    
+    active.clear();
+    activeKeys.clear();
+    queue.clear();
+}
+
+void BatchWriteRequestPrivate::_q_onWriteFinished(Request *request) {
+    Q_Q(BatchWriteRequest);
+    
+    ResourcesRequest *r = static_cast<ResourcesRequest*>(request);
+    
+    if (!active.contains(r)) {
+        return;
+    }
+    
+    const int item = active.take(r);
+    BatchWrite &write = writes[item];
+    activeKeys.remove(write.key);
+    write.status = r->status();
+    write.error = r->error();
+    write.errorString = r->errorString();
+    write.result = r->result();
+    write.resource.clear();
+    r->deleteLater();
+    finished++;
+    
+    if (write.status != Request::Ready) {
+        failed++;
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::BatchWriteRequestPrivate::_q_onWriteFinished: Write failed" << item
+                 << write.resourcePath << write.errorString;
+#endif
+    }
+    
+    emit q->itemFinished(item, write.status);
+    emit q->progressChanged();
+    
+    if ((queue.isEmpty()) && (active.isEmpty())) {
+        setStatus(failed > 0 ? Request::Failed : Request::Ready);
+        emit q->finished(q);
+    }
+    else {
+        startWrites();
+    }
+}
+
+}
+
+#include "moc_batchwriterequest.cpp"
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_BATCHWRITEREQUEST_H
+#define CUTERADIO_BATCHWRITEREQUEST_H
+
+#include "request.h"
+
+namespace CuteRadio {
+
+class BatchWriteRequestPrivate;
+
+class CUTERADIOSHARED_EXPORT BatchWriteRequest : public QObject
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(QString accessToken READ accessToken WRITE setAccessToken NOTIFY accessTokenChanged)
+    Q_PROPERTY(int maximumConcurrentWrites READ maximumConcurrentWrites WRITE setMaximumConcurrentWrites
+               NOTIFY maximumConcurrentWritesChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(int finishedCount READ finishedCount NOTIFY progressChanged)
+    Q_PROPERTY(int failedCount READ failedCount NOTIFY progressChanged)
+    Q_PROPERTY(CuteRadio::Request::Status status READ status NOTIFY statusChanged)
+    
+public:
+    explicit BatchWriteRequest(QObject *parent = 0);
+    ~BatchWriteRequest();
+    
+    QString accessToken() const;
+    void setAccessToken(const QString &token);
+    
+    int maximumConcurrentWrites() const;
+    void setMaximumConcurrentWrites(int writes);
+    
+    int count() const;
+    int finishedCount() const;
+    int failedCount() const;
+    
+    Request::Status status() const;
+    
+    void setNetworkAccessManager(QNetworkAccessManager *manager);
+    
+    Q_INVOKABLE int insert(const QVariantMap &resource, const QString &resourcePath);
+    Q_INVOKABLE int update(const QString &resourcePath, const QVariantMap &resource);
+    Q_INVOKABLE int del(const QString &resourcePath);
+    
+    Q_INVOKABLE QVariantMap itemResult(int item) const;
+    Q_INVOKABLE QVariantList results() const;
+    
+public Q_SLOTS:
+    void start();
+    void cancel();
+    void clear();
+    
+Q_SIGNALS:
+    void accessTokenChanged();
+    void maximumConcurrentWritesChanged();
+    void countChanged(int count);
+    void progressChanged();
+    void statusChanged(CuteRadio::Request::Status s);
+    void itemFinished(int item, CuteRadio::Request::Status status);
+    void finished(CuteRadio::BatchWriteRequest *request);
+    
+protected:
+    QScopedPointer<BatchWriteRequestPrivate> d_ptr;
+    
+    Q_DECLARE_PRIVATE(BatchWriteRequest)
+    
+    Q_PRIVATE_SLOT(d_func(), void _q_onWriteFinished(CuteRadio::Request*))
+    
+private:
+    Q_DISABLE_COPY(BatchWriteRequest)
+};
+
+}
+
+#endif // CUTERADIO_BATCHWRITEREQUEST_H
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_BATCHWRITEREQUEST_P_H
+#define CUTERADIO_BATCHWRITEREQUEST_P_H
+
+#include "batchwriterequest.h"
+#include <QHash>
+#include <QSet>
+#include <QVariantMap>
+
+namespace CuteRadio {
+
+class ResourcesRequest;
+
+/*!
+    \internal
+    \brief One write in a BatchWriteRequest, and its result once it has finished.
+    
+    Writes with the same non-empty key are sent one at a time, in the order they were added.
+*/
+class BatchWrite
+{
+
+public:
+    Request::Operation operation;
+    QString resourcePath;
+    QVariantMap resource;
+    QString key;
+    
+    Request::Status status;
+    Request::Error error;
+    QString errorString;
+    QVariant result;
+};
+
+class BatchWriteRequestPrivate
+{
+
+public:
+    BatchWriteRequestPrivate(BatchWriteRequest *parent);
+    
+    int add(Request::Operation operation, const QString &resourcePath, const QVariantMap &resource);
+    
+    void setStatus(Request::Status s);
+    
+    void startWrites();
+    
+    void abortWrites();
+    
+    void _q_onWriteFinished(Request *request);
+    
+    BatchWriteRequest *q_ptr;
+    
+    QNetworkAccessManager *manager;
+    
+    QString accessToken;
+    
+    int maxConcurrent;
+    
+    QList<BatchWrite> writes;
+    
+    QList<int> queue;
+    
+    QHash<ResourcesRequest*, int> active;
+    QSet<QString> activeKeys;
+    
+    int finished;
+    int failed;
+    
+    Request::Status status;
+    
+    Q_DECLARE_PUBLIC(BatchWriteRequest)
+};
+
+}
+
+#endif // CUTERADIO_BATCHWRITEREQUEST_P_H
@@ -0,0 +1,699 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catalogmirror.h"
+#include "catalogmirror_p.h"
+#include "json.h"
+#include "resourcesrequest.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSqlError>
+#include <QSqlQuery>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#endif
+#ifdef CUTERADIO_DEBUG
+#include <QDebug>
+#endif
+
+namespace CuteRadio {
+
+static const int SYNC_PAGE_LIMIT = 100;
+static const int DEFAULT_QUERY_LIMIT = 20;
+
+static const char *FACET_RESOURCES[] = { "genres", "countries", "languages" };
+static const char *STATION_FACETS[] = { "genre", "country", "language" };
+static const char *STATION_SORT_COLUMNS[] = { "title", "genre", "country", "language", "playCount", "lastPlayed",
+                                              "id" };
+
+static const char *SCHEMA[] = {
+    "CREATE TABLE IF NOT EXISTS stations (id TEXT PRIMARY KEY, title TEXT, description TEXT, genre TEXT, "
+    "country TEXT, language TEXT, playCount INTEGER, lastPlayed TEXT, data TEXT)",
+    "CREATE INDEX IF NOT EXISTS stations_genre ON stations (genre)",
+    "CREATE INDEX IF NOT EXISTS stations_country ON stations (country)",
+    "CREATE INDEX IF NOT EXISTS stations_language ON stations (language)",
+    "CREATE TABLE IF NOT EXISTS facets (resource TEXT, name TEXT, count INTEGER, data TEXT, "
+    "PRIMARY KEY (resource, name))",
+    "CREATE TABLE IF NOT EXISTS sync_marks (name TEXT PRIMARY KEY, mark TEXT)"
+};
+
+template <int N>
+static bool listContains(const char *(&list)[N], const QString &value) {
+    for (int i = 0; i < N; i++) {
+        if (value == QLatin1String(list[i])) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+static QString resourceName(const QString &resourcePath) {
+    return resourcePath.startsWith('/') ? resourcePath.mid(1) : resourcePath;
+}
+
+// Returns true if value sorts after mark. Numbers are compared numerically and anything else as a string.
+static bool isNewer(const QVariant &value, const QString &mark) {
+    if (mark.isEmpty()) {
+        return true;
+    }
+    
+    switch (value.type()) {
+    case QVariant::Int:
+    case QVariant::LongLong:
+    case QVariant::UInt:
+    case QVariant::ULongLong:
+    case QVariant::Double:
+        return value.toDouble() > mark.toDouble();
+    default:
+        return value.toString() > mark;
+    }
+}
+
+static QString escapeLike(QString text) {
+    return text.replace('\\', "\\\\").replace('%', "\\%").replace('_', "\\_");
+}
+
+/*!
+    \class CatalogMirror
+    \brief Keeps a local SQLite copy of the cuteRadio station catalog.
+    
+    \ingroup requests
+    
+    CatalogMirror stores stations, genres, countries and languages in an SQLite database, so that they can be 
+    queried offline. Stations are indexed by id, genre, country and language.
+    
+    Calling sync() downloads the genres, countries and languages in full, then requests stations sorted by 
+    syncProperty in descending order. Station pages are stored until one contains a station that is not newer 
+    than the newest station of the previous sync, so after the first sync only changed stations are downloaded. 
+    Stations removed from the server are not removed from the mirror until it is cleared.
+    
+    Setting the mirror property of a ResourcesModel makes it query the mirror instead of the network. query() 
+    supports the genre, country, language, search, sort, sortDescending, limit and offset filters.
+    
+    Example usage:
+    
+    \code
+    import QtQuick 1.0
+    import CuteRadio 1.0
+    
+    ListView {
+        id: view
+        
+        width: 800
+        height: 480
+        model: StationsModel {
+            id: stationsModel
+            
+            mirror: CatalogMirror {
+                id: mirror
+                
+                onSynced: stationsModel.reload()
+            }
+            filters: {genre: "Rock"}
+        }
+        delegate: Text {
+            width: view.width
+            height: 50
+            text: title
+        }
+        
+        Component.onCompleted: {
+            stationsModel.reload();
+            mirror.sync();
+        }
+    }
+    \endcode
+    
+    \sa ResourcesModel::mirror
+*/
+CatalogMirror::CatalogMirror(QObject *parent) :
+    QObject(parent),
+    d_ptr(new CatalogMirrorPrivate(this))
+{
+    Q_D(CatalogMirror);
+    
+    d->request = new ResourcesRequest(this);
+    connect(d->request, SIGNAL(finished(CuteRadio::Request*)), this, SLOT(_q_onRequestFinished()));
+}
+
+CatalogMirror::~CatalogMirror() {
+    Q_D(CatalogMirror);
+    
+    d->closeDatabase();
+}
+
+/*!
+    \property QString CatalogMirror::accessToken
+    \brief The access token used when syncing.
+*/
+QString CatalogMirror::accessToken() const {
+    Q_D(const CatalogMirror);
+    
+    return d->request->accessToken();
+}
+
+void CatalogMirror::setAccessToken(const QString &token) {
+    Q_D(CatalogMirror);
+    
+    if (token != accessToken()) {
+        d->request->setAccessToken(token);
+        emit accessTokenChanged();
+    }
+}
+
+/*!
+    \property QString CatalogMirror::databasePath
+    \brief The path of the SQLite database file.
+    
+    The database is created when it is first used.
+*/
+QString CatalogMirror::databasePath() const {
+    Q_D(const CatalogMirror);
+    
+    return d->path;
+}
+
+void CatalogMirror::setDatabasePath(const QString &path) {
+    Q_D(CatalogMirror);
+    
+    if (path != d->path) {
+        cancel();
+        d->closeDatabase();
+        d->path = path;
+        d->stationCount = -1;
+        emit databasePathChanged();
+        emit stationCountChanged(stationCount());
+    }
+}
+
+/*!
+    \property QString CatalogMirror::syncProperty
+    \brief The station property used to find changed stations when syncing.
+    
+    Stations are requested with this property as the sort filter, newest first. The newest value seen is stored 
+    for each property, so changing the property starts a full sync. The default value is "lastModified".
+*/
+QString CatalogMirror::syncProperty() const {
+    Q_D(const CatalogMirror);
+    
+    return d->syncProperty;
+}
+
+void CatalogMirror::setSyncProperty(const QString &property) {
+    Q_D(CatalogMirror);
+    
+    if (property != d->syncProperty) {
+        d->syncProperty = property;
+        emit syncPropertyChanged();
+    }
+}
+
+/*!
+    \property int CatalogMirror::stationCount
+    \brief The number of stations in the mirror.
+*/
+int CatalogMirror::stationCount() const {
+    Q_D(const CatalogMirror);
+    
+    if ((d->stationCount < 0) && (d->openDatabase())) {
+        QSqlQuery query("SELECT COUNT(*) FROM stations", d->database());
+        d->stationCount = query.next() ? query.value(0).toInt() : 0;
+    }
+    
+    return qMax(0, d->stationCount);
+}
+
+/*!
+    \property enum CatalogMirror::status
+    \brief The status of the current sync.
+*/
+Request::Status CatalogMirror::status() const {
+    Q_D(const CatalogMirror);
+    
+    return d->status;
+}
+
+/*!
+    \property QString CatalogMirror::errorString
+    \brief A description of the error that caused the last sync to fail.
+*/
+QString CatalogMirror::errorString() const {
+    Q_D(const CatalogMirror);
+    
+    return d->errorString;
+}
+
+/*!
+    \brief Sets the QNetworkAccessManager instance to be used when syncing.
+    
+    CatalogMirror does not take ownership of \a manager.
+*/
+void CatalogMirror::setNetworkAccessManager(QNetworkAccessManager *manager) {
+    Q_D(CatalogMirror);
+    
+    d->request->setNetworkAccessManager(manager);
+}
+
+/*!
+    \brief Returns true if resources at \a resourcePath can be queried from the mirror.
+*/
+bool CatalogMirror::canQuery(const QString &resourcePath) const {
+    const QString resource = resourceName(resourcePath);
+    
+    return (resource == "stations") || (listContains(FACET_RESOURCES, resource));
+}
+
+/*!
+    \brief Returns resources at \a resourcePath from the mirror, filtered by \a filters.
+    
+    The result contains the items, and "more", which is true if there are items after them.
+    
+    Returns an empty map if the resource is not mirrored or the database cannot be opened.
+*/
+QVariantMap CatalogMirror::query(const QString &resourcePath, const QVariantMap &filters) const {
+    Q_D(const CatalogMirror);
+    
+    QVariantMap result;
+    const QString resource = resourceName(resourcePath);
+    
+    if ((!canQuery(resource)) || (!d->openDatabase())) {
+        return result;
+    }
+    
+    QStringList conditions;
+    QVariantList values;
+    QString sort = filters.value("sort").toString();
+    QString sql;
+    
+    if (resource == "stations") {
+        for (int i = 0; i < 3; i++) {
+            if (filters.contains(STATION_FACETS[i])) {
+                conditions << QString("%1 = ?").arg(STATION_FACETS[i]);
+                values << filters.value(STATION_FACETS[i]).toString();
+            }
+        }
+        
+        const QString search = filters.value("search").toString();
+        
+        if (!search.isEmpty()) {
+            const QString pattern = "%" + escapeLike(search) + "%";
+            QStringList columns;
+            
+            for (int i = 0; i < 3; i++) {
+                columns << QString("%1 LIKE ? ESCAPE '\\'").arg(STATION_FACETS[i]);
+                values << pattern;
+            }
+            
+            columns << "title LIKE ? ESCAPE '\\'" << "description LIKE ? ESCAPE '\\'";
+            values << pattern << pattern;
+            conditions << "(" + columns.join(" OR ") + ")";
+        }
+        
+        if (!listContains(STATION_SORT_COLUMNS, sort)) {
+            sort = "title";
+        }
+        
+        sql = "SELECT data FROM stations";
+    }
+    else {
+        conditions << "resource = ?";
+        values << resource;
+        
+        if (sort != "count") {
+            sort = "name";
+        }
+        
+        sql = "SELECT data FROM facets";
+    }
+    
+    int limit = filters.value("limit", DEFAULT_QUERY_LIMIT).toInt();
+    
+    if (limit <= 0) {
+        limit = DEFAULT_QUERY_LIMIT;
+    }
+    
+    if (!conditions.isEmpty()) {
+        sql.append(" WHERE " + conditions.join(" AND "));
+    }
+    
+    // One extra row is requested to find out whether there are more.
+    sql.append(QString(" ORDER BY %1 %2 LIMIT %3 OFFSET %4").arg(sort)
+               .arg(filters.value("sortDescending").toBool() ? "DESC" : "ASC").arg(limit + 1)
+               .arg(qMax(0, filters.value("offset").toInt())));
+    
+    QSqlQuery query(d->database());
+    query.prepare(sql);
+    
+    foreach (const QVariant &value, values) {
+        query.addBindValue(value);
+    }
+    
+    if (!query.exec()) {
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::CatalogMirror::query" << sql << query.lastError().text();
+#endif
+        return result;
+    }
+    
+    QVariantList items;
+    bool more = false;
+    
+    while (query.next()) {
+        if (items.size() == limit) {
+            more = true;
+            break;
+        }
+        
+        items << QtJson::Json::parse(query.value(0).toString());
+    }
+    
+    result["items"] = items;
+    result["more"] = more;
+    return result;
+}
+
+/*!
+    \brief Downloads changes to the catalog into the mirror.
+*/
+void CatalogMirror::sync() {
+    Q_D(CatalogMirror);
+    
+    if (d->status == Request::Loading) {
+        return;
+    }
+    
+    if (!d->openDatabase()) {
+        d->fail(d->database().lastError().text());
+        return;
+    }
+    
+    d->pendingResources.clear();
+    
+    for (int i = 0; i < 3; i++) {
+        d->pendingResources << FACET_RESOURCES[i];
+    }
+    
+    d->pendingResources << "stations";
+    d->errorString = QString();
+    d->setStatus(Request::Loading);
+    d->syncNext();
+}
+
+/*!
+    \brief Cancels the current sync. Pages already stored are kept.
+*/
+void CatalogMirror::cancel() {
+    Q_D(CatalogMirror);
+    
+    if (d->status == Request::Loading) {
+        d->pendingResources.clear();
+        d->request->cancel();
+    }
+}
+
+/*!
+    \fn void CatalogMirror::synced()
+    \brief Emitted when a sync completes successfully.
+*/
+
+CatalogMirrorPrivate::CatalogMirrorPrivate(CatalogMirror *parent) :
+    q_ptr(parent),
+    request(0),
+    connectionName(QString("cuteradio-mirror-%1").arg(quintptr(parent), 0, 16)),
+    syncProperty("lastModified"),
+    databaseOpen(false),
+    stationCount(-1),
+    status(Request::Null)
+{
+#if QT_VERSION >= 0x050000
+    path = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + "/cuteradio/catalog.sqlite";
+#else
+    path = QDir::homePath() + "/.cuteradio/catalog.sqlite";
+#endif
+}
+
+QSqlDatabase CatalogMirrorPrivate::database() const {
+    return QSqlDatabase::database(connectionName, false);
+}
+
+bool CatalogMirrorPrivate::openDatabase() const {
+    if (databaseOpen) {
+        return true;
+    }
+    
+    QSqlDatabase db = QSqlDatabase::contains(connectionName) ? database()
+                                                              : QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    QDir().mkpath(QFileInfo(path).path());
+    db.setDatabaseName(path);
+    
+    if (!db.open()) {
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::CatalogMirrorPrivate::openDatabase" << path << db.lastError().text();
+#endif
+        return false;
+    }
+    
+    QSqlQuery query(db);
+    
+    for (uint i = 0; i < sizeof(SCHEMA) / sizeof(SCHEMA[0]); i++) {
+        if (!query.exec(SCHEMA[i])) {
+            db.close();
+            return false;
+        }
+    }
+    
+    databaseOpen = true;
+    return true;
+}
+
+void CatalogMirrorPrivate::closeDatabase() {
+    if (QSqlDatabase::contains(connectionName)) {
+        database().close();
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+    
+    databaseOpen = false;
+}
+
+void CatalogMirrorPrivate::updateStationCount() {
+    Q_Q(CatalogMirror);
+    
+    const int count = stationCount;
+    stationCount = -1;
+    
+    if (q->stationCount() != count) {
+        emit q->stationCountChanged(stationCount);
+    }
+}
+
+void CatalogMirrorPrivate::setStatus(Request::Status s) {
+    if (s != status) {
+        Q_Q(CatalogMirror);
+        status = s;
+        emit q->statusChanged(s);
+    }
+}
+
+void CatalogMirrorPrivate::fail(const QString &es) {
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::CatalogMirrorPrivate::fail" << resource << es;
+#endif
+    pendingResources.clear();
+    facets.clear();
+    errorString = es;
+    setStatus(Request::Failed);
+}
+
+void CatalogMirrorPrivate::syncNext() {
+    if (pendingResources.isEmpty()) {
+        Q_Q(CatalogMirror);
+        updateStationCount();
+        setStatus(Request::Ready);
+        emit q->synced();
+        return;
+    }
+    
+    resource = pendingResources.takeFirst();
+    facets.clear();
+    
+    QVariantMap filters;
+    filters["limit"] = SYNC_PAGE_LIMIT;
+    
+    if (resource == "stations") {
+        mark = syncMark("stations:" + syncProperty);
+        newMark = mark;
+        filters["sort"] = syncProperty;
+        filters["sortDescending"] = true;
+    }
+    
+    request->get("/" + resource, filters);
+}
+
+bool CatalogMirrorPrivate::storeFacets(const QString &resource, const QVariantList &list) {
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+    db.transaction();
+    query.prepare("DELETE FROM facets WHERE resource = ?");
+    query.addBindValue(resource);
+    
+    if (!query.exec()) {
+        db.rollback();
+        return false;
+    }
+    
+    query.prepare("INSERT OR REPLACE INTO facets (resource, name, count, data) VALUES (?, ?, ?, ?)");
+    
+    foreach (const QVariant &item, list) {
+        const QVariantMap facet = item.toMap();
+        query.addBindValue(resource);
+        query.addBindValue(facet.value("name").toString());
+        query.addBindValue(facet.value("count").toInt());
+        query.addBindValue(QString::fromUtf8(QtJson::Json::serialize(facet)));
+        
+        if (!query.exec()) {
+            db.rollback();
+            return false;
+        }
+    }
+    
+    return db.commit();
+}
+
+/*!
+    \internal
+    \brief Stores a page of stations, setting \a complete to true if it reaches the previous sync.
+*/
+bool CatalogMirrorPrivate::storeStations(const QVariantList &list, bool *complete) {
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+    db.transaction();
+    query.prepare("INSERT OR REPLACE INTO stations (id, title, description, genre, country, language, playCount, "
+                  "lastPlayed, data) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    
+    foreach (const QVariant &item, list) {
+        const QVariantMap station = item.toMap();
+        const QVariant key = station.value(syncProperty);
+        
+        if (!isNewer(key, mark)) {
+            *complete = true;
+        }
+        
+        if (isNewer(key, newMark)) {
+            newMark = key.toString();
+        }
+        
+        query.addBindValue(station.value("id").toString());
+        query.addBindValue(station.value("title").toString());
+        query.addBindValue(station.value("description").toString());
+        query.addBindValue(station.value("genre").toString());
+        query.addBindValue(station.value("country").toString());
+        query.addBindValue(station.value("language").toString());
+        query.addBindValue(station.value("playCount").toInt());
+        query.addBindValue(station.value("lastPlayed").toString());
+        query.addBindValue(QString::fromUtf8(QtJson::Json::serialize(station)));
+        
+        if (!query.exec()) {
+            db.rollback();
+            return false;
+        }
+    }
+    
+    return db.commit();
+}
+
+QString CatalogMirrorPrivate::syncMark(const QString &name) const {
+    if (!openDatabase()) {
+        return QString();
+    }
+    
+    QSqlQuery query(database());
+    query.prepare("SELECT mark FROM sync_marks WHERE name = ?");
+    query.addBindValue(name);
+    
+    return (query.exec()) && (query.next()) ? query.value(0).toString() : QString();
+}
+
+bool CatalogMirrorPrivate::setSyncMark(const QString &name, const QString &value) {
+    if (!openDatabase()) {
+        return false;
+    }
+    
+    QSqlQuery query(database());
+    query.prepare("INSERT OR REPLACE INTO sync_marks (name, mark) VALUES (?, ?)");
+    query.addBindValue(name);
+    query.addBindValue(value);
+    
+    return query.exec();
+}
+
+void CatalogMirrorPrivate::_q_onRequestFinished() {
+    if (status != Request::Loading) {
+        return;
+    }
+    
+    switch (request->status()) {
+    case Request::Ready:
+        break;
+    case Request::Canceled:
+        pendingResources.clear();
+        facets.clear();
+        setStatus(Request::Canceled);
+        return;
+    default:
+        fail(request->errorString());
+        return;
+    }
+    
+    const QVariantMap result = request->result().toMap();
+    const QVariantList list = result.value("items").toList();
+    const QString next = result.value("next").toString();
+    
+    if (resource == "stations") {
+        bool complete = false;
+        
+        if (!storeStations(list, &complete)) {
+            fail(database().lastError().text());
+            return;
+        }
+        
+        if ((!complete) && (!next.isEmpty())) {
+            request->get(next);
+            return;
+        }
+        
+        setSyncMark("stations:" + syncProperty, newMark);
+    }
+    else {
+        facets << list;
+        
+        if (!next.isEmpty()) {
+            request->get(next);
+            return;
+        }
+        
+        if (!storeFacets(resource, facets)) {
+            fail(database().lastError().text());
+            return;
+        }
+    }
+    
+    syncNext();
+}
+
+}
+
+#include "moc_catalogmirror.cpp"
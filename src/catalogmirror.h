@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_CATALOGMIRROR_H
+#define CUTERADIO_CATALOGMIRROR_H
+
+#include "request.h"
+
+namespace CuteRadio {
+
+class CatalogMirrorPrivate;
+
+class CUTERADIOSHARED_EXPORT CatalogMirror : public QObject
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(QString accessToken READ accessToken WRITE setAccessToken NOTIFY accessTokenChanged)
+    Q_PROPERTY(QString databasePath READ databasePath WRITE setDatabasePath NOTIFY databasePathChanged)
+    Q_PROPERTY(QString syncProperty READ syncProperty WRITE setSyncProperty NOTIFY syncPropertyChanged)
+    Q_PROPERTY(int stationCount READ stationCount NOTIFY stationCountChanged)
+    Q_PROPERTY(CuteRadio::Request::Status status READ status NOTIFY statusChanged)
+    Q_PROPERTY(QString errorString READ errorString NOTIFY statusChanged)
+    
+public:
+    explicit CatalogMirror(QObject *parent = 0);
+    ~CatalogMirror();
+    
+    QString accessToken() const;
+    void setAccessToken(const QString &token);
+    
+    QString databasePath() const;
+    void setDatabasePath(const QString &path);
+    
+    QString syncProperty() const;
+    void setSyncProperty(const QString &property);
+    
+    int stationCount() const;
+    
+    Request::Status status() const;
+    QString errorString() const;
+    
+    void setNetworkAccessManager(QNetworkAccessManager *manager);
+    
+    Q_INVOKABLE bool canQuery(const QString &resourcePath) const;
+    Q_INVOKABLE QVariantMap query(const QString &resourcePath, const QVariantMap &filters = QVariantMap()) const;
+    
+public Q_SLOTS:
+    void sync();
+    void cancel();
+    
+Q_SIGNALS:
+    void accessTokenChanged();
+    void databasePathChanged();
+    void syncPropertyChanged();
+    void stationCountChanged(int count);
+    void statusChanged(CuteRadio::Request::Status s);
+    void synced();
+    
+private:
+    QScopedPointer<CatalogMirrorPrivate> d_ptr;
+    
+    Q_DECLARE_PRIVATE(CatalogMirror)
+    
+    Q_PRIVATE_SLOT(d_func(), void _q_onRequestFinished())
+    
+    Q_DISABLE_COPY(CatalogMirror)
+};
+
+}
+
+#endif // CUTERADIO_CATALOGMIRROR_H
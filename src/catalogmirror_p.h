@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_CATALOGMIRROR_P_H
+#define CUTERADIO_CATALOGMIRROR_P_H
+
+#include "catalogmirror.h"
+#include <QSqlDatabase>
+#include <QStringList>
+
+namespace CuteRadio {
+
+class ResourcesRequest;
+
+class CatalogMirrorPrivate
+{
+
+public:
+    CatalogMirrorPrivate(CatalogMirror *parent);
+    
+    QSqlDatabase database() const;
+    bool openDatabase() const;
+    void closeDatabase();
+    
+    void updateStationCount();
+    
+    void setStatus(Request::Status s);
+    void fail(const QString &es);
+    
+    void syncNext();
+    
+    bool storeFacets(const QString &resource, const QVariantList &list);
+    bool storeStations(const QVariantList &list, bool *complete);
+    
+    QString syncMark(const QString &name) const;
+    bool setSyncMark(const QString &name, const QString &value);
+    
+    void _q_onRequestFinished();
+    
+    CatalogMirror *q_ptr;
+    
+    ResourcesRequest *request;
+    
+    QString connectionName;
+    QString path;
+    QString syncProperty;
+    
+    mutable bool databaseOpen;
+    
+    mutable int stationCount;
+    
+    Request::Status status;
+    QString errorString;
+    
+    QStringList pendingResources;
+    QString resource;
+    QVariantList facets;
+    QString mark;
+    QString newMark;
+    
+    Q_DECLARE_PUBLIC(CatalogMirror)
+};
+
+}
+
+#endif // CUTERADIO_CATALOGMIRROR_P_H
@@ -0,0 +1,606 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "circuitbreaker.h"
+#include "circuitbreaker_p.h"
+#include "endpointselector_p.h"
+#include "model_p.h"
+#include "request_p.h"
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTimer>
+#include <QUrl>
+#ifdef CUTERADIO_DEBUG
+#include <QDebug>
+#endif
+
+namespace CuteRadio {
+
+static const int DEFAULT_FAILURE_THRESHOLD = 5;
+static const int DEFAULT_COOLDOWN = 30000;
+static const int DEFAULT_CACHE_SIZE = 1048576;
+static const int DEFAULT_CACHE_TIME = 600000;
+
+/*!
+    \class CircuitBreaker
+    \brief Fails requests immediately while an endpoint is unavailable.
+    
+    \ingroup requests
+    
+    Without a circuit breaker, every request to an endpoint that is down waits for the connection to time out 
+    before failing. CircuitBreaker counts consecutive failures for each endpoint (the scheme, host and port of the 
+    request url). Once failureThreshold requests in a row have failed to reach an endpoint, its circuit opens, 
+    and further requests fail straight away with Request::CircuitOpenError.
+    
+    After cooldown milliseconds the circuit is half open, and the next request is sent to test the endpoint. 
+    Requests made while the test is in progress still fail immediately. If the test succeeds the circuit closes, 
+    otherwise it opens again for another cooldown.
+    
+    Only failures to connect and server errors count. An endpoint that responds with an error such as 404 
+    (Not Found) is working, and the response closes its circuit.
+    
+    While the breaker exists, the results of recent successful GET requests for cuteRadio Data API resources are 
+    kept, up to maximumCacheSize bytes and for at most cacheTime milliseconds. A GET request that is rejected 
+    because its circuit is open finishes successfully with the cached result for its url, if there is one. The 
+    cached results of an endpoint are removed once its circuit closes, and results are not kept for requests made 
+    by a ResourcesModel whose resultRetention is ResourcesModel::DiscardIngestedResult.
+    
+    All CircuitBreaker objects share one breaker, which applies to every Request and PagesRequest in the process.
+    
+    Example usage:
+    
+    \code
+    import QtQuick 1.0
+    import CuteRadio 1.0
+    
+    CircuitBreaker {
+        id: breaker
+        
+        failureThreshold: 3
+        onStateChanged: if (state == CircuitBreaker.Open) console.log(endpoint + " is unavailable")
+    }
+    \endcode
+*/
+
+/*!
+    \enum CircuitBreaker::State
+    \brief The state of an endpoint's circuit.
+    
+    <table>
+        <tr>
+            <th>Value</th>
+            <th>Description</th>
+        </tr>
+        <tr>
+            <td>Closed</td>
+            <td>Requests are sent normally.</td>
+        </tr>
+        <tr>
+            <td>Open</td>
+            <td>Requests fail immediately, until the cooldown has elapsed.</td>
+        </tr>
+        <tr>
+            <td>HalfOpen</td>
+            <td>The next request is sent to test the endpoint. Others fail immediately.</td>
+        </tr>
+    </table>
+*/
+CircuitBreaker::CircuitBreaker(QObject *parent) :
+    QObject(parent)
+{
+    CircuitBreakerStore *store = CircuitBreakerStore::instance();
+    connect(store, SIGNAL(openCountChanged(int)), this, SIGNAL(openCountChanged(int)));
+    connect(store, SIGNAL(stateChanged(QString, int)), this, SIGNAL(stateChanged(QString, int)));
+}
+
+/*!
+    \property int CircuitBreaker::failureThreshold
+    \brief The number of consecutive failures after which an endpoint's circuit opens.
+    
+    The default value is 5.
+*/
+int CircuitBreaker::failureThreshold() const {
+    return CircuitBreakerStore::instance()->failureThreshold;
+}
+
+void CircuitBreaker::setFailureThreshold(int failures) {
+    CircuitBreakerStore *store = CircuitBreakerStore::instance();
+    failures = qMax(1, failures);
+    
+    if (failures != store->failureThreshold) {
+        store->failureThreshold = failures;
+        emit failureThresholdChanged();
+    }
+}
+
+/*!
+    \property int CircuitBreaker::cooldown
+    \brief The time in milliseconds for which a circuit stays open before it is half open.
+    
+    The default value is 30000.
+*/
+int CircuitBreaker::cooldown() const {
+    return CircuitBreakerStore::instance()->cooldown;
+}
+
+void CircuitBreaker::setCooldown(int cooldown) {
+    CircuitBreakerStore *store = CircuitBreakerStore::instance();
+    cooldown = qMax(0, cooldown);
+    
+    if (cooldown != store->cooldown) {
+        store->cooldown = cooldown;
+        store->updateStates();
+        emit cooldownChanged();
+    }
+}
+
+/*!
+    \property int CircuitBreaker::maximumCacheSize
+    \brief The approximate total size in bytes of the GET results kept to be served while a circuit is open.
+    
+    The least recently used results are removed first. A result larger than maximumCacheSize is not kept.
+    
+    The default value is 1048576 (1 MiB). Setting it to 0 disables the cache.
+*/
+int CircuitBreaker::maximumCacheSize() const {
+    return CircuitBreakerStore::instance()->responses.maxCost();
+}
+
+void CircuitBreaker::setMaximumCacheSize(int size) {
+    CircuitBreakerStore *store = CircuitBreakerStore::instance();
+    size = qMax(0, size);
+    
+    if (size != store->responses.maxCost()) {
+        store->responses.setMaxCost(size);
+        emit maximumCacheSizeChanged();
+    }
+}
+
+/*!
+    \property int CircuitBreaker::cacheTime
+    \brief The time in milliseconds for which a GET result is kept.
+    
+    The default value is 600000 (10 minutes).
+*/
+int CircuitBreaker::cacheTime() const {
+    return CircuitBreakerStore::instance()->cacheTime;
+}
+
+void CircuitBreaker::setCacheTime(int time) {
+    CircuitBreakerStore *store = CircuitBreakerStore::instance();
+    time = qMax(0, time);
+    
+    if (time != store->cacheTime) {
+        store->cacheTime = time;
+        emit cacheTimeChanged();
+    }
+}
+
+/*!
+    \property int CircuitBreaker::openCount
+    \brief The number of endpoints whose circuit is open or half open.
+*/
+int CircuitBreaker::openCount() const {
+    return CircuitBreakerStore::instance()->openCount();
+}
+
+/*!
+    \brief Returns the CircuitBreaker::State of the endpoint for \a url.
+*/
+int CircuitBreaker::state(const QString &url) const {
+    const CircuitBreakerStore *store = CircuitBreakerStore::instance();
+    return store->endpoints.value(CircuitBreakerStore::endpointOf(QUrl(url))).state;
+}
+
+/*!
+    \brief Returns the state of the endpoint for \a url.
+    
+    The map contains the endpoint, state, failures (the number of consecutive failures), rejectedCount (the 
+    number of requests failed while the circuit was open), cachedCount (the number of those that were served from 
+    the cache) and cooldownRemaining (the time in milliseconds until an open circuit is half open).
+*/
+QVariantMap CircuitBreaker::endpoint(const QString &url) const {
+    return CircuitBreakerStore::instance()->endpointInfo(CircuitBreakerStore::endpointOf(QUrl(url)));
+}
+
+/*!
+    \brief Returns the state of every endpoint that has failed since its last success.
+    
+    \sa endpoint()
+*/
+QVariantList CircuitBreaker::endpoints() const {
+    const CircuitBreakerStore *store = CircuitBreakerStore::instance();
+    QVariantList list;
+    
+    foreach (const QString &key, store->endpoints.keys()) {
+        list << store->endpointInfo(key);
+    }
+    
+    return list;
+}
+
+/*!
+    \brief Closes all circuits and forgets all failures.
+*/
+void CircuitBreaker::reset() {
+    CircuitBreakerStore::instance()->reset();
+}
+
+/*!
+    \brief Closes the circuit of the endpoint for \a url and forgets its failures.
+*/
+void CircuitBreaker::resetEndpoint(const QString &url) {
+    CircuitBreakerStore::instance()->reset(CircuitBreakerStore::endpointOf(QUrl(url)));
+}
+
+/*!
+    \brief Removes all cached responses.
+*/
+void CircuitBreaker::clearCache() {
+    CircuitBreakerStore::instance()->responses.clear();
+}
+
+/*!
+    \fn void CircuitBreaker::stateChanged(const QString &endpoint, int state)
+    \brief Emitted when the circuit of \a endpoint changes to \a state.
+*/
+
+CircuitBreakerStore* CircuitBreakerStore::self = 0;
+
+CircuitBreakerStore::CircuitBreakerStore() :
+    QObject(QCoreApplication::instance()),
+    failureThreshold(DEFAULT_FAILURE_THRESHOLD),
+    cooldown(DEFAULT_COOLDOWN),
+    cacheTime(DEFAULT_CACHE_TIME),
+    responses(DEFAULT_CACHE_SIZE),
+    timer(new QTimer(this))
+{
+    timer->setSingleShot(true);
+    connect(timer, SIGNAL(timeout()), this, SLOT(updateStates()));
+    clock.start();
+}
+
+CircuitBreakerStore::~CircuitBreakerStore() {
+    if (self == this) {
+        self = 0;
+    }
+}
+
+/*!
+    \internal
+    \brief Returns the breaker, creating it if required.
+    
+    The breaker is owned by the application object.
+*/
+CircuitBreakerStore* CircuitBreakerStore::instance() {
+    if (!self) {
+        self = new CircuitBreakerStore;
+    }
+    
+    return self;
+}
+
+/*!
+    \internal
+    \brief Returns the breaker if it exists, otherwise 0.
+*/
+CircuitBreakerStore* CircuitBreakerStore::existingInstance() {
+    return self;
+}
+
+/*!
+    \internal
+    \brief Returns the endpoint of \a url, which is its scheme, host and port.
+*/
+QString CircuitBreakerStore::endpointOf(const QUrl &url) {
+    const QString scheme = url.scheme().toLower();
+    const int port = url.port(scheme == "https" ? 443 : 80);
+    return scheme + "://" + url.host().toLower() + ":" + QString::number(port);
+}
+
+/*!
+    \internal
+    \brief Returns true if a request to \a url may be sent.
+    
+    A request to a half open endpoint is allowed if no other request is testing it. A test that has not been 
+    recorded within the cooldown, such as one whose request was deleted, no longer blocks another.
+*/
+bool CircuitBreakerStore::allow(const QUrl &url) {
+    if (endpoints.isEmpty()) {
+        return true;
+    }
+    
+    const QString endpoint = endpointOf(url);
+    QHash<QString, CircuitEndpoint>::iterator iterator = endpoints.find(endpoint);
+    
+    if (iterator == endpoints.end()) {
+        return true;
+    }
+    
+    CircuitEndpoint &e = iterator.value();
+    
+    if ((e.state == CircuitBreaker::Open) && (clock.elapsed() - e.opened >= cooldown)) {
+        e.state = CircuitBreaker::HalfOpen;
+        e.probing = false;
+        emit stateChanged(endpoint, CircuitBreaker::HalfOpen);
+        return allow(url);
+    }
+    
+    switch (e.state) {
+    case CircuitBreaker::Closed:
+        return true;
+    case CircuitBreaker::HalfOpen:
+        if ((!e.probing) || (clock.elapsed() - e.probeStarted >= cooldown)) {
+#ifdef CUTERADIO_DEBUG
+            qDebug() << "CuteRadio::CircuitBreakerStore::allow: Testing" << endpoint;
+#endif
+            e.probing = true;
+            e.probeStarted = clock.elapsed();
+            return true;
+        }
+        
+        break;
+    default:
+        break;
+    }
+    
+    e.rejectedCount++;
+    return false;
+}
+
+/*!
+    \internal
+    \brief Records the outcome \a e of a request to \a url.
+*/
+void CircuitBreakerStore::record(const QUrl &url, QNetworkReply::NetworkError e) {
+    if (e == QNetworkReply::OperationCanceledError) {
+        if (!endpoints.isEmpty()) {
+            // A canceled test does not tell us anything, so let the next request test the endpoint instead.
+            QHash<QString, CircuitEndpoint>::iterator iterator = endpoints.find(endpointOf(url));
+            
+            if (iterator != endpoints.end()) {
+                iterator.value().probing = false;
+            }
+        }
+        
+        return;
+    }
+    
+    const QString endpoint = endpointOf(url);
+    
+    if (!isEndpointFailure(e)) {
+        if (!endpoints.isEmpty()) {
+            const CircuitEndpoint removed = endpoints.take(endpoint);
+            
+            if (removed.state != CircuitBreaker::Closed) {
+#ifdef CUTERADIO_DEBUG
+                qDebug() << "CuteRadio::CircuitBreakerStore::record: Closed" << endpoint;
+#endif
+                removeResponses(endpoint);
+                emit stateChanged(endpoint, CircuitBreaker::Closed);
+                emit openCountChanged(openCount());
+            }
+        }
+        
+        return;
+    }
+    
+    CircuitEndpoint &ce = endpoints[endpoint];
+    ce.failures++;
+    
+    if ((ce.state == CircuitBreaker::HalfOpen)
+        || ((ce.state == CircuitBreaker::Closed) && (ce.failures >= failureThreshold))) {
+        setState(endpoint, ce, CircuitBreaker::Open);
+    }
+}
+
+/*!
+    \internal
+    \brief Copies the cached result of a GET request for \a url to \a result, and returns true if there is one.
+*/
+bool CircuitBreakerStore::cachedResponse(const QUrl &url, QVariant *result) {
+    const QString key = url.toString();
+    const CachedResponse *cached = responses.object(key);
+    
+    if (!cached) {
+        return false;
+    }
+    
+    if (cached->expires <= clock.elapsed()) {
+        responses.remove(key);
+        return false;
+    }
+    
+    *result = cached->result;
+    QHash<QString, CircuitEndpoint>::iterator iterator = endpoints.find(endpointOf(url));
+    
+    if (iterator != endpoints.end()) {
+        iterator.value().cachedCount++;
+    }
+    
+    return true;
+}
+
+/*!
+    \internal
+    \brief Keeps \a result of a GET request for \a url, if \a url is a cuteRadio Data API resource.
+    
+    Other GET requests, such as for playlists, can not be served from the cache, since their results would be 
+    stale or too large.
+*/
+void CircuitBreakerStore::storeResponse(const QUrl &url, const QVariant &result) {
+    if ((responses.maxCost() <= 0) || (cacheTime <= 0) || (EndpointStore::resourcePath(url).isNull())) {
+        return;
+    }
+    
+    removeExpiredResponses();
+    QSet<const void*> seen;
+    const qint64 cost = variantBytes(result, seen);
+    
+    if (cost > responses.maxCost()) {
+        responses.remove(url.toString());
+        return;
+    }
+    
+    CachedResponse *response = new CachedResponse;
+    response->result = result;
+    response->expires = clock.elapsed() + cacheTime;
+    responses.insert(url.toString(), response, qMax(1, int(cost)));
+}
+
+/*!
+    \internal
+    \brief Removes the cached results of \a endpoint, once its circuit has closed.
+*/
+void CircuitBreakerStore::removeResponses(const QString &endpoint) {
+    foreach (const QString &key, responses.keys()) {
+        if (endpointOf(QUrl(key)) == endpoint) {
+            responses.remove(key);
+        }
+    }
+}
+
+void CircuitBreakerStore::removeExpiredResponses() {
+    const qint64 now = clock.elapsed();
+    
+    foreach (const QString &key, responses.keys()) {
+        if (responses.object(key)->expires <= now) {
+            responses.remove(key);
+        }
+    }
+}
+
+void CircuitBreakerStore::reset() {
+    const QStringList opened = endpoints.keys();
+    endpoints.clear();
+    timer->stop();
+    
+    foreach (const QString &endpoint, opened) {
+        removeResponses(endpoint);
+        emit stateChanged(endpoint, CircuitBreaker::Closed);
+    }
+    
+    emit openCountChanged(0);
+}
+
+void CircuitBreakerStore::reset(const QString &endpoint) {
+    const CircuitEndpoint removed = endpoints.take(endpoint);
+    
+    if (removed.state != CircuitBreaker::Closed) {
+        removeResponses(endpoint);
+        emit stateChanged(endpoint, CircuitBreaker::Closed);
+        emit openCountChanged(openCount());
+    }
+}
+
+int CircuitBreakerStore::openCount() const {
+    int count = 0;
+    
+    foreach (const CircuitEndpoint &e, endpoints) {
+        if (e.state != CircuitBreaker::Closed) {
+            count++;
+        }
+    }
+    
+    return count;
+}
+
+QVariantMap CircuitBreakerStore::endpointInfo(const QString &endpoint) const {
+    const CircuitEndpoint e = endpoints.value(endpoint);
+    QVariantMap info;
+    info["endpoint"] = endpoint;
+    info["state"] = int(e.state);
+    info["failures"] = e.failures;
+    info["rejectedCount"] = e.rejectedCount;
+    info["cachedCount"] = e.cachedCount;
+    info["cooldownRemaining"] = e.state == CircuitBreaker::Open ? qMax(0, int(e.opened + cooldown - clock.elapsed()))
+                                                                : 0;
+    return info;
+}
+
+/*!
+    \internal
+    \brief Makes open circuits whose cooldown has elapsed half open, and schedules the next check.
+*/
+void CircuitBreakerStore::updateStates() {
+    const qint64 now = clock.elapsed();
+    QStringList halfOpened;
+    qint64 next = -1;
+    
+    QMutableHashIterator<QString, CircuitEndpoint> iterator(endpoints);
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        CircuitEndpoint &e = iterator.value();
+        
+        if (e.state == CircuitBreaker::Open) {
+            const qint64 remaining = e.opened + cooldown - now;
+            
+            if (remaining <= 0) {
+                e.state = CircuitBreaker::HalfOpen;
+                e.probing = false;
+                halfOpened << iterator.key();
+            }
+            else if ((next < 0) || (remaining < next)) {
+                next = remaining;
+            }
+        }
+    }
+    
+    if (next >= 0) {
+        timer->start(int(next));
+    }
+    else {
+        timer->stop();
+    }
+    
+    foreach (const QString &endpoint, halfOpened) {
+        emit stateChanged(endpoint, CircuitBreaker::HalfOpen);
+    }
+}
+
+/*!
+    \internal
+    \brief Changes the state of endpoint \a e to \a s, and emits the change.
+    
+    \a e must not be used afterwards, since a connected slot may change the endpoints.
+*/
+void CircuitBreakerStore::setState(const QString &endpoint, CircuitEndpoint &e, CircuitBreaker::State s) {
+    const bool wasOpen = e.state != CircuitBreaker::Closed;
+    e.state = s;
+    e.probing = false;
+    
+    if (s == CircuitBreaker::Open) {
+        e.opened = clock.elapsed();
+    }
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::CircuitBreakerStore::setState" << endpoint << s;
+#endif
+    emit stateChanged(endpoint, s);
+    
+    if (wasOpen != (s != CircuitBreaker::Closed)) {
+        emit openCountChanged(openCount());
+    }
+    
+    if (s == CircuitBreaker::Open) {
+        updateStates();
+    }
+}
+
+}
+
+#include "moc_circuitbreaker.cpp"
+#include "moc_circuitbreaker_p.cpp"
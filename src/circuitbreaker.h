@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_CIRCUITBREAKER_H
+#define CUTERADIO_CIRCUITBREAKER_H
+
+#include "cuteradio_global.h"
+#include <QObject>
+#include <QVariantMap>
+
+namespace CuteRadio {
+
+class CUTERADIOSHARED_EXPORT CircuitBreaker : public QObject
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(int failureThreshold READ failureThreshold WRITE setFailureThreshold NOTIFY failureThresholdChanged)
+    Q_PROPERTY(int cooldown READ cooldown WRITE setCooldown NOTIFY cooldownChanged)
+    Q_PROPERTY(int maximumCacheSize READ maximumCacheSize WRITE setMaximumCacheSize NOTIFY maximumCacheSizeChanged)
+    Q_PROPERTY(int cacheTime READ cacheTime WRITE setCacheTime NOTIFY cacheTimeChanged)
+    Q_PROPERTY(int openCount READ openCount NOTIFY openCountChanged)
+    
+    Q_ENUMS(State)
+    
+public:
+    enum State {
+        Closed = 0,
+        Open,
+        HalfOpen
+    };
+    
+    explicit CircuitBreaker(QObject *parent = 0);
+    
+    int failureThreshold() const;
+    void setFailureThreshold(int failures);
+    
+    int cooldown() const;
+    void setCooldown(int cooldown);
+    
+    int maximumCacheSize() const;
+    void setMaximumCacheSize(int size);
+    
+    int cacheTime() const;
+    void setCacheTime(int time);
+    
+    int openCount() const;
+    
+    Q_INVOKABLE int state(const QString &url) const;
+    
+    Q_INVOKABLE QVariantMap endpoint(const QString &url) const;
+    Q_INVOKABLE QVariantList endpoints() const;
+    
+public Q_SLOTS:
+    void reset();
+    void resetEndpoint(const QString &url);
+    void clearCache();
+    
+Q_SIGNALS:
+    void failureThresholdChanged();
+    void cooldownChanged();
+    void maximumCacheSizeChanged();
+    void cacheTimeChanged();
+    void openCountChanged(int count);
+    void stateChanged(const QString &endpoint, int state);
+    
+private:
+    Q_DISABLE_COPY(CircuitBreaker)
+};
+
+}
+
+#endif // CUTERADIO_CIRCUITBREAKER_H
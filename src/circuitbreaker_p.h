@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_CIRCUITBREAKER_P_H
+#define CUTERADIO_CIRCUITBREAKER_P_H
+
+#include "circuitbreaker.h"
+#include <QCache>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QNetworkReply>
+
+class QTimer;
+class QUrl;
+
+namespace CuteRadio {
+
+/*!
+    \internal
+    \brief The breaker state of one endpoint.
+    
+    Only endpoints that have failed since their last success have an entry.
+*/
+class CircuitEndpoint
+{
+
+public:
+    CircuitEndpoint() :
+        state(CircuitBreaker::Closed),
+        failures(0),
+        opened(0),
+        probing(false),
+        probeStarted(0),
+        rejectedCount(0),
+        cachedCount(0)
+    {
+    }
+    
+    CircuitBreaker::State state;
+    int failures;
+    qint64 opened;
+    bool probing;
+    qint64 probeStarted;
+    int rejectedCount;
+    int cachedCount;
+};
+
+/*!
+    \internal
+    \brief A cached GET result, served while the circuit of its endpoint is open.
+*/
+class CachedResponse
+{
+
+public:
+    QVariant result;
+    qint64 expires;
+};
+
+/*!
+    \internal
+    \brief The process-wide circuit breaker used by every Request and PagesRequest.
+    
+    The breaker only exists once a CircuitBreaker has been created, so requests do not pay for it otherwise.
+*/
+class CircuitBreakerStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static CircuitBreakerStore* instance();
+    static CircuitBreakerStore* existingInstance();
+    
+    static QString endpointOf(const QUrl &url);
+    
+    ~CircuitBreakerStore();
+    
+    bool allow(const QUrl &url);
+    void record(const QUrl &url, QNetworkReply::NetworkError e);
+    
+    bool cachedResponse(const QUrl &url, QVariant *result);
+    void storeResponse(const QUrl &url, const QVariant &result);
+    
+    void reset();
+    void reset(const QString &endpoint);
+    
+    int openCount() const;
+    
+    QVariantMap endpointInfo(const QString &endpoint) const;
+    
+    int failureThreshold;
+    int cooldown;
+    int cacheTime;
+    
+    QHash<QString, CircuitEndpoint> endpoints;
+    
+    // The cost of each response is its approximate size in bytes.
+    QCache<QString, CachedResponse> responses;
+    
+    QTimer *timer;
+    
+    QElapsedTimer clock;
+
+Q_SIGNALS:
+    void openCountChanged(int count);
+    void stateChanged(const QString &endpoint, int state);
+
+public Q_SLOTS:
+    void updateStates();
+
+private:
+    CircuitBreakerStore();
+    
+    void setState(const QString &endpoint, CircuitEndpoint &e, CircuitBreaker::State s);
+    
+    void removeResponses(const QString &endpoint);
+    void removeExpiredResponses();
+    
+    static CircuitBreakerStore *self;
+};
+
+}
+
+#endif // CUTERADIO_CIRCUITBREAKER_P_H
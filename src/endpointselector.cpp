@@ -0,0 +1,635 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "endpointselector.h"
+#include "endpointselector_p.h"
+#include "request_p.h"
+#include "streamprober_p.h"
+#include "urls.h"
+#include <QCoreApplication>
+#include <QRegExp>
+#include <QTimer>
+#ifdef CUTERADIO_DEBUG
+#include <QDebug>
+#endif
+
+namespace CuteRadio {
+
+static const int DEFAULT_PROBE_INTERVAL = 300000;
+static const int DEFAULT_PROBE_TIMEOUT = 5000;
+
+static QString normalizedEndpoint(const QString &url) {
+    QString endpoint = url.trimmed();
+    
+    while (endpoint.endsWith('/')) {
+        endpoint.chop(1);
+    }
+    
+    return endpoint;
+}
+
+static bool isUnder(const QUrl &url, const QUrl &base) {
+    return (url.host().compare(base.host(), Qt::CaseInsensitive) == 0)
+        && (url.scheme().compare(base.scheme(), Qt::CaseInsensitive) == 0)
+        && (url.port() == base.port()) && (pathHasPrefix(url.path(), base.path()));
+}
+
+/*!
+    \class EndpointSelector
+    \brief Chooses the API endpoint that requests are sent to.
+    
+    \ingroup requests
+    
+    By default, all requests to the cuteRadio Data API go to one endpoint. EndpointSelector lets requests be 
+    spread across a set of mirrors instead. Each endpoint is the base url of the API, such as 
+    "http://marxoft.co.uk/api/cuteradio", and every ResourcesRequest, PagesRequest and model builds its urls from 
+    the currentEndpoint.
+    
+    Every probeInterval milliseconds, each endpoint is sent a HEAD request, and the healthy endpoint with the 
+    lowest latency is selected. To avoid switching back and forth between mirrors with similar latencies, another 
+    endpoint only replaces a healthy current endpoint if it is at least 20% faster. Latencies are smoothed over 
+    several probes.
+    
+    If a request to the current endpoint fails to connect, or the server responds with a server error, the 
+    endpoint is marked unhealthy and the next healthy endpoint is selected straight away. GET and HEAD requests 
+    that failed this way are sent once more to the new endpoint before they finish. An unhealthy endpoint is used 
+    again once a probe or request to it succeeds.
+    
+    All EndpointSelector objects share one set of endpoints, which applies to the whole process. Before an 
+    EndpointSelector is created, the endpoints are read from the CUTERADIO_API_URL environment variable, which 
+    may contain several urls separated by commas, or are API_URL if it is not set. This can be used to point 
+    applications and tests at a local server without changing them.
+    
+    Example usage:
+    
+    \code
+    using namespace CuteRadio;
+    
+    ...
+    
+    EndpointSelector *selector = new EndpointSelector(this);
+    selector->setEndpoints(QStringList() << "http://marxoft.co.uk/api/cuteradio"
+                                         << "http://eu.example.com/api/cuteradio"
+                                         << "http://us.example.com/api/cuteradio");
+    \endcode
+*/
+EndpointSelector::EndpointSelector(QObject *parent) :
+    QObject(parent)
+{
+    EndpointStore *store = EndpointStore::instance();
+    connect(store, SIGNAL(endpointsChanged()), this, SIGNAL(endpointsChanged()));
+    connect(store, SIGNAL(currentEndpointChanged(QString)), this, SIGNAL(currentEndpointChanged(QString)));
+    connect(store, SIGNAL(probed(QString, int)), this, SIGNAL(probed(QString, int)));
+}
+
+/*!
+    \property QStringList EndpointSelector::endpoints
+    \brief The base urls of the API endpoints, in order of preference.
+    
+    Endpoints whose latency is not yet known are preferred in this order.
+*/
+QStringList EndpointSelector::endpoints() const {
+    return EndpointStore::instance()->endpointUrls();
+}
+
+void EndpointSelector::setEndpoints(const QStringList &urls) {
+    EndpointStore::instance()->setEndpoints(urls);
+}
+
+/*!
+    \property QString EndpointSelector::currentEndpoint
+    \brief The base url that requests are currently sent to.
+*/
+QString EndpointSelector::currentEndpoint() const {
+    return EndpointStore::instance()->current;
+}
+
+/*!
+    \property int EndpointSelector::probeInterval
+    \brief The time in milliseconds between latency probes.
+    
+    The default value is 300000 (5 minutes). Setting it to 0 disables periodic probes, so that endpoints are only 
+    probed when probe() is called. Endpoints are never probed while there is only one.
+*/
+int EndpointSelector::probeInterval() const {
+    return EndpointStore::instance()->probeInterval;
+}
+
+void EndpointSelector::setProbeInterval(int interval) {
+    EndpointStore *store = EndpointStore::instance();
+    interval = qMax(0, interval);
+    
+    if (interval != store->probeInterval) {
+        store->probeInterval = interval;
+        store->restartTimer();
+        emit probeIntervalChanged();
+    }
+}
+
+/*!
+    \property int EndpointSelector::probeTimeout
+    \brief The time in milliseconds after which a probe is canceled and its endpoint is unhealthy.
+    
+    The default value is 5000.
+*/
+int EndpointSelector::probeTimeout() const {
+    return EndpointStore::instance()->probeTimeout;
+}
+
+void EndpointSelector::setProbeTimeout(int timeout) {
+    EndpointStore *store = EndpointStore::instance();
+    timeout = qMax(1, timeout);
+    
+    if (timeout != store->probeTimeout) {
+        store->probeTimeout = timeout;
+        emit probeTimeoutChanged();
+    }
+}
+
+/*!
+    \brief Returns false if the last probe of or request to \a endpoint failed.
+*/
+bool EndpointSelector::isHealthy(const QString &endpoint) const {
+    const EndpointStore *store = EndpointStore::instance();
+    const int i = store->indexOf(endpoint);
+    return (i >= 0) && (store->endpoints.at(i).healthy);
+}
+
+/*!
+    \brief Returns the smoothed latency of \a endpoint in milliseconds, or -1 if it is not known.
+*/
+int EndpointSelector::latency(const QString &endpoint) const {
+    const EndpointStore *store = EndpointStore::instance();
+    const int i = store->indexOf(endpoint);
+    return i >= 0 ? store->endpoints.at(i).latency : -1;
+}
+
+/*!
+    \brief Returns the state of each endpoint.
+    
+    Each map contains the endpoint, whether it is healthy, its latency, the number of consecutive failures, and 
+    whether it is current.
+*/
+QVariantList EndpointSelector::status() const {
+    const EndpointStore *store = EndpointStore::instance();
+    QVariantList list;
+    
+    for (int i = 0; i < store->endpoints.size(); i++) {
+        list << store->endpointInfo(i);
+    }
+    
+    return list;
+}
+
+/*!
+    \brief Probes all endpoints now.
+    
+    \sa probed()
+*/
+void EndpointSelector::probe() {
+    EndpointStore::instance()->probe();
+}
+
+/*!
+    \fn void EndpointSelector::probed(const QString &endpoint, int latency)
+    \brief Emitted when \a endpoint has been probed.
+    
+    \a latency is -1 if the endpoint is unhealthy.
+*/
+
+EndpointStore* EndpointStore::self = 0;
+
+EndpointStore::EndpointStore() :
+    QObject(QCoreApplication::instance()),
+    probeInterval(DEFAULT_PROBE_INTERVAL),
+    probeTimeout(DEFAULT_PROBE_TIMEOUT),
+    timer(new QTimer(this))
+{
+    connect(timer, SIGNAL(timeout()), this, SLOT(probe()));
+    setEndpoints(defaultEndpoints());
+}
+
+EndpointStore::~EndpointStore() {
+    if (self == this) {
+        self = 0;
+    }
+}
+
+/*!
+    \internal
+    \brief Returns the endpoint set, creating it if required.
+    
+    The endpoint set is owned by the application object.
+*/
+EndpointStore* EndpointStore::instance() {
+    if (!self) {
+        self = new EndpointStore;
+    }
+    
+    return self;
+}
+
+/*!
+    \internal
+    \brief Returns the endpoint set if it exists, otherwise 0.
+*/
+EndpointStore* EndpointStore::existingInstance() {
+    return self;
+}
+
+/*!
+    \internal
+    \brief Returns the endpoints from the CUTERADIO_API_URL environment variable, or API_URL if it is not set.
+*/
+QStringList EndpointStore::defaultEndpoints() {
+    QStringList urls;
+    const QByteArray env = qgetenv("CUTERADIO_API_URL");
+    
+    if (!env.isEmpty()) {
+        foreach (const QString &url, QString::fromUtf8(env).split(QRegExp("[,\\s]+"), QString::SkipEmptyParts)) {
+            urls << normalizedEndpoint(url);
+        }
+    }
+    
+    if (urls.isEmpty()) {
+        urls << API_URL;
+    }
+    
+    return urls;
+}
+
+/*!
+    \internal
+    \brief Returns the base url that API requests should be sent to.
+*/
+QString EndpointStore::apiUrl() {
+    if (self) {
+        return self->current;
+    }
+    
+    static const QString url = defaultEndpoints().first();
+    return url;
+}
+
+/*!
+    \internal
+    \brief Returns the path of \a url relative to the endpoint it belongs to, or a null string if it does not 
+    belong to one.
+*/
+QString EndpointStore::resourcePath(const QUrl &url) {
+    if (self) {
+        const int i = self->indexOf(url);
+        return i >= 0 ? url.path().mid(self->endpoints.at(i).base.path().size()) : QString();
+    }
+    
+    static const QUrl base(apiUrl());
+    return isUnder(url, base) ? url.path().mid(base.path().size()) : QString();
+}
+
+/*!
+    \internal
+    \brief Replaces the endpoints with \a urls.
+    
+    The health and latency of endpoints that are in both the old and new sets are kept.
+*/
+void EndpointStore::setEndpoints(const QStringList &urls) {
+    QList<EndpointState> states;
+    
+    foreach (const QString &url, urls) {
+        const QString endpoint = normalizedEndpoint(url);
+        
+        if (endpoint.isEmpty()) {
+            continue;
+        }
+        
+        bool duplicate = false;
+        
+        foreach (const EndpointState &state, states) {
+            if (state.url == endpoint) {
+                duplicate = true;
+                break;
+            }
+        }
+        
+        if (duplicate) {
+            continue;
+        }
+        
+        const int i = indexOf(endpoint);
+        
+        if (i >= 0) {
+            states << endpoints.at(i);
+        }
+        else {
+            EndpointState state;
+            state.url = endpoint;
+            state.base = QUrl(endpoint);
+            state.healthy = true;
+            state.latency = -1;
+            state.failures = 0;
+            states << state;
+        }
+    }
+    
+    if (states.isEmpty()) {
+        return;
+    }
+    
+    abortProbes();
+    endpoints = states;
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::EndpointStore::setEndpoints" << endpointUrls();
+#endif
+    select();
+    restartTimer();
+    emit endpointsChanged();
+    
+    if (endpoints.size() > 1) {
+        QMetaObject::invokeMethod(this, "probe", Qt::QueuedConnection);
+    }
+}
+
+QStringList EndpointStore::endpointUrls() const {
+    QStringList urls;
+    
+    foreach (const EndpointState &state, endpoints) {
+        urls << state.url;
+    }
+    
+    return urls;
+}
+
+/*!
+    \internal
+    \brief Returns the index of the endpoint that \a url belongs to, or -1 if there is none.
+*/
+int EndpointStore::indexOf(const QUrl &url) const {
+    for (int i = 0; i < endpoints.size(); i++) {
+        if (isUnder(url, endpoints.at(i).base)) {
+            return i;
+        }
+    }
+    
+    return -1;
+}
+
+int EndpointStore::indexOf(const QString &endpoint) const {
+    const QString url = normalizedEndpoint(endpoint);
+    
+    for (int i = 0; i < endpoints.size(); i++) {
+        if (endpoints.at(i).url == url) {
+            return i;
+        }
+    }
+    
+    return -1;
+}
+
+/*!
+    \internal
+    \brief Returns \a url moved to the current endpoint, or an empty url if it belongs to the current endpoint or 
+    to none.
+*/
+QUrl EndpointStore::rebase(const QUrl &url) const {
+    const int i = indexOf(url);
+    
+    if ((i < 0) || (endpoints.at(i).url == current)) {
+        return QUrl();
+    }
+    
+    const QUrl base(current);
+    QUrl u(url);
+    u.setScheme(base.scheme());
+    u.setHost(base.host());
+    u.setPort(base.port());
+    u.setPath(base.path() + url.path().mid(endpoints.at(i).base.path().size()));
+    return u;
+}
+
+/*!
+    \internal
+    \brief Records whether a request to \a url \a failed, selecting another endpoint if it did.
+    
+    \sa isEndpointFailure()
+*/
+void EndpointStore::record(const QUrl &url, bool failed) {
+    const int i = indexOf(url);
+    
+    if (i < 0) {
+        return;
+    }
+    
+    EndpointState &state = endpoints[i];
+    
+    if (failed) {
+        state.failures++;
+        
+        if (state.healthy) {
+#ifdef CUTERADIO_DEBUG
+            qDebug() << "CuteRadio::EndpointStore::record: Endpoint failed" << state.url;
+#endif
+            state.healthy = false;
+            select();
+        }
+    }
+    else {
+        state.failures = 0;
+        
+        if (!state.healthy) {
+            state.healthy = true;
+            select();
+        }
+    }
+}
+
+void EndpointStore::restartTimer() {
+    if ((probeInterval > 0) && (endpoints.size() > 1)) {
+        timer->start(probeInterval);
+    }
+    else {
+        timer->stop();
+    }
+}
+
+QVariantMap EndpointStore::endpointInfo(int i) const {
+    const EndpointState &state = endpoints.at(i);
+    QVariantMap info;
+    info["endpoint"] = state.url;
+    info["healthy"] = state.healthy;
+    info["latency"] = state.latency;
+    info["failures"] = state.failures;
+    info["current"] = state.url == current;
+    return info;
+}
+
+/*!
+    \internal
+    \brief Sends a HEAD request to each endpoint that is not already being probed.
+*/
+void EndpointStore::probe() {
+    if (endpoints.size() < 2) {
+        return;
+    }
+    
+    foreach (const EndpointState &state, endpoints) {
+        bool probing = false;
+        
+        foreach (SourceProbe *p, probes) {
+            if (p->source == state.url) {
+                probing = true;
+                break;
+            }
+        }
+        
+        if (probing) {
+            continue;
+        }
+        
+        SourceProbe *p = new SourceProbe(this);
+        connect(p, SIGNAL(finished(CuteRadio::Request*)), this, SLOT(onProbeFinished(CuteRadio::Request*)));
+        connect(p->timer, SIGNAL(timeout()), this, SLOT(onProbeTimeout()));
+        probes << p;
+        p->start(state.url, probeTimeout);
+    }
+}
+
+void EndpointStore::onProbeFinished(Request *request) {
+    SourceProbe *p = static_cast<SourceProbe*>(request);
+    const int latency = int(p->elapsed.elapsed());
+    
+    if (p->status() == Request::Ready) {
+        finishProbe(p, true, latency);
+    }
+    else if ((p->timedOut) || (p->status() == Request::Canceled)) {
+        finishProbe(p, false, -1);
+    }
+    else if ((p->error() == Request::CircuitOpenError)
+             || (isEndpointFailure(QNetworkReply::NetworkError(p->error())))) {
+        finishProbe(p, false, -1);
+    }
+    else {
+        // The server responded, even if the API root is not a resource.
+        finishProbe(p, true, latency);
+    }
+}
+
+void EndpointStore::onProbeTimeout() {
+    if (QTimer *timer = qobject_cast<QTimer*>(sender())) {
+        SourceProbe *p = static_cast<SourceProbe*>(timer->parent());
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::EndpointStore::onProbeTimeout" << p->source;
+#endif
+        p->timedOut = true;
+        p->cancel();
+    }
+}
+
+/*!
+    \internal
+    \brief Updates the endpoint probed by \a probe, and selects the best endpoint.
+    
+    The latency is a moving average, so that one slow response does not cause a switch.
+*/
+void EndpointStore::finishProbe(SourceProbe *probe, bool healthy, int latency) {
+    probes.removeOne(probe);
+    probe->deleteLater();
+    const int i = indexOf(probe->source);
+    
+    if (i < 0) {
+        return;
+    }
+    
+    EndpointState &state = endpoints[i];
+    state.healthy = healthy;
+    
+    if (healthy) {
+        state.failures = 0;
+        state.latency = state.latency < 0 ? latency : (state.latency * 3 + latency) / 4;
+    }
+    else {
+        state.failures++;
+    }
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::EndpointStore::finishProbe" << state.url << healthy << state.latency;
+#endif
+    const QString endpoint = state.url;
+    const int l = healthy ? state.latency : -1;
+    select();
+    emit probed(endpoint, l);
+}
+
+void EndpointStore::abortProbes() {
+    foreach (SourceProbe *p, probes) {
+        p->disconnect(this);
+        p->cancel();
+        p->deleteLater();
+    }
+    
+    probes.clear();
+}
+
+/*!
+    \internal
+    \brief Makes the best healthy endpoint current.
+    
+    A healthy current endpoint is kept unless another is at least 20% faster. If no endpoint is healthy, the 
+    current endpoint is kept.
+*/
+void EndpointStore::select() {
+    int best = -1;
+    
+    for (int i = 0; i < endpoints.size(); i++) {
+        const EndpointState &state = endpoints.at(i);
+        
+        if (!state.healthy) {
+            continue;
+        }
+        
+        if ((best < 0) || ((state.latency >= 0)
+                           && ((endpoints.at(best).latency < 0) || (state.latency < endpoints.at(best).latency)))) {
+            best = i;
+        }
+    }
+    
+    const int currentIndex = indexOf(current);
+    
+    if (best < 0) {
+        best = currentIndex >= 0 ? currentIndex : 0;
+    }
+    else if ((currentIndex >= 0) && (currentIndex != best) && (endpoints.at(currentIndex).healthy)) {
+        const int currentLatency = endpoints.at(currentIndex).latency;
+        const int bestLatency = endpoints.at(best).latency;
+        
+        if ((bestLatency < 0) || ((currentLatency >= 0) && (bestLatency * 5 > currentLatency * 4))) {
+            best = currentIndex;
+        }
+    }
+    
+    const QString endpoint = endpoints.at(best).url;
+    
+    if (endpoint != current) {
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::EndpointStore::select" << current << endpoint;
+#endif
+        current = endpoint;
+        emit currentEndpointChanged(current);
+    }
+}
+
+}
+
+#include "moc_endpointselector.cpp"
+#include "moc_endpointselector_p.cpp"
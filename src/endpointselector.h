@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_ENDPOINTSELECTOR_H
+#define CUTERADIO_ENDPOINTSELECTOR_H
+
+#include "cuteradio_global.h"
+#include <QObject>
+#include <QStringList>
+#include <QVariantList>
+
+namespace CuteRadio {
+
+class CUTERADIOSHARED_EXPORT EndpointSelector : public QObject
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(QStringList endpoints READ endpoints WRITE setEndpoints NOTIFY endpointsChanged)
+    Q_PROPERTY(QString currentEndpoint READ currentEndpoint NOTIFY currentEndpointChanged)
+    Q_PROPERTY(int probeInterval READ probeInterval WRITE setProbeInterval NOTIFY probeIntervalChanged)
+    Q_PROPERTY(int probeTimeout READ probeTimeout WRITE setProbeTimeout NOTIFY probeTimeoutChanged)
+    
+public:
+    explicit EndpointSelector(QObject *parent = 0);
+    
+    QStringList endpoints() const;
+    void setEndpoints(const QStringList &urls);
+    
+    QString currentEndpoint() const;
+    
+    int probeInterval() const;
+    void setProbeInterval(int interval);
+    
+    int probeTimeout() const;
+    void setProbeTimeout(int timeout);
+    
+    Q_INVOKABLE bool isHealthy(const QString &endpoint) const;
+    Q_INVOKABLE int latency(const QString &endpoint) const;
+    
+    Q_INVOKABLE QVariantList status() const;
+    
+public Q_SLOTS:
+    void probe();
+    
+Q_SIGNALS:
+    void endpointsChanged();
+    void currentEndpointChanged(const QString &endpoint);
+    void probeIntervalChanged();
+    void probeTimeoutChanged();
+    void probed(const QString &endpoint, int latency);
+    
+private:
+    Q_DISABLE_COPY(EndpointSelector)
+};
+
+}
+
+#endif // CUTERADIO_ENDPOINTSELECTOR_H
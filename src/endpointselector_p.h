@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_ENDPOINTSELECTOR_P_H
+#define CUTERADIO_ENDPOINTSELECTOR_P_H
+
+#include "endpointselector.h"
+#include "request.h"
+#include <QNetworkReply>
+#include <QUrl>
+
+class QTimer;
+
+namespace CuteRadio {
+
+class SourceProbe;
+
+/*!
+    \internal
+    \brief The health and latency of one API endpoint.
+*/
+class EndpointState
+{
+
+public:
+    QString url;
+    QUrl base;
+    
+    bool healthy;
+    int latency;
+    int failures;
+};
+
+/*!
+    \internal
+    \brief The process-wide set of API endpoints, and the one that requests are currently sent to.
+    
+    Until an EndpointSelector is created, requests use the first endpoint from the CUTERADIO_API_URL environment 
+    variable, or API_URL.
+*/
+class EndpointStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static EndpointStore* instance();
+    static EndpointStore* existingInstance();
+    
+    static QStringList defaultEndpoints();
+    
+    static QString apiUrl();
+    static QString resourcePath(const QUrl &url);
+    
+    ~EndpointStore();
+    
+    void setEndpoints(const QStringList &urls);
+    QStringList endpointUrls() const;
+    
+    int indexOf(const QUrl &url) const;
+    int indexOf(const QString &endpoint) const;
+    
+    QUrl rebase(const QUrl &url) const;
+    
+    void record(const QUrl &url, bool failed);
+    
+    void restartTimer();
+    
+    QVariantMap endpointInfo(int i) const;
+    
+    QList<EndpointState> endpoints;
+    
+    QString current;
+    
+    int probeInterval;
+    int probeTimeout;
+    
+    QTimer *timer;
+    
+    QList<SourceProbe*> probes;
+
+Q_SIGNALS:
+    void endpointsChanged();
+    void currentEndpointChanged(const QString &endpoint);
+    void probed(const QString &endpoint, int latency);
+
+public Q_SLOTS:
+    void probe();
+
+private Q_SLOTS:
+    void onProbeFinished(CuteRadio::Request *request);
+    void onProbeTimeout();
+
+private:
+    EndpointStore();
+    
+    void finishProbe(SourceProbe *probe, bool healthy, int latency);
+    void abortProbes();
+    void select();
+    
+    static EndpointStore *self;
+};
+
+}
+
+#endif // CUTERADIO_ENDPOINTSELECTOR_P_H
@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "facetindex_p.h"
+
+namespace CuteRadio {
+
+static inline int bitCount(quint32 word) {
+    word = word - ((word >> 1) & 0x55555555);
+    word = (word & 0x33333333) + ((word >> 2) & 0x33333333);
+    return int((((word + (word >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24);
+}
+
+RowBitmap::RowBitmap() :
+    bits(0)
+{
+}
+
+RowBitmap::RowBitmap(int size, bool value) :
+    bits(0)
+{
+    resize(size);
+    
+    if (value) {
+        words.fill(0xffffffff);
+        
+        // Bits beyond the size are kept clear, so that counts are correct.
+        if (bits % 32) {
+            words.last() = (quint32(1) << (bits % 32)) - 1;
+        }
+    }
+}
+
+int RowBitmap::size() const {
+    return bits;
+}
+
+/*!
+    \internal
+    \brief Resizes the bitmap to \a size rows. New rows are not set.
+*/
+void RowBitmap::resize(int size) {
+    if (size < bits) {
+        for (int row = size; row < qMin(bits, (size + 31) / 32 * 32); row++) {
+            setBit(row, false);
+        }
+    }
+    
+    words.resize((size + 31) / 32);
+    
+    for (int i = (bits + 31) / 32; i < words.size(); i++) {
+        words[i] = 0;
+    }
+    
+    bits = size;
+}
+
+bool RowBitmap::testBit(int row) const {
+    return (row >= 0) && (row < bits) && (words.at(row >> 5) & (quint32(1) << (row & 31)));
+}
+
+void RowBitmap::setBit(int row, bool value) {
+    if ((row < 0) || (row >= bits)) {
+        return;
+    }
+    
+    if (value) {
+        words[row >> 5] |= (quint32(1) << (row & 31));
+    }
+    else {
+        words[row >> 5] &= ~(quint32(1) << (row & 31));
+    }
+}
+
+/*!
+    \internal
+    \brief Returns the number of rows that are set.
+*/
+int RowBitmap::count() const {
+    int n = 0;
+    
+    for (int i = 0; i < words.size(); i++) {
+        n += bitCount(words.at(i));
+    }
+    
+    return n;
+}
+
+/*!
+    \internal
+    \brief Returns the number of rows that are set in both this bitmap and \a other.
+*/
+int RowBitmap::countIntersection(const RowBitmap &other) const {
+    const int size = qMin(words.size(), other.words.size());
+    int n = 0;
+    
+    for (int i = 0; i < size; i++) {
+        n += bitCount(words.at(i) & other.words.at(i));
+    }
+    
+    return n;
+}
+
+/*!
+    \internal
+    \brief Returns the rows that are set, in ascending order.
+*/
+QVector<int> RowBitmap::rows() const {
+    QVector<int> result;
+    result.reserve(count());
+    
+    for (int i = 0; i < words.size(); i++) {
+        quint32 word = words.at(i);
+        
+        while (word) {
+            int bit = 0;
+            
+            while (!(word & (quint32(1) << bit))) {
+                bit++;
+            }
+            
+            result << i * 32 + bit;
+            word &= word - 1;
+        }
+    }
+    
+    return result;
+}
+
+RowBitmap& RowBitmap::operator&=(const RowBitmap &other) {
+    for (int i = 0; i < words.size(); i++) {
+        words[i] &= i < other.words.size() ? other.words.at(i) : 0;
+    }
+    
+    return *this;
+}
+
+RowBitmap& RowBitmap::operator|=(const RowBitmap &other) {
+    const int size = qMin(words.size(), other.words.size());
+    
+    for (int i = 0; i < size; i++) {
+        words[i] |= other.words.at(i);
+    }
+    
+    return *this;
+}
+
+FacetIndex::FacetIndex() :
+    rows(0)
+{
+}
+
+QStringList FacetIndex::facets() const {
+    return facetNames;
+}
+
+/*!
+    \internal
+    \brief Sets the indexed properties to \a facets, and clears the index.
+*/
+void FacetIndex::setFacets(const QStringList &facets) {
+    facetNames = facets;
+    clear();
+}
+
+int FacetIndex::rowCount() const {
+    return rows;
+}
+
+void FacetIndex::clear() {
+    columns.clear();
+    
+    foreach (const QString &facet, facetNames) {
+        columns.insert(facet, FacetColumn());
+    }
+    
+    rows = 0;
+}
+
+/*!
+    \internal
+    \brief Adds \a item as the next row.
+*/
+void FacetIndex::appendRow(const QVariantMap &item) {
+    const int row = rows++;
+    QHash<QString, FacetColumn>::iterator iterator = columns.begin();
+    
+    while (iterator != columns.end()) {
+        FacetColumn &column = iterator.value();
+        column.rowCodes.append(-1);
+        
+        // Bitmaps grow a word at a time, rather than once for each row.
+        if (row % 32 == 0) {
+            for (int i = 0; i < column.bitmaps.size(); i++) {
+                column.bitmaps[i].resize(row + 32);
+            }
+        }
+        
+        setValue(column, row, item.value(iterator.key()));
+        ++iterator;
+    }
+}
+
+/*!
+    \internal
+    \brief Replaces the values of \a row with those of \a item.
+    
+    Returns true if any value changed.
+*/
+bool FacetIndex::updateRow(int row, const QVariantMap &item) {
+    if ((row < 0) || (row >= rows)) {
+        return false;
+    }
+    
+    bool changed = false;
+    QHash<QString, FacetColumn>::iterator iterator = columns.begin();
+    
+    while (iterator != columns.end()) {
+        changed |= setValue(iterator.value(), row, item.value(iterator.key()));
+        ++iterator;
+    }
+    
+    return changed;
+}
+
+/*!
+    \internal
+    \brief Returns the distinct values of \a facet, in the order they were first seen.
+*/
+QStringList FacetIndex::values(const QString &facet) const {
+    return columns.value(facet).values;
+}
+
+/*!
+    \internal
+    \brief Returns the rows whose \a facet has any of \a values.
+*/
+RowBitmap FacetIndex::match(const QString &facet, const QStringList &values) const {
+    RowBitmap result(rows);
+    QHash<QString, FacetColumn>::const_iterator iterator = columns.constFind(facet);
+    
+    if (iterator == columns.constEnd()) {
+        return result;
+    }
+    
+    const FacetColumn &column = iterator.value();
+    
+    foreach (const QString &value, values) {
+        const int code = column.codes.value(value, -1);
+        
+        if (code != -1) {
+            result |= column.bitmaps.at(code);
+        }
+    }
+    
+    return result;
+}
+
+/*!
+    \internal
+    \brief Returns a bitmap with every row set.
+*/
+RowBitmap FacetIndex::all() const {
+    return RowBitmap(rows, true);
+}
+
+/*!
+    \internal
+    \brief Returns the number of rows in \a rows that have each value of \a facet.
+    
+    Values with no rows are not included.
+*/
+QVariantMap FacetIndex::counts(const QString &facet, const RowBitmap &rows) const {
+    QVariantMap result;
+    QHash<QString, FacetColumn>::const_iterator iterator = columns.constFind(facet);
+    
+    if (iterator == columns.constEnd()) {
+        return result;
+    }
+    
+    const FacetColumn &column = iterator.value();
+    
+    for (int i = 0; i < column.values.size(); i++) {
+        const int n = column.bitmaps.at(i).countIntersection(rows);
+        
+        if (n > 0) {
+            result[column.values.at(i)] = n;
+        }
+    }
+    
+    return result;
+}
+
+bool FacetIndex::setValue(FacetColumn &column, int row, const QVariant &value) {
+    const QString s = value.toString();
+    int code = -1;
+    
+    if (!s.isEmpty()) {
+        code = column.codes.value(s, -1);
+        
+        if (code == -1) {
+            code = column.values.size();
+            column.codes.insert(s, code);
+            column.values << s;
+            column.bitmaps.append(RowBitmap((rows + 31) / 32 * 32));
+        }
+    }
+    
+    const int old = column.rowCodes.at(row);
+    
+    if (old == code) {
+        return false;
+    }
+    
+    if (old != -1) {
+        column.bitmaps[old].setBit(row, false);
+    }
+    
+    if (code != -1) {
+        column.bitmaps[code].setBit(row, true);
+    }
+    
+    column.rowCodes[row] = code;
+    return true;
+}
+
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_FACETINDEX_P_H
+#define CUTERADIO_FACETINDEX_P_H
+
+#include <QHash>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+
+namespace CuteRadio {
+
+/*!
+    \internal
+    \brief A set of row numbers stored as one bit per row.
+*/
+class RowBitmap
+{
+
+public:
+    RowBitmap();
+    explicit RowBitmap(int size, bool value = false);
+    
+    int size() const;
+    void resize(int size);
+    
+    bool testBit(int row) const;
+    void setBit(int row, bool value = true);
+    
+    int count() const;
+    int countIntersection(const RowBitmap &other) const;
+    
+    QVector<int> rows() const;
+    
+    RowBitmap& operator&=(const RowBitmap &other);
+    RowBitmap& operator|=(const RowBitmap &other);
+    
+private:
+    QVector<quint32> words;
+    int bits;
+};
+
+/*!
+    \internal
+    \brief The rows of each distinct value of one facet.
+    
+    Each row has at most one value, stored as an index into values so that it can be removed from its bitmap 
+    when the row changes.
+*/
+class FacetColumn
+{
+
+public:
+    QStringList values;
+    QHash<QString, int> codes;
+    QVector<RowBitmap> bitmaps;
+    QVector<int> rowCodes;
+};
+
+/*!
+    \internal
+    \brief A bitmap index of the values of several properties (facets) of a list of rows.
+*/
+class FacetIndex
+{
+
+public:
+    FacetIndex();
+    
+    QStringList facets() const;
+    void setFacets(const QStringList &facets);
+    
+    int rowCount() const;
+    
+    void clear();
+    
+    void appendRow(const QVariantMap &item);
+    bool updateRow(int row, const QVariantMap &item);
+    
+    QStringList values(const QString &facet) const;
+    
+    RowBitmap match(const QString &facet, const QStringList &values) const;
+    RowBitmap all() const;
+    
+    QVariantMap counts(const QString &facet, const RowBitmap &rows) const;
+    
+private:
+    bool setValue(FacetColumn &column, int row, const QVariant &value);
+    
+    QStringList facetNames;
+    QHash<QString, FacetColumn> columns;
+    
+    int rows;
+};
+
+}
+
+#endif // CUTERADIO_FACETINDEX_P_H
@@ -0,0 +1,375 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "favourites.h"
+#include "favourites_p.h"
+#include "resourcesrequest.h"
+#include <QCoreApplication>
+#ifdef CUTERADIO_DEBUG
+#include <QDebug>
+#endif
+
+namespace CuteRadio {
+
+static const int FAVOURITES_PAGE_LIMIT = 100;
+
+/*!
+    \class Favourites
+    \brief Provides fast access to the authenticated user's favourite stations.
+    
+    \ingroup requests
+    
+    All Favourites objects share one set of favourite station ids. The set is loaded from the cuteRadio Data API 
+    by calling load(), after which isFavourite() is a constant time lookup and the FavouriteRole of every 
+    StationsModel is taken from the set.
+    
+    setFavourite() updates the set, and the FavouriteRole of each StationsModel that contains the station, 
+    immediately. The change is then written to the server in the background. If the write fails, the change is 
+    reverted and writeFailed() is emitted.
+    
+    Example usage:
+    
+    \code
+    import QtQuick 1.0
+    import CuteRadio 1.0
+    
+    Favourites {
+        id: favourites
+        
+        accessToken: settings.accessToken
+        Component.onCompleted: load()
+        onWriteFailed: infoBanner.show(errorString)
+    }
+    \endcode
+*/
+Favourites::Favourites(QObject *parent) :
+    QObject(parent)
+{
+    FavouritesStore *store = FavouritesStore::instance();
+    connect(store, SIGNAL(accessTokenChanged()), this, SIGNAL(accessTokenChanged()));
+    connect(store, SIGNAL(countChanged(int)), this, SIGNAL(countChanged(int)));
+    connect(store, SIGNAL(loadedChanged()), this, SIGNAL(loadedChanged()));
+    connect(store, SIGNAL(statusChanged(CuteRadio::Request::Status)),
+            this, SIGNAL(statusChanged(CuteRadio::Request::Status)));
+    connect(store, SIGNAL(favouriteChanged(QString, bool)), this, SIGNAL(favouriteChanged(QString, bool)));
+    connect(store, SIGNAL(writeFailed(QString, bool, QString)), this, SIGNAL(writeFailed(QString, bool, QString)));
+}
+
+/*!
+    \property QString Favourites::accessToken
+    \brief The access token used to load and write favourites.
+    
+    The access token is shared by all Favourites objects. Changing it clears the set.
+*/
+QString Favourites::accessToken() const {
+    return FavouritesStore::instance()->accessToken;
+}
+
+void Favourites::setAccessToken(const QString &token) {
+    FavouritesStore::instance()->setAccessToken(token);
+}
+
+/*!
+    \property int Favourites::count
+    \brief The number of favourite stations.
+*/
+int Favourites::count() const {
+    return FavouritesStore::instance()->ids.size();
+}
+
+/*!
+    \property bool Favourites::loaded
+    \brief Whether the favourites have been loaded from the server.
+*/
+bool Favourites::isLoaded() const {
+    return FavouritesStore::instance()->loaded;
+}
+
+/*!
+    \property enum Favourites::status
+    \brief The status of loading the favourites.
+    
+    \sa Request::status
+*/
+Request::Status Favourites::status() const {
+    return FavouritesStore::instance()->status;
+}
+
+/*!
+    \brief Returns true if the station with \a stationId is a favourite.
+*/
+bool Favourites::isFavourite(const QString &stationId) const {
+    return FavouritesStore::instance()->contains(stationId);
+}
+
+/*!
+    \brief Adds the station with \a stationId to the favourites if \a favourite is true, or removes it otherwise.
+    
+    The change takes effect at once, and is written to the server in the background.
+    
+    \sa writeFailed()
+*/
+void Favourites::setFavourite(const QString &stationId, bool favourite) {
+    FavouritesStore::instance()->setFavourite(stationId, favourite);
+}
+
+/*!
+    \brief Loads the favourite stations from the server, following next links until every page is loaded.
+    
+    Changes that have not yet been written to the server are kept.
+*/
+void Favourites::load() {
+    FavouritesStore::instance()->load();
+}
+
+/*!
+    \fn void Favourites::favouriteChanged(const QString &stationId, bool favourite)
+    \brief Emitted when a station is added to or removed from the favourites.
+*/
+
+/*!
+    \fn void Favourites::writeFailed(const QString &stationId, bool favourite, const QString &errorString)
+    \brief Emitted when a change could not be written to the server and has been reverted.
+*/
+
+FavouritesStore* FavouritesStore::self = 0;
+
+FavouritesStore::FavouritesStore() :
+    QObject(QCoreApplication::instance()),
+    loader(0),
+    status(Request::Null),
+    loaded(false)
+{
+}
+
+FavouritesStore::~FavouritesStore() {
+    if (self == this) {
+        self = 0;
+    }
+}
+
+/*!
+    \internal
+    \brief Returns the store, creating it if required.
+    
+    The store is owned by the application object.
+*/
+FavouritesStore* FavouritesStore::instance() {
+    if (!self) {
+        self = new FavouritesStore;
+    }
+    
+    return self;
+}
+
+/*!
+    \internal
+    \brief Returns the store if it exists and has been loaded, otherwise 0.
+*/
+FavouritesStore* FavouritesStore::loadedInstance() {
+    return (self) && (self->loaded) ? self : 0;
+}
+
+bool FavouritesStore::contains(const QString &id) const {
+    return ids.contains(id);
+}
+
+void FavouritesStore::setAccessToken(const QString &token) {
+    if (token == accessToken) {
+        return;
+    }
+    
+    accessToken = token;
+    
+    if (loader) {
+        loader->cancel();
+    }
+    
+    foreach (ResourcesRequest *request, writes) {
+        request->disconnect(this);
+        request->cancel();
+        request->deleteLater();
+    }
+    
+    writes.clear();
+    confirmed.clear();
+    ids.clear();
+    loadingIds.clear();
+    const bool wasLoaded = loaded;
+    loaded = false;
+    emit accessTokenChanged();
+    emit countChanged(0);
+    emit favouritesReset();
+    
+    if (wasLoaded) {
+        emit loadedChanged();
+    }
+}
+
+void FavouritesStore::load() {
+    if (status == Request::Loading) {
+        return;
+    }
+    
+    if (!loader) {
+        loader = new ResourcesRequest(this);
+        connect(loader, SIGNAL(finished(CuteRadio::Request*)), this, SLOT(onLoaderFinished()));
+    }
+    
+    QVariantMap filters;
+    filters["limit"] = FAVOURITES_PAGE_LIMIT;
+    loadingIds.clear();
+    loader->setAccessToken(accessToken);
+    loader->get("/favourites", filters);
+    setStatus(Request::Loading);
+}
+
+void FavouritesStore::setFavourite(const QString &id, bool favourite) {
+    if ((id.isEmpty()) || (contains(id) == favourite)) {
+        return;
+    }
+    
+    if (!confirmed.contains(id)) {
+        confirmed[id] = !favourite;
+    }
+    
+    change(id, favourite);
+    
+    if (!writes.contains(id)) {
+        write(id, favourite);
+    }
+}
+
+void FavouritesStore::setStatus(Request::Status s) {
+    if (s != status) {
+        status = s;
+        emit statusChanged(s);
+    }
+}
+
+void FavouritesStore::write(const QString &id, bool favourite) {
+    ResourcesRequest *request = new ResourcesRequest(this);
+    request->setAccessToken(accessToken);
+    connect(request, SIGNAL(finished(CuteRadio::Request*)), this, SLOT(onWriteFinished(CuteRadio::Request*)));
+    writes[id] = request;
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::FavouritesStore::write" << id << favourite;
+#endif
+    if (favourite) {
+        QVariantMap resource;
+        resource["stationId"] = id;
+        request->insert(resource, "/favourites");
+    }
+    else {
+        request->del("/favourites/" + id);
+    }
+}
+
+void FavouritesStore::change(const QString &id, bool favourite) {
+    if (favourite) {
+        ids.insert(id);
+    }
+    else {
+        ids.remove(id);
+    }
+    
+    emit favouriteChanged(id, favourite);
+    emit countChanged(ids.size());
+}
+
+void FavouritesStore::onLoaderFinished() {
+    if (loader->status() != Request::Ready) {
+        loadingIds.clear();
+        setStatus(loader->status());
+        return;
+    }
+    
+    const QVariantMap result = loader->result().toMap();
+    
+    foreach (const QVariant &item, result.value("items").toList()) {
+        loadingIds.insert(item.toMap().value("id").toString());
+    }
+    
+    const QString next = result.value("next").toString();
+    
+    if (!next.isEmpty()) {
+        loader->get(next);
+        return;
+    }
+    
+    // Changes that are not yet confirmed by the server take precedence over the loaded state.
+    QHashIterator<QString, bool> iterator(confirmed);
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        
+        if (ids.contains(iterator.key())) {
+            loadingIds.insert(iterator.key());
+        }
+        else {
+            loadingIds.remove(iterator.key());
+        }
+    }
+    
+    ids = loadingIds;
+    loadingIds.clear();
+    const bool wasLoaded = loaded;
+    loaded = true;
+    emit countChanged(ids.size());
+    emit favouritesReset();
+    
+    if (!wasLoaded) {
+        emit loadedChanged();
+    }
+    
+    setStatus(Request::Ready);
+}
+
+void FavouritesStore::onWriteFinished(Request *request) {
+    const QString id = writes.key(static_cast<ResourcesRequest*>(request));
+    const bool written = (request->operation() == Request::PostOperation);
+    writes.remove(id);
+    request->deleteLater();
+    
+    if (request->status() == Request::Ready) {
+        if (contains(id) == written) {
+            confirmed.remove(id);
+        }
+        else {
+            // Changed again while the write was in progress.
+            confirmed[id] = written;
+            write(id, contains(id));
+        }
+        
+        return;
+    }
+    
+    const bool server = confirmed.take(id);
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::FavouritesStore::onWriteFinished: Write failed" << id << written
+             << request->errorString();
+#endif
+    if (contains(id) != server) {
+        change(id, server);
+    }
+    
+    emit writeFailed(id, written, request->errorString());
+}
+
+}
+
+#include "moc_favourites.cpp"
+#include "moc_favourites_p.cpp"
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_FAVOURITES_H
+#define CUTERADIO_FAVOURITES_H
+
+#include "request.h"
+
+namespace CuteRadio {
+
+class CUTERADIOSHARED_EXPORT Favourites : public QObject
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(QString accessToken READ accessToken WRITE setAccessToken NOTIFY accessTokenChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(bool loaded READ isLoaded NOTIFY loadedChanged)
+    Q_PROPERTY(CuteRadio::Request::Status status READ status NOTIFY statusChanged)
+    
+public:
+    explicit Favourites(QObject *parent = 0);
+    
+    QString accessToken() const;
+    void setAccessToken(const QString &token);
+    
+    int count() const;
+    
+    bool isLoaded() const;
+    
+    Request::Status status() const;
+    
+    Q_INVOKABLE bool isFavourite(const QString &stationId) const;
+    Q_INVOKABLE void setFavourite(const QString &stationId, bool favourite);
+    
+public Q_SLOTS:
+    void load();
+    
+Q_SIGNALS:
+    void accessTokenChanged();
+    void countChanged(int count);
+    void loadedChanged();
+    void statusChanged(CuteRadio::Request::Status s);
+    void favouriteChanged(const QString &stationId, bool favourite);
+    void writeFailed(const QString &stationId, bool favourite, const QString &errorString);
+    
+private:
+    Q_DISABLE_COPY(Favourites)
+};
+
+}
+
+#endif // CUTERADIO_FAVOURITES_H
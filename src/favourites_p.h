@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_FAVOURITES_P_H
+#define CUTERADIO_FAVOURITES_P_H
+
+#include "favourites.h"
+#include <QHash>
+#include <QSet>
+
+namespace CuteRadio {
+
+class ResourcesRequest;
+
+/*!
+    \internal
+    \brief The process-wide set of favourite station ids shared by every Favourites object and StationsModel.
+    
+    Changes are applied to the set at once and written to the server in the background. While a write is in 
+    progress, later changes to the same station wait for it, and the server state before the first unconfirmed 
+    change is kept so that it can be restored if a write fails.
+*/
+class FavouritesStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static FavouritesStore* instance();
+    static FavouritesStore* loadedInstance();
+    
+    ~FavouritesStore();
+    
+    bool contains(const QString &id) const;
+    
+    void setAccessToken(const QString &token);
+    
+    void load();
+    
+    void setFavourite(const QString &id, bool favourite);
+    
+    QString accessToken;
+    
+    QSet<QString> ids;
+    QSet<QString> loadingIds;
+    
+    QHash<QString, bool> confirmed;
+    QHash<QString, ResourcesRequest*> writes;
+    
+    ResourcesRequest *loader;
+    
+    Request::Status status;
+    
+    bool loaded;
+
+Q_SIGNALS:
+    void accessTokenChanged();
+    void countChanged(int count);
+    void loadedChanged();
+    void statusChanged(CuteRadio::Request::Status s);
+    void favouriteChanged(const QString &id, bool favourite);
+    void favouritesReset();
+    void writeFailed(const QString &id, bool favourite, const QString &errorString);
+
+private Q_SLOTS:
+    void onLoaderFinished();
+    void onWriteFinished(CuteRadio::Request *request);
+
+private:
+    FavouritesStore();
+    
+    void setStatus(Request::Status s);
+    void write(const QString &id, bool favourite);
+    void change(const QString &id, bool favourite);
+    
+    static FavouritesStore *self;
+};
+
+}
+
+#endif // CUTERADIO_FAVOURITES_P_H
@@ -31,177 +31,483 @@
  */
 
 #include "json.h"
+#include <QAtomicInt>
+#include <QIODevice>
+#include <QStringList>
 #include <iostream>
 
 namespace QtJson
 {
 
 
-static QString sanitizeString(QString str)
-{
-        str.replace(QLatin1String("\\"), QLatin1String("\\\\"));
-        str.replace(QLatin1String("\""), QLatin1String("\\\""));
-        str.replace(QLatin1String("\b"), QLatin1String("\\b"));
-        str.replace(QLatin1String("\f"), QLatin1String("\\f"));
-        str.replace(QLatin1String("\n"), QLatin1String("\\n"));
-        str.replace(QLatin1String("\r"), QLatin1String("\\r"));
-        str.replace(QLatin1String("\t"), QLatin1String("\\t"));
-        return QString(QLatin1String("\"%1\"")).arg(str);
-}
-
-static QByteArray join(const QList<QByteArray> &list, const QByteArray &sep)
-{
-        QByteArray res;
-        Q_FOREACH(const QByteArray &i, list)
-        {
-                if(!res.isEmpty())
-                {
-                        res += sep;
-                }
-                res += i;
-        }
-        return res;
-}
-
 /**
- * parse
+ * Size at which a JsonWriter hands its buffer to the output device
  */
-QVariant Json::parse(const QString &json)
-{
-        bool success = true;
-        return Json::parse(json, success);
-}
+static const int WRITER_CHUNK_SIZE = 16384;
 
 /**
- * parse
+ * \class JsonWriter
+ * \brief Serializes a QVariant hierarchy in a single pass
+ *
+ * All output is appended to one growing buffer. If a device is set, the
+ * buffer is written to it and reused whenever it grows past
+ * WRITER_CHUNK_SIZE, so memory use is bounded by the chunk size rather
+ * than by the size of the document.
  */
-QVariant Json::parse(const QString &json, bool &success)
+class JsonWriter
 {
-        success = true;
-
-        //Return an empty QVariant if the JSON data is either null or empty
-        if(!json.isNull() || !json.isEmpty())
-        {
-                QString data = json;
-                //We'll start from index 0
-                int index = 0;
-
-                //Parse the first value
-                QVariant value = Json::parseValue(data, index, success);
-
-                //Return the parsed value
-                return value;
-        }
-        else
+        public:
+                JsonWriter(QByteArray *buffer, QIODevice *device = 0);
+
+                /**
+                 * Appends the JSON representation of data
+                 *
+                 * \return bool The success of the serialization
+                 */
+                bool write(const QVariant &data);
+
+                /**
+                 * Writes any buffered output to the device
+                 *
+                 * \return bool The success of the write
+                 */
+                bool flush();
+
+        private:
+                void writeString(const QString &str);
+                void writeUtf8(const QChar *&p, const QChar *end);
+                void maybeFlush();
+
+                QByteArray *buffer;
+                QIODevice *device;
+                bool ok;
+};
+
+JsonWriter::JsonWriter(QByteArray *buffer, QIODevice *device) :
+        buffer(buffer),
+        device(device),
+        ok(true)
+{
+        if(device)
         {
-                //Return the empty QVariant
-                return QVariant();
+                buffer->reserve(WRITER_CHUNK_SIZE + WRITER_CHUNK_SIZE / 4);
         }
 }
 
-QByteArray Json::serialize(const QVariant &data)
+bool JsonWriter::write(const QVariant &data)
 {
-        bool success = true;
-        return Json::serialize(data, success);
-}
-
-QByteArray Json::serialize(const QVariant &data, bool &success)
-{
-        QByteArray str;
-        success = true;
-
         if(!data.isValid()) // invalid or null?
         {
-                str = "null";
+                buffer->append("null", 4);
+        }
+        else if(data.type() == QVariant::StringList) // variant is a string list?
+        {
+                const QStringList list = data.toStringList();
+                buffer->append("[ ", 2);
+                for(int i = 0; i < list.size(); i++)
+                {
+                        if(i > 0)
+                        {
+                                buffer->append(", ", 2);
+                        }
+                        writeString(list.at(i));
+                        maybeFlush();
+                }
+                buffer->append(" ]", 2);
         }
-        else if((data.type() == QVariant::List) || (data.type() == QVariant::StringList)) // variant is a list?
+        else if(data.type() == QVariant::List) // variant is a list?
         {
-                QList<QByteArray> values;
                 const QVariantList list = data.toList();
-                Q_FOREACH(const QVariant& v, list)
+                buffer->append("[ ", 2);
+                for(int i = 0; i < list.size(); i++)
                 {
-                        QByteArray serializedValue = serialize(v);
-                        if(serializedValue.isNull())
+                        if(i > 0)
                         {
-                                success = false;
-                                break;
+                                buffer->append(", ", 2);
                         }
-                        values << serializedValue;
+                        if(!write(list.at(i)))
+                        {
+                                return false;
+                        }
+                        maybeFlush();
                 }
-
-                str = "[ " + join( values, ", " ) + " ]";
+                buffer->append(" ]", 2);
         }
         else if(data.type() == QVariant::Map) // variant is a map?
         {
                 const QVariantMap vmap = data.toMap();
-                QMapIterator<QString, QVariant> it( vmap );
-                str = "{ ";
-                QList<QByteArray> pairs;
-                while(it.hasNext())
+                QVariantMap::const_iterator it = vmap.constBegin();
+                buffer->append("{ ", 2);
+                while(it != vmap.constEnd())
                 {
-                        it.next();
-                        QByteArray serializedValue = serialize(it.value());
-                        if(serializedValue.isNull())
+                        if(it != vmap.constBegin())
                         {
-                                success = false;
-                                break;
+                                buffer->append(", ", 2);
+                        }
+                        writeString(it.key());
+                        buffer->append(" : ", 3);
+                        if(!write(it.value()))
+                        {
+                                return false;
                         }
-                        pairs << sanitizeString(it.key()).toUtf8() + " : " + serializedValue;
+                        maybeFlush();
+                        ++it;
                 }
-                str += join(pairs, ", ");
-                str += " }";
+                buffer->append(" }", 2);
         }
         else if((data.type() == QVariant::String) || (data.type() == QVariant::ByteArray)) // a string or a byte array?
         {
-                str = sanitizeString(data.toString()).toUtf8();
+                writeString(data.toString());
         }
         else if(data.type() == QVariant::Double) // double?
         {
-                str = QByteArray::number(data.toDouble());
-                if(!str.contains(".") && ! str.contains("e"))
+                const QByteArray number = QByteArray::number(data.toDouble());
+                buffer->append(number);
+                if(!number.contains('.') && !number.contains('e'))
                 {
-                        str += ".0";
+                        buffer->append(".0", 2);
                 }
         }
         else if (data.type() == QVariant::Bool) // boolean value?
         {
-                str = data.toBool() ? "true" : "false";
+                if(data.toBool())
+                {
+                        buffer->append("true", 4);
+                }
+                else
+                {
+                        buffer->append("false", 5);
+                }
         }
         else if (data.type() == QVariant::ULongLong) // large unsigned number?
         {
-                str = QByteArray::number(data.value<qulonglong>());
+                buffer->append(QByteArray::number(data.value<qulonglong>()));
         }
         else if ( data.canConvert<qlonglong>() ) // any signed number?
         {
-                str = QByteArray::number(data.value<qlonglong>());
+                buffer->append(QByteArray::number(data.value<qlonglong>()));
         }
         else if (data.canConvert<long>())
         {
-                str = QString::number(data.value<long>()).toUtf8();
+                buffer->append(QByteArray::number(qlonglong(data.value<long>())));
         }
         else if (data.canConvert<QString>()) // can value be converted to string?
         {
                 // this will catch QDate, QDateTime, QUrl, ...
-                str = sanitizeString(data.toString()).toUtf8();
+                writeString(data.toString());
         }
         else
         {
-                success = false;
+                return false;
+        }
+
+        return ok;
+}
+
+bool JsonWriter::flush()
+{
+        if((device) && (!buffer->isEmpty()))
+        {
+                if(device->write(*buffer) != buffer->size())
+                {
+                        ok = false;
+                }
+
+                buffer->truncate(0);
         }
-        if (success)
+
+        return ok;
+}
+
+void JsonWriter::maybeFlush()
+{
+        if((device) && (buffer->size() >= WRITER_CHUNK_SIZE))
         {
-                return str;
+                flush();
+        }
+}
+
+/**
+ * writeString
+ *
+ * Quotes and escapes str in one scan. The leading run of printable ASCII
+ * that needs no escaping - usually the whole string - is narrowed straight
+ * into the buffer without any intermediate QString or QByteArray.
+ */
+void JsonWriter::writeString(const QString &str)
+{
+        const QChar *p = str.unicode();
+        const QChar *end = p + str.size();
+        const QChar *safe = p;
+
+        while((safe != end) && (safe->unicode() >= 0x20) && (safe->unicode() < 0x80) &&
+              (safe->unicode() != '"') && (safe->unicode() != '\\'))
+        {
+                ++safe;
+        }
+
+        const int offset = buffer->size();
+        buffer->resize(offset + 1 + int(safe - p));
+        char *out = buffer->data() + offset;
+        *out++ = '"';
+
+        while(p != safe)
+        {
+                *out++ = char((p++)->unicode());
+        }
+
+        while(p != end)
+        {
+                const ushort c = p->unicode();
+
+                switch(c)
+                {
+                        case '"':
+                                buffer->append("\\\"", 2);
+                                break;
+                        case '\\':
+                                buffer->append("\\\\", 2);
+                                break;
+                        case '\b':
+                                buffer->append("\\b", 2);
+                                break;
+                        case '\f':
+                                buffer->append("\\f", 2);
+                                break;
+                        case '\n':
+                                buffer->append("\\n", 2);
+                                break;
+                        case '\r':
+                                buffer->append("\\r", 2);
+                                break;
+                        case '\t':
+                                buffer->append("\\t", 2);
+                                break;
+                        default:
+                                if(c < 0x20)
+                                {
+                                        static const char hex[] = "0123456789abcdef";
+                                        const char escaped[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+                                        buffer->append(escaped, 6);
+                                }
+                                else if(c < 0x80)
+                                {
+                                        buffer->append(char(c));
+                                }
+                                else
+                                {
+                                        writeUtf8(p, end);
+                                        continue;
+                                }
+                                break;
+                }
+
+                ++p;
+        }
+
+        buffer->append('"');
+}
+
+/**
+ * writeUtf8
+ *
+ * Encodes the non-ASCII character at p as UTF-8 and advances p past it,
+ * combining surrogate pairs. Unpaired surrogates become U+FFFD.
+ */
+void JsonWriter::writeUtf8(const QChar *&p, const QChar *end)
+{
+        uint c = (p++)->unicode();
+
+        if((c & 0xfc00) == 0xd800)
+        {
+                if((p != end) && ((p->unicode() & 0xfc00) == 0xdc00))
+                {
+                        c = 0x10000 + ((c - 0xd800) << 10) + ((p++)->unicode() - 0xdc00);
+                }
+                else
+                {
+                        c = 0xfffd;
+                }
+        }
+        else if((c & 0xfc00) == 0xdc00)
+        {
+                c = 0xfffd;
+        }
+
+        char bytes[4];
+        int size;
+
+        if(c < 0x800)
+        {
+                bytes[0] = char(0xc0 | (c >> 6));
+                bytes[1] = char(0x80 | (c & 0x3f));
+                size = 2;
+        }
+        else if(c < 0x10000)
+        {
+                bytes[0] = char(0xe0 | (c >> 12));
+                bytes[1] = char(0x80 | ((c >> 6) & 0x3f));
+                bytes[2] = char(0x80 | (c & 0x3f));
+                size = 3;
         }
         else
         {
-                return QByteArray();
+                bytes[0] = char(0xf0 | (c >> 18));
+                bytes[1] = char(0x80 | ((c >> 12) & 0x3f));
+                bytes[2] = char(0x80 | ((c >> 6) & 0x3f));
+                bytes[3] = char(0x80 | (c & 0x3f));
+                size = 4;
         }
+
+        buffer->append(bytes, size);
+}
+
+// Read by parse() in worker and pool threads.
+static QAtomicInt sharedKeysEnabled(0);
+
+Q_GLOBAL_STATIC(JsonKeyTable, globalKeyTable)
+
+JsonKeyTable::JsonKeyTable(JsonKeyTable *shared, bool locked) :
+        shared(shared),
+        locked(locked)
+{
+}
+
+QString JsonKeyTable::intern(const QString &key)
+{
+        QMutexLocker locker(locked ? &mutex : 0);
+        QSet<QString>::const_iterator it = keys.constFind(key);
+
+        if(it != keys.constEnd())
+        {
+                return *it;
+        }
+
+        const QString interned = shared ? shared->intern(key) : key;
+        keys.insert(interned);
+        return interned;
+}
+
+int JsonKeyTable::size() const
+{
+        QMutexLocker locker(locked ? &mutex : 0);
+        return keys.size();
+}
+
+void JsonKeyTable::clear()
+{
+        QMutexLocker locker(locked ? &mutex : 0);
+        keys.clear();
+}
+
+JsonKeyTable* Json::sharedKeyTable()
+{
+        return globalKeyTable();
+}
+
+bool Json::sharedKeyTableEnabled()
+{
+#if QT_VERSION >= 0x050000
+        return sharedKeysEnabled.loadAcquire() != 0;
+#else
+        return sharedKeysEnabled != 0;
+#endif
+}
+
+void Json::setSharedKeyTableEnabled(bool enabled)
+{
+        sharedKeysEnabled.fetchAndStoreOrdered(enabled ? 1 : 0);
+}
+
+/**
+ * parse
+ */
+QVariant Json::parse(const QString &json)
+{
+        bool success = true;
+        return Json::parse(json, success);
+}
+
+/**
+ * parse
+ */
+QVariant Json::parse(const QString &json, bool &success)
+{
+        // The document's own table is only used by this thread, so only the shared table is locked.
+        JsonKeyTable keys(sharedKeyTableEnabled() ? sharedKeyTable() : 0, false);
+        return Json::parse(json, success, &keys);
+}
+
+/**
+ * parse
+ */
+QVariant Json::parse(const QString &json, bool &success, JsonKeyTable *keys)
+{
+        success = true;
+
+        //Return an empty QVariant if the JSON data is either null or empty
+        if(!json.isNull() || !json.isEmpty())
+        {
+                QString data = json;
+                //We'll start from index 0
+                int index = 0;
+
+                //Parse the first value
+                QVariant value = Json::parseValue(data, index, success, keys);
+
+                //Return the parsed value
+                return value;
+        }
+        else
+        {
+                //Return the empty QVariant
+                return QVariant();
+        }
+}
+
+QByteArray Json::serialize(const QVariant &data)
+{
+        bool success = true;
+        return Json::serialize(data, success);
+}
+
+QByteArray Json::serialize(const QVariant &data, bool &success)
+{
+        QByteArray str;
+        success = Json::serialize(data, str);
+        return success ? str : QByteArray();
+}
+
+bool Json::serialize(const QVariant &data, QByteArray &buffer)
+{
+        const int size = buffer.size();
+        JsonWriter writer(&buffer);
+
+        if(!writer.write(data))
+        {
+                buffer.truncate(size);
+                return false;
+        }
+
+        return true;
+}
+
+bool Json::serialize(const QVariant &data, QIODevice *device)
+{
+        if(!device)
+        {
+                return false;
+        }
+
+        QByteArray buffer;
+        JsonWriter writer(&buffer, device);
+        return (writer.write(data)) && (writer.flush());
 }
 
 /**
  * parseValue
  */
-QVariant Json::parseValue(const QString &json, int &index, bool &success)
+QVariant Json::parseValue(const QString &json, int &index, bool &success, JsonKeyTable *keys)
 {
         //Determine what kind of data we should parse by
         //checking out the upcoming token
@@ -212,9 +518,9 @@ QVariant Json::parseValue(const QString &json, int &index, bool &success)
                 case JsonTokenNumber:
                         return Json::parseNumber(json, index);
                 case JsonTokenCurlyOpen:
-                        return Json::parseObject(json, index, success);
+                        return Json::parseObject(json, index, success, keys);
                 case JsonTokenSquaredOpen:
-                        return Json::parseArray(json, index, success);
+                        return Json::parseArray(json, index, success, keys);
                 case JsonTokenTrue:
                         Json::nextToken(json, index);
                         return QVariant(true);
@@ -236,7 +542,7 @@ QVariant Json::parseValue(const QString &json, int &index, bool &success)
 /**
  * parseObject
  */
-QVariant Json::parseObject(const QString &json, int &index, bool &success)
+QVariant Json::parseObject(const QString &json, int &index, bool &success, JsonKeyTable *keys)
 {
         QVariantMap map;
         int token;
@@ -275,6 +581,12 @@ QVariant Json::parseObject(const QString &json, int &index, bool &success)
                                 return QVariantMap();
                         }
 
+                        //Share one copy of each distinct key
+                        if(keys)
+                        {
+                                name = keys->intern(name);
+                        }
+
                         //Get the next token
                         token = Json::nextToken(json, index);
 
@@ -287,7 +599,7 @@ QVariant Json::parseObject(const QString &json, int &index, bool &success)
                         }
 
                         //Parse the key/value pair's value
-                        QVariant value = Json::parseValue(json, index, success);
+                        QVariant value = Json::parseValue(json, index, success, keys);
 
                         if(!success)
                         {
@@ -306,7 +618,7 @@ QVariant Json::parseObject(const QString &json, int &index, bool &success)
 /**
  * parseArray
  */
-QVariant Json::parseArray(const QString &json, int &index, bool &success)
+QVariant Json::parseArray(const QString &json, int &index, bool &success, JsonKeyTable *keys)
 {
         QVariantList list;
 
@@ -333,7 +645,7 @@ QVariant Json::parseArray(const QString &json, int &index, bool &success)
                 }
                 else
                 {
-                        QVariant value = Json::parseValue(json, index, success);
+                        QVariant value = Json::parseValue(json, index, success, keys);
 
                         if(!success)
                         {
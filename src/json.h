@@ -35,6 +35,10 @@
 
 #include <QVariant>
 #include <QString>
+#include <QSet>
+#include <QMutex>
+
+class QIODevice;
 
 namespace QtJson
 {
@@ -58,6 +62,55 @@ enum JsonToken
         JsonTokenNull = 11
 };
 
+/**
+ * \class JsonKeyTable
+ * \brief An intern table for JSON object keys
+ *
+ * Objects parsed with the same JsonKeyTable share one implicitly shared
+ * QString per distinct key, instead of holding a copy of every key of
+ * every object. A table may fall back to a shared table for keys it has
+ * not seen, so that keys are also shared between documents.
+ *
+ * The table grows with the number of distinct keys, so it should not be
+ * used for documents that use arbitrary data as object keys.
+ */
+class JsonKeyTable
+{
+        public:
+                /**
+                 * \param shared An optional table to take keys from
+                 * \param locked Whether the table may be used from several
+                 * threads at once. A table used by only one thread, such as
+                 * the table of a single document, need not be locked.
+                 */
+                explicit JsonKeyTable(JsonKeyTable *shared = 0, bool locked = true);
+
+                /**
+                 * Returns the interned copy of key, adding key if it is
+                 * not yet in the table. This method is thread-safe if the
+                 * table is locked.
+                 */
+                QString intern(const QString &key);
+
+                /**
+                 * Returns the number of distinct keys in the table
+                 */
+                int size() const;
+
+                /**
+                 * Removes all keys from the table
+                 */
+                void clear();
+
+        private:
+                Q_DISABLE_COPY(JsonKeyTable)
+
+                QSet<QString> keys;
+                JsonKeyTable *shared;
+                bool locked;
+                mutable QMutex mutex;
+};
+
 /**
  * \class Json
  * \brief A JSON data parser
@@ -82,6 +135,33 @@ class Json
                  */
                 static QVariant parse(const QString &json, bool &success);
 
+                /**
+                 * Parse a JSON string, interning object keys in keys
+                 *
+                 * \param json The JSON data
+                 * \param success The success of the parsing
+                 * \param keys The key table, or 0 to disable interning
+                 */
+                static QVariant parse(const QString &json, bool &success, JsonKeyTable *keys);
+
+                /**
+                 * Returns the process-wide key table
+                 */
+                static JsonKeyTable* sharedKeyTable();
+
+                /**
+                 * Returns whether parse() interns keys in the process-wide
+                 * key table. By default, keys are only interned within
+                 * each document.
+                 */
+                static bool sharedKeyTableEnabled();
+
+                /**
+                 * Sets whether parse() interns keys in the process-wide key
+                 * table, so that keys are shared between documents
+                 */
+                static void setSharedKeyTableEnabled(bool enabled);
+
                 /**
                 * This method generates a textual JSON representation
                 *
@@ -100,6 +180,32 @@ class Json
                 */
                 static QByteArray serialize(const QVariant &data, bool &success);
 
+                /**
+                * This method appends a textual JSON representation to buffer
+                * in a single pass, without building intermediate byte arrays
+                * for nested lists and maps.
+                *
+                * \param data The JSON data generated by the parser.
+                * \param buffer The buffer to append to. It is left unchanged
+                * if serialization fails.
+                *
+                * \return bool The success of the serialization
+                */
+                static bool serialize(const QVariant &data, QByteArray &buffer);
+
+                /**
+                * This method writes a textual JSON representation to device
+                * in fixed-size chunks, so that large documents can be
+                * exported without holding them in memory.
+                *
+                * \param data The JSON data generated by the parser.
+                * \param device The open device to write to. On failure,
+                * part of the document may already have been written.
+                *
+                * \return bool The success of the serialization
+                */
+                static bool serialize(const QVariant &data, QIODevice *device);
+
         private:
                 /**
                  * Parses a value starting from index
@@ -107,11 +213,12 @@ class Json
                  * \param json The JSON data
                  * \param index The start index
                  * \param success The success of the parse process
+                 * \param keys The key table, or 0
                  *
                  * \return QVariant The parsed value
                  */
                 static QVariant parseValue(const QString &json, int &index,
-                                                                   bool &success);
+                                                                   bool &success, JsonKeyTable *keys);
 
                 /**
                  * Parses an object starting from index
@@ -119,11 +226,12 @@ class Json
                  * \param json The JSON data
                  * \param index The start index
                  * \param success The success of the object parse
+                 * \param keys The key table, or 0
                  *
                  * \return QVariant The parsed object map
                  */
                 static QVariant parseObject(const QString &json, int &index,
-                                                                           bool &success);
+                                                                           bool &success, JsonKeyTable *keys);
 
                 /**
                  * Parses an array starting from index
@@ -131,11 +239,12 @@ class Json
                  * \param json The JSON data
                  * \param index The starting index
                  * \param success The success of the array parse
+                 * \param keys The key table, or 0
                  *
                  * \return QVariant The parsed variant array
                  */
                 static QVariant parseArray(const QString &json, int &index,
-                                                                           bool &success);
+                                                                           bool &success, JsonKeyTable *keys);
 
                 /**
                  * Parses a string starting from index
@@ -67,7 +67,7 @@ QHash<int, QByteArray> Model::roleNames() const {
 int Model::rowCount(const QModelIndex &) const {
     Q_D(const Model);
     
-    return d->items.size();
+    return d->count();
 }
 
 /*!
@@ -102,15 +102,20 @@ QMap<int, QVariant> Model::itemData(const QModelIndex &index) const {
 
 /*!
     \brief Re-implemented from QAbstractListModel::setData()
+    
+    Returns false if the rows can not be changed, such as while a ResourcesModel shows the rows of a snapshot.
 */
 bool Model::setData(const QModelIndex &index, const QVariant &value, int role) {
-    if (!index.isValid()) {
+    Q_D(Model);
+    
+    if ((!index.isValid()) || (d->isReadOnly()) || (index.row() >= d->items.size())) {
         return false;
     }
     
-    Q_D(Model);
-    
-    d->items[index.row()][d->roles.value(role)] = value;
+    const QString property = d->roles.value(role);
+    QVariant &v = d->items[index.row()][property];
+    v = value;
+    d->internValue(property, v);
     emit dataChanged(index, index);
     
     return true;
@@ -118,19 +123,24 @@ bool Model::setData(const QModelIndex &index, const QVariant &value, int role) {
 
 /*!
     \brief Re-implemented from QAbstractListModel::setItemData()
+    
+    Returns false if the rows can not be changed, such as while a ResourcesModel shows the rows of a snapshot.
 */
 bool Model::setItemData(const QModelIndex &index, const QMap<int, QVariant> &roles) {
-    if (!index.isValid()) {
+    Q_D(Model);
+    
+    if ((!index.isValid()) || (d->isReadOnly()) || (index.row() >= d->items.size())) {
         return false;
     }
     
-    Q_D(Model);
-    
     QMapIterator<int, QVariant> iterator(roles);
     
     while (iterator.hasNext()) {
         iterator.next();
-        d->items[index.row()][d->roles.value(iterator.key())] = iterator.value();
+        const QString property = d->roles.value(iterator.key());
+        QVariant &v = d->items[index.row()][property];
+        v = iterator.value();
+        d->internValue(property, v);
     }
     
     emit dataChanged(index, index);
@@ -144,6 +154,10 @@ bool Model::setItemData(const QModelIndex &index, const QMap<int, QVariant> &rol
 void Model::append(const QMap<int, QVariant> &roles) {
     Q_D(Model);
     
+    if (d->isReadOnly()) {
+        return;
+    }
+    
     QVariantMap item;
     QMapIterator<int, QVariant> iterator(roles);
     
@@ -152,9 +166,11 @@ void Model::append(const QMap<int, QVariant> &roles) {
         item[d->roles.value(iterator.key())] = iterator.value();
     }
     
+    d->internValues(item);
     beginInsertRows(QModelIndex(), d->items.size(), d->items.size());
     d->items << item;
     endInsertRows();
+    d->rowsChanged();
     emit countChanged(rowCount());
 }
 
@@ -171,6 +187,10 @@ void Model::insert(const QModelIndex &index, const QMap<int, QVariant> &roles) {
     
     Q_D(Model);
     
+    if ((d->isReadOnly()) || (index.row() >= d->items.size())) {
+        return;
+    }
+    
     QVariantMap item;
     QMapIterator<int, QVariant> iterator(roles);
     
@@ -179,9 +199,11 @@ void Model::insert(const QModelIndex &index, const QMap<int, QVariant> &roles) {
         item[d->roles.value(iterator.key())] = iterator.value();
     }
     
+    d->internValues(item);
     beginInsertRows(QModelIndex(), index.row(), index.row());
     d->items.insert(index.row(), item);
     endInsertRows();
+    d->rowsChanged();
     emit countChanged(rowCount());
 }
 
@@ -191,15 +213,16 @@ void Model::insert(const QModelIndex &index, const QMap<int, QVariant> &roles) {
     Returns true if succesful.
 */
 bool Model::remove(const QModelIndex &index) {
-    if (!index.isValid()) {
+    Q_D(Model);
+    
+    if ((!index.isValid()) || (d->isReadOnly()) || (index.row() >= d->items.size())) {
         return false;
     }
     
-    Q_D(Model);
-    
     beginRemoveRows(QModelIndex(), index.row(), index.row());
     d->items.removeAt(index.row());
     endRemoveRows();
+    d->rowsChanged();
     emit countChanged(rowCount());
     
     return true;
@@ -213,8 +236,33 @@ bool Model::remove(const QModelIndex &index) {
 int Model::find(const QString &property, const QVariant &value) const {
     Q_D(const Model);
     
-    for (int i = 0; i < d->items.size(); i++) {
-        if (get(i).value(property) == value) {
+    QHash<QString, ValueDictionary>::const_iterator dictionary = d->dictionaries.constFind(property);
+    
+    if ((!d->isReadOnly()) && (dictionary != d->dictionaries.constEnd()) && (value.type() == QVariant::String)) {
+        // Equal values of an interned property share storage, so rows can be matched by pointer.
+        const int code = dictionary.value().code(value.toString());
+        
+        if (code == -1) {
+            return -1;
+        }
+        
+        const QChar *interned = dictionary.value().values.at(code).constData();
+        
+        for (int i = 0; i < d->items.size(); i++) {
+            const QVariant v = d->items.at(i).value(property);
+            
+            if ((v.type() == QVariant::String) && (v.toString().constData() == interned)) {
+                return i;
+            }
+        }
+        
+        return -1;
+    }
+    
+    const int count = d->count();
+    
+    for (int i = 0; i < count; i++) {
+        if (d->itemAt(i).value(property) == value) {
             return i;
         }
     }
@@ -222,13 +270,144 @@ int Model::find(const QString &property, const QVariant &value) const {
     return -1;
 }
 
+/*!
+    \brief Returns the names of the properties whose values are interned.
+    
+    \sa setInternedProperties()
+*/
+QStringList Model::internedProperties() const {
+    Q_D(const Model);
+    
+    return d->dictionaries.keys();
+}
+
+/*!
+    \brief Sets the names of the properties whose values are interned to \a properties.
+    
+    Interning is intended for low-cardinality properties such as genre or country. Each distinct string value of 
+    an interned property is stored once in a per-model dictionary and shared by every row that uses it, and is 
+    assigned a small integer code (see valueCode()). find() on an interned property compares shared storage 
+    instead of string contents.
+    
+    Existing rows are interned immediately.
+*/
+void Model::setInternedProperties(const QStringList &properties) {
+    Q_D(Model);
+    
+    d->dictionaries.clear();
+    
+    foreach (const QString &property, properties) {
+        d->dictionaries.insert(property, ValueDictionary());
+    }
+    
+    if (!d->dictionaries.isEmpty()) {
+        for (int i = 0; i < d->items.size(); i++) {
+            d->internValues(d->items[i]);
+        }
+    }
+}
+
+/*!
+    \brief Returns the dictionary code of \a value for the interned \a property.
+    
+    Codes are small integers assigned in order of first appearance, and stay the same until the model is cleared. 
+    If \a property is not interned, or no row has \a value, -1 is returned.
+    
+    \sa distinctValues()
+*/
+int Model::valueCode(const QString &property, const QVariant &value) const {
+    Q_D(const Model);
+    
+    QHash<QString, ValueDictionary>::const_iterator dictionary = d->dictionaries.constFind(property);
+    return dictionary == d->dictionaries.constEnd() ? -1 : dictionary.value().code(value.toString());
+}
+
+/*!
+    \brief Returns the distinct values of the interned \a property, ordered by their dictionary code.
+    
+    \sa valueCode()
+*/
+QStringList Model::distinctValues(const QString &property) const {
+    Q_D(const Model);
+    
+    return d->dictionaries.value(property).values;
+}
+
+/*!
+    \brief Returns an estimate of the memory used by the model, in bytes.
+    
+    The estimate is returned as a map with the following keys:
+    
+    <table>
+        <tr>
+            <th>Key</th>
+            <th>Description</th>
+        </tr>
+        <tr>
+            <td>rows</td>
+            <td>The row list and the map structure of each row.</td>
+        </tr>
+        <tr>
+            <td>keys</td>
+            <td>The distinct property name strings used by rows.</td>
+        </tr>
+        <tr>
+            <td>strings</td>
+            <td>The distinct string values held by rows, and any other variable-size values.</td>
+        </tr>
+        <tr>
+            <td>results</td>
+            <td>
+                Data retained in addition to the rows, such as the last parsed request result of a ResourcesModel.
+                Strings shared with rows are not counted again.
+            </td>
+        </tr>
+        <tr>
+            <td>total</td>
+            <td>The sum of the above.</td>
+        </tr>
+    </table>
+    
+    Shared strings, such as interned keys and values, are counted once. Sizes are based on typical 64-bit 
+    container layouts and do not include allocator overhead.
+*/
+QVariantMap Model::memoryUsage() const {
+    Q_D(const Model);
+    
+    QSet<const void*> seen;
+    qint64 rows = CONTAINER_HEADER_BYTES + d->items.size() * sizeof(void*);
+    qint64 keys = 0;
+    qint64 strings = 0;
+    
+    foreach (const QVariantMap &item, d->items) {
+        rows += CONTAINER_HEADER_BYTES + item.size() * MAP_NODE_BYTES;
+        QMapIterator<QString, QVariant> iterator(item);
+        
+        while (iterator.hasNext()) {
+            iterator.next();
+            keys += stringBytes(iterator.key(), seen);
+            strings += variantBytes(iterator.value(), seen);
+        }
+    }
+    
+    const qint64 results = d->retainedBytes(seen);
+    
+    QVariantMap usage;
+    usage["rows"] = rows;
+    usage["keys"] = keys;
+    usage["strings"] = strings;
+    usage["results"] = results;
+    usage["total"] = rows + keys + strings + results;
+    return usage;
+}
+
 /*!
     \brief Returns the item at \a row.
 */
 QVariantMap Model::get(int row) const {
     Q_D(const Model);
     
-    return (row >= 0) && (row < d->items.size()) ? d->items.at(row) : QVariantMap();
+    return (row >= 0) && (row < d->count()) ? d->itemAt(row) : QVariantMap();
 }
 
 /*!
@@ -239,11 +418,13 @@ QVariantMap Model::get(int row) const {
 bool Model::setProperty(int row, const QString &property, const QVariant &value) {
     Q_D(Model);
     
-    if ((row < 0) || (row >= d->items.size())) {
+    if ((d->isReadOnly()) || (row < 0) || (row >= d->items.size())) {
         return false;
     }
     
-    d->items[row][property] = value;
+    QVariant &v = d->items[row][property];
+    v = value;
+    d->internValue(property, v);
     const QModelIndex i = index(row);
     emit dataChanged(i, i);
     
@@ -258,7 +439,7 @@ bool Model::setProperty(int row, const QString &property, const QVariant &value)
 bool Model::set(int row, const QVariantMap &properties) {
     Q_D(Model);
     
-    if ((row < 0) || (row >= d->items.size())) {
+    if ((d->isReadOnly()) || (row < 0) || (row >= d->items.size())) {
         return false;
     }
     
@@ -266,7 +447,9 @@ bool Model::set(int row, const QVariantMap &properties) {
     
     while (iterator.hasNext()) {
         iterator.next();
-        d->items[row][iterator.key()] = iterator.value();
+        QVariant &v = d->items[row][iterator.key()];
+        v = iterator.value();
+        d->internValue(iterator.key(), v);
     }
     
     const QModelIndex i = index(row);
@@ -281,13 +464,20 @@ bool Model::set(int row, const QVariantMap &properties) {
 void Model::append(const QVariantMap &properties) {
     Q_D(Model);
     
+    if (d->isReadOnly()) {
+        return;
+    }
+    
     if (d->roles.isEmpty()) {
         d->setRoleNames(properties);
     }
     
+    QVariantMap item(properties);
+    d->internValues(item);
     beginInsertRows(QModelIndex(), d->items.size(), d->items.size());
-    d->items << properties;
+    d->items << item;
     endInsertRows();
+    d->rowsChanged();
     emit countChanged(rowCount());
 }
 
@@ -299,6 +489,10 @@ void Model::append(const QVariantMap &properties) {
 void Model::insert(int row, const QVariantMap &properties) {
     Q_D(Model);
     
+    if (d->isReadOnly()) {
+        return;
+    }
+    
     if ((row < 0) || (row >= d->items.size())) {
         append(properties);
         return;
@@ -308,9 +502,12 @@ void Model::insert(int row, const QVariantMap &properties) {
         d->setRoleNames(properties);
     }
     
+    QVariantMap item(properties);
+    d->internValues(item);
     beginInsertRows(QModelIndex(), row, row);
-    d->items.insert(row, properties);
+    d->items.insert(row, item);
     endInsertRows();
+    d->rowsChanged();
     emit countChanged(rowCount());
 }
 
@@ -322,13 +519,14 @@ void Model::insert(int row, const QVariantMap &properties) {
 bool Model::remove(int row) {
     Q_D(Model);
     
-    if ((row < 0) || (row >= d->items.size())) {
+    if ((d->isReadOnly()) || (row < 0) || (row >= d->items.size())) {
         return false;
     }
     
     beginRemoveRows(QModelIndex(), row, row);
     d->items.removeAt(row);
     endRemoveRows();
+    d->rowsChanged();
     emit countChanged(rowCount());
     
     return true;
@@ -340,10 +538,20 @@ bool Model::remove(int row) {
 void Model::clear() {
     Q_D(Model);
     
-    if (!d->items.isEmpty()) {
+    // count() includes rows that are not items, such as those of a ResourcesModel snapshot.
+    if (d->count() > 0) {
         beginResetModel();
-        d->items.clear();
+        d->clearItems();
+        
+        QMutableHashIterator<QString, ValueDictionary> iterator(d->dictionaries);
+        
+        while (iterator.hasNext()) {
+            iterator.next();
+            iterator.value().clear();
+        }
+        
         endResetModel();
+        d->rowsChanged();
         emit countChanged(rowCount());
     }
 }
@@ -355,6 +563,88 @@ ModelPrivate::ModelPrivate(Model *parent) :
 
 ModelPrivate::~ModelPrivate() {}
 
+/*!
+    \internal
+    \brief Returns the number of rows in the model.
+    
+    The default implementation returns the number of items.
+*/
+int ModelPrivate::count() const {
+    return items.size();
+}
+
+/*!
+    \internal
+    \brief Returns the item at \a row, which is always a valid row.
+    
+    The default implementation returns the item from items.
+*/
+QVariantMap ModelPrivate::itemAt(int row) const {
+    return items.at(row);
+}
+
+/*!
+    \internal
+    \brief Called after rows are inserted, removed or cleared.
+    
+    The default implementation does nothing.
+*/
+void ModelPrivate::rowsChanged() {}
+
+/*!
+    \internal
+    \brief Returns true if the rows are not held in items, and so can not be changed.
+    
+    The default implementation returns false.
+*/
+bool ModelPrivate::isReadOnly() const {
+    return false;
+}
+
+/*!
+    \internal
+    \brief Removes all items, while the model is being reset by Model::clear().
+    
+    Reimplement this to also clear any state that describes the items.
+*/
+void ModelPrivate::clearItems() {
+    items.clear();
+}
+
+/*!
+    \internal
+    \brief Returns the approximate size of data held by the model in addition to its rows.
+    
+    The default implementation returns 0.
+*/
+qint64 ModelPrivate::retainedBytes(QSet<const void*> &) const {
+    return 0;
+}
+
+/*!
+    \internal
+    \brief Replaces \a value with the dictionary copy if \a property is interned.
+*/
+void ModelPrivate::internValue(const QString &property, QVariant &value) {
+    if (value.type() != QVariant::String) {
+        return;
+    }
+    
+    QHash<QString, ValueDictionary>::iterator dictionary = dictionaries.find(property);
+    
+    if (dictionary != dictionaries.end()) {
+        value = dictionary.value().intern(value.toString());
+    }
+}
+
+/*!
+    \internal
+    \brief Interns the values of all interned properties of \a item.
+*/
+void ModelPrivate::internValues(QVariantMap &item) {
+    CuteRadio::internValues(dictionaries, item);
+}
+
 /*!
     \internal
     \brief Set the role names of the model using the unique keys of \a item.
@@ -19,6 +19,7 @@
 
 #include "cuteradio_global.h"
 #include <QAbstractListModel>
+#include <QStringList>
 
 namespace CuteRadio {
 
@@ -50,6 +51,14 @@ public:
     void insert(const QModelIndex &index, const QMap<int, QVariant> &roles);
     bool remove(const QModelIndex &index);
     
+    QStringList internedProperties() const;
+    void setInternedProperties(const QStringList &properties);
+    
+    Q_INVOKABLE int valueCode(const QString &property, const QVariant &value) const;
+    Q_INVOKABLE QStringList distinctValues(const QString &property) const;
+    
+    Q_INVOKABLE QVariantMap memoryUsage() const;
+    
     Q_INVOKABLE int find(const QString &property, const QVariant &value) const;
     Q_INVOKABLE QVariantMap get(int row) const;
     Q_INVOKABLE bool setProperty(int row, const QString &property, const QVariant &value);
@@ -18,9 +18,134 @@
 #define CUTERADIO_MODEL_P_H
 
 #include "model.h"
+#include <QSet>
+#include <QStringList>
 
 namespace CuteRadio {
 
+/*!
+    \internal
+    \brief A dictionary of the distinct values of one low-cardinality property.
+    
+    Each distinct value is stored once and given a small integer code. Rows hold the dictionary's copy of the 
+    value, so equal values share one implicitly shared QString.
+*/
+class ValueDictionary
+{
+
+public:
+    int code(const QString &value) const {
+        return codes.value(value, -1);
+    }
+    
+    QString intern(const QString &value) {
+        QHash<QString, int>::const_iterator iterator = codes.constFind(value);
+        
+        if (iterator != codes.constEnd()) {
+            return values.at(iterator.value());
+        }
+        
+        codes.insert(value, values.size());
+        values << value;
+        return value;
+    }
+    
+    void clear() {
+        codes.clear();
+        values.clear();
+    }
+    
+    QHash<QString, int> codes;
+    QStringList values;
+};
+
+/*!
+    \internal
+    \brief Interns the values of the properties of \a item that have a dictionary in \a dictionaries.
+*/
+inline void internValues(QHash<QString, ValueDictionary> &dictionaries, QVariantMap &item) {
+    QHash<QString, ValueDictionary>::iterator dictionary = dictionaries.begin();
+    
+    while (dictionary != dictionaries.end()) {
+        QVariantMap::iterator value = item.find(dictionary.key());
+        
+        if ((value != item.end()) && (value.value().type() == QVariant::String)) {
+            value.value() = dictionary.value().intern(value.value().toString());
+        }
+        
+        ++dictionary;
+    }
+}
+
+/*!
+    \internal
+    \brief Approximate heap sizes used by Model::memoryUsage().
+    
+    The figures match the 64-bit layouts of Qt 4.8 and Qt 5, and are estimates only.
+*/
+static const qint64 STRING_HEADER_BYTES = 24;
+static const qint64 CONTAINER_HEADER_BYTES = 24;
+static const qint64 MAP_NODE_BYTES = 48;
+static const qint64 VARIANT_BYTES = 16;
+
+/*!
+    \internal
+    \brief Returns the heap size of \a s, or 0 if its storage is already in \a seen.
+*/
+inline qint64 stringBytes(const QString &s, QSet<const void*> &seen) {
+    if (s.isEmpty()) {
+        return 0;
+    }
+    
+    const void *data = s.constData();
+    
+    if (seen.contains(data)) {
+        return 0;
+    }
+    
+    seen.insert(data);
+    return STRING_HEADER_BYTES + (s.size() + 1) * 2;
+}
+
+/*!
+    \internal
+    \brief Returns the approximate heap size of \a value, not counting strings already in \a seen.
+*/
+inline qint64 variantBytes(const QVariant &value, QSet<const void*> &seen) {
+    switch (value.type()) {
+    case QVariant::String:
+        return stringBytes(value.toString(), seen);
+    case QVariant::ByteArray:
+        return CONTAINER_HEADER_BYTES + value.toByteArray().size();
+    case QVariant::List:
+    {
+        const QVariantList list = value.toList();
+        qint64 bytes = CONTAINER_HEADER_BYTES + list.size() * (sizeof(void*) + VARIANT_BYTES);
+        
+        foreach (const QVariant &v, list) {
+            bytes += variantBytes(v, seen);
+        }
+        
+        return bytes;
+    }
+    case QVariant::Map:
+    {
+        const QVariantMap map = value.toMap();
+        qint64 bytes = CONTAINER_HEADER_BYTES + map.size() * MAP_NODE_BYTES;
+        QMapIterator<QString, QVariant> iterator(map);
+        
+        while (iterator.hasNext()) {
+            iterator.next();
+            bytes += stringBytes(iterator.key(), seen) + variantBytes(iterator.value(), seen);
+        }
+        
+        return bytes;
+    }
+    default:
+        return 0;
+    }
+}
+
 class ModelPrivate
 {
 
@@ -29,6 +154,18 @@ public:
     virtual ~ModelPrivate();
     
     void setRoleNames(const QVariantMap &item);
+    
+    void internValue(const QString &property, QVariant &value);
+    void internValues(QVariantMap &item);
+    
+    virtual int count() const;
+    virtual QVariantMap itemAt(int row) const;
+    
+    virtual bool isReadOnly() const;
+    virtual void clearItems();
+    virtual void rowsChanged();
+    
+    virtual qint64 retainedBytes(QSet<const void*> &seen) const;
         
     Model *q_ptr;
     
@@ -36,6 +173,8 @@ public:
         
     QList<QVariantMap> items;
     
+    QHash<QString, ValueDictionary> dictionaries;
+    
     Q_DECLARE_PUBLIC(Model)
 };
 
@@ -0,0 +1,470 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "modelsnapshot_p.h"
+#include "json.h"
+#include <QDir>
+#include <QFileInfo>
+#include <limits>
+#ifdef CUTERADIO_DEBUG
+#include <QDebug>
+#endif
+
+namespace CuteRadio {
+
+static const quint32 SNAPSHOT_MAGIC = 0x4e535243; // "CRSN"
+static const quint32 SNAPSHOT_VERSION = 1;
+static const quint32 SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+// Marks a missing value in string and bool columns.
+static const quint32 NULL_INDEX = 0xffffffff;
+// Marks a missing value in integer columns. Double columns use NaN.
+static const qint64 NULL_INTEGER = std::numeric_limits<qint64>::min();
+
+static quint32 columnWidth(quint32 type) {
+    switch (type) {
+    case ModelSnapshot::IntegerColumn:
+    case ModelSnapshot::DoubleColumn:
+        return 8;
+    default:
+        return 4;
+    }
+}
+
+static void align(QByteArray &buffer) {
+    while (buffer.size() % 8) {
+        buffer.append('\0');
+    }
+}
+
+template <typename T>
+static void appendValue(QByteArray &buffer, T value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static quint32 columnType(const QList<QVariantMap> &rows, const QString &property) {
+    quint32 type = 0;
+    
+    foreach (const QVariantMap &row, rows) {
+        const QVariant value = row.value(property);
+        quint32 t;
+        
+        switch (value.type()) {
+        case QVariant::Invalid:
+            continue;
+        case QVariant::Map:
+        case QVariant::Hash:
+        case QVariant::List:
+        case QVariant::StringList:
+            // Nested values have no string form, so the whole column is stored as JSON.
+            return ModelSnapshot::JsonColumn;
+        case QVariant::Bool:
+            t = ModelSnapshot::BoolColumn;
+            break;
+        case QVariant::Int:
+        case QVariant::UInt:
+        case QVariant::LongLong:
+            t = ModelSnapshot::IntegerColumn;
+            break;
+        case QVariant::Double:
+            t = ModelSnapshot::DoubleColumn;
+            break;
+        default:
+            t = ModelSnapshot::StringColumn;
+            break;
+        }
+        
+        if (type == 0) {
+            type = t;
+        }
+        else if (type != t) {
+            // The remaining rows are still checked for nested values.
+            if ((type == ModelSnapshot::StringColumn) || (t == ModelSnapshot::StringColumn)
+                || (type == ModelSnapshot::BoolColumn) || (t == ModelSnapshot::BoolColumn)) {
+                type = ModelSnapshot::StringColumn;
+            }
+            else {
+                type = ModelSnapshot::DoubleColumn;
+            }
+        }
+    }
+    
+    return type == 0 ? quint32(ModelSnapshot::StringColumn) : type;
+}
+
+ModelSnapshot::ModelSnapshot() :
+    data(0),
+    size(0),
+    header(0),
+    columns(0)
+{
+}
+
+ModelSnapshot::~ModelSnapshot() {
+    close();
+}
+
+/*!
+    \internal
+    \brief Maps the snapshot at \a path.
+    
+    Returns false if the file cannot be mapped or is not a valid snapshot of the current version.
+*/
+bool ModelSnapshot::open(const QString &path) {
+    close();
+    file.setFileName(path);
+    
+    if (!file.open(QFile::ReadOnly)) {
+        return false;
+    }
+    
+    size = file.size();
+    
+    if (size >= qint64(sizeof(SnapshotHeader))) {
+        data = file.map(0, size);
+    }
+    
+    if (!data) {
+        close();
+        return false;
+    }
+    
+    header = reinterpret_cast<const SnapshotHeader*>(data);
+    
+    if (!validate()) {
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "ModelSnapshot::open: Invalid snapshot" << path;
+#endif
+        close();
+        return false;
+    }
+    
+    columns = reinterpret_cast<const SnapshotColumn*>(data + header->columnsOffset);
+    
+    for (quint32 i = 0; i < header->columnCount; i++) {
+        const QString name = string(columns[i].name);
+        columnIndexes.insert(name, i);
+        columnNames << name;
+    }
+    
+    return true;
+}
+
+/*!
+    \internal
+    \brief Unmaps the snapshot.
+*/
+void ModelSnapshot::close() {
+    if (data) {
+        file.unmap(const_cast<uchar*>(data));
+    }
+    
+    file.close();
+    data = 0;
+    size = 0;
+    header = 0;
+    columns = 0;
+    columnIndexes.clear();
+    columnNames.clear();
+}
+
+/*!
+    \internal
+    \brief Returns true if a snapshot is mapped.
+*/
+bool ModelSnapshot::isOpen() const {
+    return data != 0;
+}
+
+/*!
+    \internal
+    \brief Returns the number of rows in the snapshot.
+*/
+int ModelSnapshot::rowCount() const {
+    return header ? int(header->rowCount) : 0;
+}
+
+/*!
+    \internal
+    \brief Returns the names of the columns in the snapshot.
+*/
+QStringList ModelSnapshot::properties() const {
+    return columnNames;
+}
+
+/*!
+    \internal
+    \brief Returns the value of \a property in \a row.
+*/
+QVariant ModelSnapshot::value(int row, const QString &property) const {
+    if ((row < 0) || (row >= rowCount())) {
+        return QVariant();
+    }
+    
+    const int column = columnIndexes.value(property, -1);
+    return column == -1 ? QVariant() : value(row, columns[column]);
+}
+
+/*!
+    \internal
+    \brief Returns \a row as a QVariantMap, leaving out missing values.
+*/
+QVariantMap ModelSnapshot::row(int row) const {
+    QVariantMap item;
+    
+    if ((row < 0) || (row >= rowCount())) {
+        return item;
+    }
+    
+    for (quint32 i = 0; i < header->columnCount; i++) {
+        const QVariant v = value(row, columns[i]);
+        
+        if (v.isValid()) {
+            item.insert(columnNames.at(i), v);
+        }
+    }
+    
+    return item;
+}
+
+QVariant ModelSnapshot::value(int row, const SnapshotColumn &column) const {
+    const uchar *values = data + column.offset;
+    
+    switch (column.type) {
+    case StringColumn:
+    {
+        const quint32 index = reinterpret_cast<const quint32*>(values)[row];
+        return index == NULL_INDEX ? QVariant() : QVariant(string(index));
+    }
+    case IntegerColumn:
+    {
+        const qint64 i = reinterpret_cast<const qint64*>(values)[row];
+        
+        if (i == NULL_INTEGER) {
+            return QVariant();
+        }
+        
+        return (i >= std::numeric_limits<int>::min()) && (i <= std::numeric_limits<int>::max())
+                ? QVariant(int(i)) : QVariant(i);
+    }
+    case DoubleColumn:
+    {
+        const double d = reinterpret_cast<const double*>(values)[row];
+        return d != d ? QVariant() : QVariant(d);
+    }
+    case BoolColumn:
+    {
+        const quint32 b = reinterpret_cast<const quint32*>(values)[row];
+        return b == NULL_INDEX ? QVariant() : QVariant(b != 0);
+    }
+    case JsonColumn:
+    {
+        const quint32 index = reinterpret_cast<const quint32*>(values)[row];
+        return index == NULL_INDEX ? QVariant() : QtJson::Json::parse(string(index));
+    }
+    default:
+        return QVariant();
+    }
+}
+
+QString ModelSnapshot::string(quint32 index) const {
+    if (index >= header->stringCount) {
+        return QString();
+    }
+    
+    const quint32 *offsets = reinterpret_cast<const quint32*>(data + header->stringOffsetsOffset);
+    const quint32 begin = offsets[index];
+    const quint32 end = offsets[index + 1];
+    
+    if ((begin > end) || (end > offsets[header->stringCount])) {
+        return QString();
+    }
+    
+    return QString(reinterpret_cast<const QChar*>(data + header->stringDataOffset) + begin, end - begin);
+}
+
+bool ModelSnapshot::validate() const {
+    if ((header->magic != SNAPSHOT_MAGIC) || (header->version != SNAPSHOT_VERSION)
+        || (header->byteOrder != SNAPSHOT_BYTE_ORDER)) {
+        return false;
+    }
+    
+    if ((header->columnsOffset % 8) || (header->stringOffsetsOffset % 8) || (header->stringDataOffset % 8)) {
+        return false;
+    }
+    
+    if (qint64(header->columnsOffset) + qint64(header->columnCount) * qint64(sizeof(SnapshotColumn)) > size) {
+        return false;
+    }
+    
+    if (qint64(header->stringOffsetsOffset) + (qint64(header->stringCount) + 1) * 4 > size) {
+        return false;
+    }
+    
+    const quint32 *offsets = reinterpret_cast<const quint32*>(data + header->stringOffsetsOffset);
+    
+    if (qint64(header->stringDataOffset) + qint64(offsets[header->stringCount]) * 2 > size) {
+        return false;
+    }
+    
+    const SnapshotColumn *c = reinterpret_cast<const SnapshotColumn*>(data + header->columnsOffset);
+    
+    for (quint32 i = 0; i < header->columnCount; i++) {
+        if ((c[i].type < StringColumn) || (c[i].type > JsonColumn) || (c[i].offset % 8)
+            || (c[i].name >= header->stringCount)) {
+            return false;
+        }
+        
+        if (qint64(c[i].offset) + qint64(header->rowCount) * columnWidth(c[i].type) > size) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/*!
+    \internal
+    \brief Writes \a rows to a snapshot at \a path.
+    
+    Each property becomes a column with a type that fits all of its values. Strings are stored once in a shared 
+    string table. A column with nested maps or lists is stored as JSON, so it is restored as it was. The file is 
+    written next to \a path and renamed into place, so an existing snapshot is never left half-written.
+*/
+bool ModelSnapshot::write(const QString &path, const QList<QVariantMap> &rows) {
+    QStringList properties;
+    
+    foreach (const QVariantMap &row, rows) {
+        foreach (const QString &property, row.keys()) {
+            if (!properties.contains(property)) {
+                properties << property;
+            }
+        }
+    }
+    
+    QStringList strings;
+    QHash<QString, quint32> stringIndexes;
+    QList<SnapshotColumn> columnList;
+    QByteArray columnData;
+    const quint32 columnsOffset = sizeof(SnapshotHeader);
+    const quint32 columnDataOffset = columnsOffset + properties.size() * sizeof(SnapshotColumn);
+    
+    foreach (const QString &property, properties) {
+        SnapshotColumn column;
+        column.type = columnType(rows, property);
+        column.offset = columnDataOffset + columnData.size();
+        column.reserved = 0;
+        
+        if (!stringIndexes.contains(property)) {
+            stringIndexes.insert(property, strings.size());
+            strings << property;
+        }
+        
+        column.name = stringIndexes.value(property);
+        
+        foreach (const QVariantMap &row, rows) {
+            const QVariant value = row.value(property);
+            
+            switch (column.type) {
+            case IntegerColumn:
+                appendValue<qint64>(columnData, value.isValid() ? value.toLongLong() : NULL_INTEGER);
+                break;
+            case DoubleColumn:
+                appendValue<double>(columnData, value.isValid() ? value.toDouble()
+                                                                : std::numeric_limits<double>::quiet_NaN());
+                break;
+            case BoolColumn:
+                appendValue<quint32>(columnData, value.isValid() ? quint32(value.toBool()) : NULL_INDEX);
+                break;
+            default:
+                if (value.isValid()) {
+                    const QString s = column.type == JsonColumn ? QString::fromUtf8(QtJson::Json::serialize(value))
+                                                                : value.toString();
+                    QHash<QString, quint32>::const_iterator iterator = stringIndexes.constFind(s);
+                    
+                    if (iterator == stringIndexes.constEnd()) {
+                        iterator = stringIndexes.insert(s, strings.size());
+                        strings << s;
+                    }
+                    
+                    appendValue<quint32>(columnData, iterator.value());
+                }
+                else {
+                    appendValue<quint32>(columnData, NULL_INDEX);
+                }
+                
+                break;
+            }
+        }
+        
+        align(columnData);
+        columnList << column;
+    }
+    
+    SnapshotHeader header;
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.rowCount = rows.size();
+    header.columnCount = columnList.size();
+    header.stringCount = strings.size();
+    header.columnsOffset = columnsOffset;
+    header.stringOffsetsOffset = columnDataOffset + columnData.size();
+    header.stringDataOffset = header.stringOffsetsOffset + ((strings.size() + 1) * 4 + 7) / 8 * 8;
+    header.reserved = 0;
+    
+    QByteArray buffer;
+    buffer.reserve(header.stringDataOffset);
+    buffer.append(reinterpret_cast<const char*>(&header), sizeof(SnapshotHeader));
+    
+    foreach (const SnapshotColumn &column, columnList) {
+        buffer.append(reinterpret_cast<const char*>(&column), sizeof(SnapshotColumn));
+    }
+    
+    buffer.append(columnData);
+    
+    QByteArray stringData;
+    quint32 offset = 0;
+    
+    foreach (const QString &s, strings) {
+        appendValue<quint32>(buffer, offset);
+        stringData.append(reinterpret_cast<const char*>(s.constData()), s.size() * 2);
+        offset += s.size();
+    }
+    
+    appendValue<quint32>(buffer, offset);
+    align(buffer);
+    buffer.append(stringData);
+    
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    const QString tempPath = path + ".tmp";
+    QFile temp(tempPath);
+    
+    if ((!temp.open(QFile::WriteOnly)) || (temp.write(buffer) != buffer.size())) {
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "ModelSnapshot::write: Cannot write" << tempPath << temp.errorString();
+#endif
+        temp.close();
+        temp.remove();
+        return false;
+    }
+    
+    temp.close();
+    QFile::remove(path);
+    return temp.rename(path);
+}
+
+}
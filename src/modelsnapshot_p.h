@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_MODELSNAPSHOT_P_H
+#define CUTERADIO_MODELSNAPSHOT_P_H
+
+#include <QFile>
+#include <QHash>
+#include <QStringList>
+#include <QVariantMap>
+
+namespace CuteRadio {
+
+/*!
+    \internal
+    \brief The header at the start of a snapshot file.
+    
+    All values are in host byte order, which is checked using byteOrder. Offsets are from the start of the file.
+*/
+struct SnapshotHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 byteOrder;
+    quint32 rowCount;
+    quint32 columnCount;
+    quint32 stringCount;
+    quint32 columnsOffset;
+    quint32 stringOffsetsOffset;
+    quint32 stringDataOffset;
+    quint32 reserved;
+};
+
+/*!
+    \internal
+    \brief Describes one column of a snapshot.
+    
+    A column holds a fixed-width value for every row: a string table index for StringColumn, a qint64 for 
+    IntegerColumn, a double for DoubleColumn and a quint32 for BoolColumn. JsonColumn holds nested maps and lists 
+    as string table indexes of their JSON.
+*/
+struct SnapshotColumn
+{
+    quint32 name;
+    quint32 type;
+    quint32 offset;
+    quint32 reserved;
+};
+
+/*!
+    \internal
+    \brief A read-only, memory-mapped table of model rows.
+    
+    Values are read from the mapping when requested, so opening a snapshot does not depend on the number of rows.
+*/
+class ModelSnapshot
+{
+
+public:
+    enum ColumnType {
+        StringColumn = 1,
+        IntegerColumn,
+        DoubleColumn,
+        BoolColumn,
+        JsonColumn
+    };
+    
+    ModelSnapshot();
+    ~ModelSnapshot();
+    
+    bool open(const QString &path);
+    void close();
+    
+    bool isOpen() const;
+    
+    int rowCount() const;
+    
+    QStringList properties() const;
+    
+    QVariant value(int row, const QString &property) const;
+    QVariantMap row(int row) const;
+    
+    static bool write(const QString &path, const QList<QVariantMap> &rows);
+
+private:
+    QVariant value(int row, const SnapshotColumn &column) const;
+    QString string(quint32 index) const;
+    
+    bool validate() const;
+    
+    QFile file;
+    
+    const uchar *data;
+    qint64 size;
+    
+    const SnapshotHeader *header;
+    const SnapshotColumn *columns;
+    
+    QHash<QString, int> columnIndexes;
+    QStringList columnNames;
+    
+    Q_DISABLE_COPY(ModelSnapshot)
+};
+
+}
+
+#endif // CUTERADIO_MODELSNAPSHOT_P_H
@@ -0,0 +1,672 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pagesrequest_p.h"
+#include "circuitbreaker_p.h"
+#include "endpointselector_p.h"
+#include "ratelimiter_p.h"
+#include "redirectcache_p.h"
+#include "requestengine_p.h"
+#include <QNetworkAccessManager>
+#include <QThreadPool>
+#ifdef CUTERADIO_DEBUG
+#include <QDebug>
+#endif
+
+namespace CuteRadio {
+
+static const int DEFAULT_PAGE_LIMIT = 20;
+static const int DEFAULT_CONCURRENT_PAGES = 4;
+
+// Bounded to QThread::idealThreadCount() threads unless changed with PagesRequest::setMaximumParserThreads().
+Q_GLOBAL_STATIC(QThreadPool, pageParserPool)
+
+PageParser::PageParser(int generation, int page, const QByteArray &response) :
+    QObject(),
+    QRunnable(),
+    generation(generation),
+    page(page),
+    response(response)
+{
+    // The pool must not delete the parser in its own thread, so it is deleted by run() with deleteLater().
+    setAutoDelete(false);
+}
+
+void PageParser::run() {
+    bool ok = true;
+    const QString json = QString::fromUtf8(response);
+    const QVariant result = json.isEmpty() ? QVariant() : QtJson::Json::parse(json, ok);
+    response.clear();
+    emit finished(generation, page, result, ok);
+    deleteLater();
+}
+
+/*!
+    \class PagesRequest
+    \brief Fetches several pages of a cuteRadio resource concurrently.
+    
+    \ingroup requests
+    
+    PagesRequest is used for crawling or prefetching a resource a block of pages at a time. Up to 
+    maximumConcurrentPages pages are downloaded at once, and each page body is parsed in a bounded QThreadPool as 
+    soon as it arrives. Parsed pages are reassembled so that pageReady() is always emitted in page order, 
+    whichever order the downloads and parse jobs complete in. In Request::WorkerThreadEngine mode, pages are 
+    downloaded and parsed in the RequestEngine thread instead.
+    
+    Pages are requested with the "limit" filter (20 if not set) and an "offset" filter of 
+    offset + page * limit.
+    
+    Example usage:
+    
+    \code
+    using namespace CuteRadio;
+    
+    ...
+    
+    PagesRequest *request = new PagesRequest(this);
+    connect(request, SIGNAL(pageReady(int, QVariant)), this, SLOT(onPageReady(int, QVariant)));
+    
+    QVariantMap filters;
+    filters["limit"] = 100;
+    request->get("/stations", filters, 0, 50);
+    \endcode
+    
+    \sa ResourcesModel::fetchPages()
+*/
+PagesRequest::PagesRequest(QObject *parent) :
+    QObject(parent),
+    d_ptr(new PagesRequestPrivate(this))
+{
+}
+
+PagesRequest::~PagesRequest() {
+    Q_D(PagesRequest);
+    
+    d->generation++;
+    d->abortReplies();
+}
+
+/*!
+    \property QString PagesRequest::accessToken
+    \brief The access token used when making requests to the cuteRadio Data API.
+*/
+
+/*!
+    \fn void PagesRequest::accessTokenChanged()
+    \brief Emitted when the accessToken changes.
+*/
+QString PagesRequest::accessToken() const {
+    Q_D(const PagesRequest);
+    
+    return d->accessToken;
+}
+
+void PagesRequest::setAccessToken(const QString &token) {
+    Q_D(PagesRequest);
+    
+    if (token != d->accessToken) {
+        d->accessToken = token;
+        d->reqTemplateValid = false;
+        emit accessTokenChanged();
+    }
+}
+
+/*!
+    \property enum PagesRequest::engineMode
+    \brief Where pages are downloaded and parsed.
+    
+    In Request::DirectEngine mode, pages are downloaded in the thread that owns the request and parsed in a 
+    thread pool. In Request::WorkerThreadEngine mode, each page is downloaded and parsed in the RequestEngine 
+    thread.
+    
+    The default value is Request::defaultEngineMode(). Changes take effect from the next page sent.
+    
+    \sa Request::engineMode
+*/
+
+/*!
+    \fn void PagesRequest::engineModeChanged()
+    \brief Emitted when the engineMode changes.
+*/
+Request::EngineMode PagesRequest::engineMode() const {
+    Q_D(const PagesRequest);
+    
+    return d->engineMode;
+}
+
+void PagesRequest::setEngineMode(Request::EngineMode mode) {
+    Q_D(PagesRequest);
+    
+    if (mode != d->engineMode) {
+        d->engineMode = mode;
+        emit engineModeChanged();
+    }
+}
+
+/*!
+    \property QVariantMap PagesRequest::headers
+    \brief The headers sent with every page, in addition to the Authorization header.
+    
+    \sa Request::headers
+*/
+
+/*!
+    \fn void PagesRequest::headersChanged()
+    \brief Emitted when the headers change.
+*/
+QVariantMap PagesRequest::headers() const {
+    Q_D(const PagesRequest);
+    
+    return d->headers;
+}
+
+void PagesRequest::setHeaders(const QVariantMap &headers) {
+    Q_D(PagesRequest);
+    
+    if (headers != d->headers) {
+        d->headers = headers;
+        d->reqTemplateValid = false;
+        emit headersChanged();
+    }
+}
+
+/*!
+    \property int PagesRequest::maximumConcurrentPages
+    \brief The maximum number of pages that are downloaded at the same time.
+    
+    The default value is 4.
+*/
+
+/*!
+    \fn void PagesRequest::maximumConcurrentPagesChanged()
+    \brief Emitted when the maximumConcurrentPages changes.
+*/
+int PagesRequest::maximumConcurrentPages() const {
+    Q_D(const PagesRequest);
+    
+    return d->maxConcurrent;
+}
+
+void PagesRequest::setMaximumConcurrentPages(int pages) {
+    Q_D(PagesRequest);
+    
+    pages = qMax(1, pages);
+    
+    if (pages != d->maxConcurrent) {
+        d->maxConcurrent = pages;
+        emit maximumConcurrentPagesChanged();
+    }
+}
+
+/*!
+    \property int PagesRequest::pageCount
+    \brief The number of pages requested by the last call to get().
+*/
+int PagesRequest::pageCount() const {
+    Q_D(const PagesRequest);
+    
+    return d->count;
+}
+
+/*!
+    \property int PagesRequest::pagesReady
+    \brief The number of pages that have been delivered with pageReady().
+*/
+int PagesRequest::pagesReady() const {
+    Q_D(const PagesRequest);
+    
+    return d->nextToDeliver;
+}
+
+/*!
+    \property enum PagesRequest::status
+    \brief The status of the last request.
+    
+    \sa Request::status
+*/
+Request::Status PagesRequest::status() const {
+    Q_D(const PagesRequest);
+    
+    return d->status;
+}
+
+/*!
+    \property enum PagesRequest::error
+    \brief The error resulting from the last request.
+    
+    \sa Request::error
+*/
+Request::Error PagesRequest::error() const {
+    Q_D(const PagesRequest);
+    
+    return d->error;
+}
+
+/*!
+    \property QString PagesRequest::errorString
+    \brief A description of the error resulting from the last request.
+*/
+QString PagesRequest::errorString() const {
+    Q_D(const PagesRequest);
+    
+    return d->errorString;
+}
+
+/*!
+    \property int PagesRequest::redirectCount
+    \brief The number of redirects followed by all pages of the last request.
+    
+    \sa Request::redirectCount
+*/
+int PagesRequest::redirectCount() const {
+    Q_D(const PagesRequest);
+    
+    return d->redirectCount;
+}
+
+/*!
+    \brief Sets the QNetworkAccessManager instance to be used when making requests to the cuteRadio Data API.
+    
+    PagesRequest does not take ownership of \a manager.
+    
+    If no QNetworkAccessManager is set, one will be created when required.
+*/
+void PagesRequest::setNetworkAccessManager(QNetworkAccessManager *manager) {
+    Q_D(PagesRequest);
+    
+    if ((d->manager) && (d->ownNetworkAccessManager)) {
+        delete d->manager;
+    }
+    
+    d->ownNetworkAccessManager = false;
+    d->manager = manager;
+}
+
+/*!
+    \brief Returns the maximum number of threads used to parse pages.
+    
+    The thread pool is shared by all instances of PagesRequest. By default, it uses QThread::idealThreadCount() 
+    threads.
+*/
+int PagesRequest::maximumParserThreads() {
+    return pageParserPool()->maxThreadCount();
+}
+
+/*!
+    \brief Sets the maximum number of threads used to parse pages to \a threads.
+*/
+void PagesRequest::setMaximumParserThreads(int threads) {
+    pageParserPool()->setMaxThreadCount(qMax(1, threads));
+}
+
+/*!
+    \brief Requests \a pages pages of the resource at \a resourcePath, starting at \a offset.
+    
+    Any request already in progress is canceled.
+*/
+void PagesRequest::get(const QString &resourcePath, const QVariantMap &filters, int offset, int pages) {
+    Q_D(PagesRequest);
+    
+    d->generation++;
+    d->abortReplies();
+    d->parsed.clear();
+    const QString base = EndpointStore::apiUrl();
+    d->url = QUrl(resourcePath.startsWith('/') ? base + resourcePath : base + '/' + resourcePath);
+    d->filters = filters;
+    d->limit = filters.value("limit", DEFAULT_PAGE_LIMIT).toInt();
+    
+    if (d->limit <= 0) {
+        d->limit = DEFAULT_PAGE_LIMIT;
+    }
+    
+    d->filters["limit"] = d->limit;
+    d->offset = qMax(0, offset);
+    d->count = qMax(0, pages);
+    d->nextToSend = 0;
+    d->nextToDeliver = 0;
+    d->redirectCount = 0;
+    d->error = Request::NoError;
+    d->errorString = QString();
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::PagesRequest::get" << d->url << filters << offset << pages;
+#endif
+    if (d->count == 0) {
+        d->setStatus(Request::Ready);
+        emit finished(this);
+        return;
+    }
+    
+    CircuitBreakerStore *breaker = CircuitBreakerStore::existingInstance();
+    
+    if ((breaker) && (!breaker->allow(d->url))) {
+        d->fail(Request::CircuitOpenError, tr("The server is unavailable"));
+        return;
+    }
+    
+    d->setStatus(Request::Loading);
+    d->startPages();
+}
+
+/*!
+    \brief Cancels the current request.
+    
+    Pages that have already been delivered with pageReady() are not affected.
+*/
+void PagesRequest::cancel() {
+    Q_D(PagesRequest);
+    
+    if (d->status == Request::Loading) {
+        d->generation++;
+        d->abortReplies();
+        d->parsed.clear();
+        d->setStatus(Request::Canceled);
+        emit finished(this);
+    }
+}
+
+/*!
+    \fn void PagesRequest::pageReady(int page, const QVariant &result)
+    \brief Emitted when the parsed \a result of \a page is available.
+    
+    Pages are numbered from 0 for the first page of the request, and are always emitted in order.
+*/
+
+/*!
+    \fn void PagesRequest::finished(CuteRadio::PagesRequest *request)
+    \brief Emitted when all pages have been delivered, or the request fails or is canceled.
+*/
+
+PagesRequestPrivate::PagesRequestPrivate(PagesRequest *parent) :
+    q_ptr(parent),
+    manager(0),
+    ownNetworkAccessManager(false),
+    engineMode(Request::defaultEngineMode()),
+    reqTemplateValid(false),
+    limit(DEFAULT_PAGE_LIMIT),
+    offset(0),
+    count(0),
+    maxConcurrent(DEFAULT_CONCURRENT_PAGES),
+    nextToSend(0),
+    nextToDeliver(0),
+    generation(0),
+    redirectCount(0),
+    status(Request::Null),
+    error(Request::NoError)
+{
+}
+
+QNetworkAccessManager* PagesRequestPrivate::networkAccessManager() {
+    if (!manager) {
+        Q_Q(PagesRequest);
+        ownNetworkAccessManager = true;
+        manager = new QNetworkAccessManager(q);
+    }
+    
+    return manager;
+}
+
+void PagesRequestPrivate::setStatus(Request::Status s) {
+    if (s != status) {
+        Q_Q(PagesRequest);
+        status = s;
+        emit q->statusChanged(s);
+    }
+}
+
+/*!
+    \internal
+    \brief Starts page downloads until maxConcurrent pages are downloading or parsing is backed up.
+    
+    Pages waiting to be delivered count against the limit, so a single slow page cannot cause the whole request 
+    to be buffered in memory. So do pages queued by the RateLimiter.
+*/
+void PagesRequestPrivate::startPages() {
+    Q_Q(PagesRequest);
+    
+    RateLimitStore *limiter = RateLimitStore::existingInstance();
+    
+    while ((nextToSend < count) && (nextToSend - nextToDeliver < maxConcurrent * 2)
+           && (replies.size() + jobs.size() + throttled.size() < maxConcurrent)) {
+        const int page = nextToSend++;
+        QUrl u(url);
+        QVariantMap query = filters;
+        query["offset"] = offset + page * limit;
+#if QT_VERSION >= 0x050000
+        QUrlQuery urlQuery(u);
+        addUrlQueryItems(&urlQuery, query);
+        u.setQuery(urlQuery);
+#else
+        addUrlQueryItems(&u, query);
+#endif
+        if ((limiter) && (!limiter->acquire(u, q, "_q_onThrottleReleased"))) {
+            throttled << qMakePair(page, u);
+        }
+        else {
+            sendPage(page, u);
+        }
+    }
+}
+
+void PagesRequestPrivate::sendPage(int page, const QUrl &u) {
+    Q_Q(PagesRequest);
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::PagesRequestPrivate::sendPage" << page << u;
+#endif
+    const QNetworkRequest request = requestTemplate().request(RedirectCache::rewrite(u));
+    
+    if (engineMode == Request::WorkerThreadEngine) {
+        RequestJob *job = new RequestJob(page, Request::GetOperation, request, QByteArray());
+        jobs.insert(job, page);
+        PagesRequest::connect(job, SIGNAL(finished(int,QVariant,bool,int,QString,int,QVariant)),
+                              q, SLOT(_q_onJobFinished(int,QVariant,bool,int,QString,int,QVariant)));
+        RequestEngine::instance()->start(job);
+        return;
+    }
+    
+    QNetworkReply *reply = networkAccessManager()->get(request);
+    replies.insert(reply, page);
+    PagesRequest::connect(reply, SIGNAL(finished()), q, SLOT(_q_onReplyFinished()));
+}
+
+/*!
+    \internal
+    \brief Returns the request template for the current access token and headers, creating it if needed.
+*/
+const RequestTemplate& PagesRequestPrivate::requestTemplate() {
+    if (!reqTemplateValid) {
+        reqTemplate = RequestTemplate(accessToken, headers);
+        reqTemplateValid = true;
+    }
+    
+    return reqTemplate;
+}
+
+void PagesRequestPrivate::fail(Request::Error e, const QString &es) {
+    Q_Q(PagesRequest);
+    
+    generation++;
+    abortReplies();
+    parsed.clear();
+    error = e;
+    errorString = es;
+    setStatus(Request::Failed);
+    emit q->finished(q);
+}
+
+void PagesRequestPrivate::abortReplies() {
+    QHashIterator<QNetworkReply*, int> iterator(replies);
+    replies.clear();
+    redirects.clear();
+    
+    if (!throttled.isEmpty()) {
+        throttled.clear();
+        RateLimitStore *limiter = RateLimitStore::existingInstance();
+        
+        if (limiter) {
+            limiter->cancel(q_ptr);
+        }
+    }
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        iterator.key()->disconnect();
+        iterator.key()->abort();
+        iterator.key()->deleteLater();
+    }
+    
+    // Jobs live in the RequestEngine thread, so they are aborted and deleted there.
+    foreach (RequestJob *job, jobs.keys()) {
+        job->disconnect();
+        QMetaObject::invokeMethod(job, "abort", Qt::QueuedConnection);
+        job->deleteLater();
+    }
+    
+    jobs.clear();
+}
+
+void PagesRequestPrivate::_q_onReplyFinished() {
+    Q_Q(PagesRequest);
+    
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(q->sender());
+    
+    if ((!reply) || (!replies.contains(reply))) {
+        return;
+    }
+    
+    const int page = replies.take(reply);
+    reply->deleteLater();
+    
+    if (redirects.value(page) < MAX_REDIRECTS) {
+        const QUrl redirect = RedirectCache::target(reply);
+        
+        if (!redirect.isEmpty()) {
+            redirects[page]++;
+            redirectCount++;
+            sendPage(page, redirect);
+            return;
+        }
+    }
+    
+    CircuitBreakerStore *breaker = CircuitBreakerStore::existingInstance();
+    
+    if (breaker) {
+        breaker->record(url, reply->error());
+    }
+    
+    EndpointStore *endpoints = EndpointStore::existingInstance();
+    
+    if ((endpoints) && (reply->error() != QNetworkReply::OperationCanceledError)) {
+        endpoints->record(reply->url(), isEndpointFailure(reply->error()));
+    }
+    
+    if (reply->error() != QNetworkReply::NoError) {
+        if (reply->error() != QNetworkReply::OperationCanceledError) {
+            RedirectCache::invalidate(reply->url());
+            fail(Request::Error(reply->error()), reply->errorString());
+        }
+        
+        return;
+    }
+    
+    PageParser *parser = new PageParser(generation, page, reply->readAll());
+    PagesRequest::connect(parser, SIGNAL(finished(int, int, QVariant, bool)),
+                          q, SLOT(_q_onPageParsed(int, int, QVariant, bool)));
+    pageParserPool()->start(parser);
+    startPages();
+}
+
+void PagesRequestPrivate::_q_onJobFinished(int, const QVariant &result, bool ok, int e, const QString &es, int hops,
+                                           const QVariant &) {
+    Q_Q(PagesRequest);
+    
+    RequestJob *job = qobject_cast<RequestJob*>(q->sender());
+    
+    if ((!job) || (!jobs.contains(job))) {
+        return;
+    }
+    
+    const int page = jobs.take(job);
+    job->deleteLater();
+    redirectCount += hops;
+    
+    CircuitBreakerStore *breaker = CircuitBreakerStore::existingInstance();
+    
+    if (breaker) {
+        breaker->record(url, QNetworkReply::NetworkError(e));
+    }
+    
+    EndpointStore *endpoints = EndpointStore::existingInstance();
+    
+    if ((endpoints) && (e != QNetworkReply::OperationCanceledError)) {
+        endpoints->record(url, isEndpointFailure(QNetworkReply::NetworkError(e)));
+    }
+    
+    if (e != QNetworkReply::NoError) {
+        if (e != QNetworkReply::OperationCanceledError) {
+            fail(Request::Error(e), es);
+        }
+        
+        return;
+    }
+    
+    // The page was parsed in the RequestEngine thread.
+    _q_onPageParsed(generation, page, result, ok);
+}
+
+void PagesRequestPrivate::_q_onThrottleReleased() {
+    if (!throttled.isEmpty()) {
+        const QPair<int, QUrl> page = throttled.takeFirst();
+        sendPage(page.first, page.second);
+    }
+}
+
+void PagesRequestPrivate::_q_onPageParsed(int gen, int page, const QVariant &result, bool ok) {
+    if ((gen != generation) || (status != Request::Loading)) {
+        return;
+    }
+    
+    if (!ok) {
+        fail(Request::ParseError, PagesRequest::tr("Unable to parse response"));
+        return;
+    }
+    
+    Q_Q(PagesRequest);
+    
+    parsed.insert(page, result);
+    
+    while (parsed.contains(nextToDeliver)) {
+        const int p = nextToDeliver++;
+        emit q->pageReady(p, parsed.take(p));
+        
+        if (gen != generation) {
+            // A slot connected to pageReady() restarted or canceled the request.
+            return;
+        }
+    }
+    
+    if (nextToDeliver == count) {
+        setStatus(Request::Ready);
+        emit q->finished(q);
+    }
+    else {
+        startPages();
+    }
+}
+
+}
+
+#include "moc_pagesrequest.cpp"
+#include "moc_pagesrequest_p.cpp"
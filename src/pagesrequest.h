@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_PAGESREQUEST_H
+#define CUTERADIO_PAGESREQUEST_H
+
+#include "request.h"
+
+namespace CuteRadio {
+
+class PagesRequestPrivate;
+
+class CUTERADIOSHARED_EXPORT PagesRequest : public QObject
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(QString accessToken READ accessToken WRITE setAccessToken NOTIFY accessTokenChanged)
+    Q_PROPERTY(CuteRadio::Request::EngineMode engineMode READ engineMode WRITE setEngineMode
+               NOTIFY engineModeChanged)
+    Q_PROPERTY(QVariantMap headers READ headers WRITE setHeaders NOTIFY headersChanged)
+    Q_PROPERTY(int maximumConcurrentPages READ maximumConcurrentPages WRITE setMaximumConcurrentPages
+               NOTIFY maximumConcurrentPagesChanged)
+    Q_PROPERTY(int pageCount READ pageCount NOTIFY statusChanged)
+    Q_PROPERTY(int pagesReady READ pagesReady NOTIFY pageReady)
+    Q_PROPERTY(CuteRadio::Request::Status status READ status NOTIFY statusChanged)
+    Q_PROPERTY(CuteRadio::Request::Error error READ error NOTIFY finished)
+    Q_PROPERTY(QString errorString READ errorString NOTIFY finished)
+    Q_PROPERTY(int redirectCount READ redirectCount NOTIFY finished)
+    
+public:
+    explicit PagesRequest(QObject *parent = 0);
+    ~PagesRequest();
+    
+    QString accessToken() const;
+    void setAccessToken(const QString &token);
+    
+    Request::EngineMode engineMode() const;
+    void setEngineMode(Request::EngineMode mode);
+    
+    QVariantMap headers() const;
+    void setHeaders(const QVariantMap &headers);
+    
+    int maximumConcurrentPages() const;
+    void setMaximumConcurrentPages(int pages);
+    
+    int pageCount() const;
+    int pagesReady() const;
+    
+    Request::Status status() const;
+    
+    Request::Error error() const;
+    QString errorString() const;
+    
+    int redirectCount() const;
+    
+    void setNetworkAccessManager(QNetworkAccessManager *manager);
+    
+    static int maximumParserThreads();
+    static void setMaximumParserThreads(int threads);
+    
+public Q_SLOTS:
+    void get(const QString &resourcePath, const QVariantMap &filters, int offset, int pages);
+    void cancel();
+    
+Q_SIGNALS:
+    void accessTokenChanged();
+    void engineModeChanged();
+    void headersChanged();
+    void maximumConcurrentPagesChanged();
+    void statusChanged(CuteRadio::Request::Status s);
+    void pageReady(int page, const QVariant &result);
+    void finished(CuteRadio::PagesRequest *request);
+    
+protected:
+    QScopedPointer<PagesRequestPrivate> d_ptr;
+    
+    Q_DECLARE_PRIVATE(PagesRequest)
+    
+    Q_PRIVATE_SLOT(d_func(), void _q_onReplyFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_onJobFinished(int, QVariant, bool, int, QString, int, QVariant))
+    Q_PRIVATE_SLOT(d_func(), void _q_onPageParsed(int, int, QVariant, bool))
+    Q_PRIVATE_SLOT(d_func(), void _q_onThrottleReleased())
+    
+private:
+    Q_DISABLE_COPY(PagesRequest)
+};
+
+}
+
+#endif // CUTERADIO_PAGESREQUEST_H
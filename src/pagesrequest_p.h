@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_PAGESREQUEST_P_H
+#define CUTERADIO_PAGESREQUEST_P_H
+
+#include "pagesrequest.h"
+#include "request_p.h"
+#include <QRunnable>
+
+namespace CuteRadio {
+
+/*!
+    \internal
+    \brief Parses the body of one downloaded page in a QThreadPool thread.
+    
+    The parser belongs to the thread that created it, and is deleted there with deleteLater() once it has run.
+*/
+class PageParser : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    PageParser(int generation, int page, const QByteArray &response);
+    
+    void run();
+
+Q_SIGNALS:
+    void finished(int generation, int page, const QVariant &result, bool ok);
+
+private:
+    int generation;
+    int page;
+    QByteArray response;
+};
+
+class PagesRequestPrivate
+{
+
+public:
+    PagesRequestPrivate(PagesRequest *parent);
+    
+    QNetworkAccessManager* networkAccessManager();
+    
+    void setStatus(Request::Status s);
+    
+    void startPages();
+    void sendPage(int page, const QUrl &u);
+    
+    const RequestTemplate& requestTemplate();
+    
+    void fail(Request::Error e, const QString &es);
+    
+    void abortReplies();
+    
+    void _q_onReplyFinished();
+    void _q_onJobFinished(int id, const QVariant &result, bool ok, int e, const QString &es, int hops,
+                          const QVariant &rows);
+    void _q_onPageParsed(int gen, int page, const QVariant &result, bool ok);
+    void _q_onThrottleReleased();
+    
+    PagesRequest *q_ptr;
+    
+    QNetworkAccessManager *manager;
+    
+    bool ownNetworkAccessManager;
+    
+    QString accessToken;
+    
+    Request::EngineMode engineMode;
+    
+    QVariantMap headers;
+    
+    // Built from accessToken and headers when the first page is sent, and reused for every page after it.
+    RequestTemplate reqTemplate;
+    bool reqTemplateValid;
+    
+    QUrl url;
+    
+    QVariantMap filters;
+    
+    int limit;
+    int offset;
+    int count;
+    
+    int maxConcurrent;
+    
+    int nextToSend;
+    int nextToDeliver;
+    
+    int generation;
+    
+    QHash<QNetworkReply*, int> replies;
+    QHash<RequestJob*, int> jobs;
+    QHash<int, int> redirects;
+    int redirectCount;
+    
+    // Pages waiting for a RateLimiter token, in the order they were queued.
+    QList<QPair<int, QUrl> > throttled;
+    
+    QMap<int, QVariant> parsed;
+    
+    Request::Status status;
+    Request::Error error;
+    QString errorString;
+    
+    Q_DECLARE_PUBLIC(PagesRequest)
+};
+
+}
+
+#endif // CUTERADIO_PAGESREQUEST_P_H
@@ -0,0 +1,531 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "playedstationsjournal.h"
+#include "playedstationsjournal_p.h"
+#include "json.h"
+#include "resourcesrequest.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTimer>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#endif
+#ifdef CUTERADIO_DEBUG
+#include <QDebug>
+#endif
+
+namespace CuteRadio {
+
+static const int DEFAULT_FLUSH_INTERVAL = 300000;
+static const int MAXIMUM_CONCURRENT_UPLOADS = 4;
+
+static QByteArray journalLine(const JournalEntry &entry, int plays) {
+    QVariantMap line;
+    line["station"] = entry.station;
+    line["lastPlayed"] = entry.lastPlayed.toString(Qt::ISODate);
+    line["plays"] = plays;
+    return QtJson::Json::serialize(line) + '\n';
+}
+
+/*!
+    \class PlayedStationsJournal
+    \brief Records played stations locally and uploads them to the cuteRadio Data API in batches.
+    
+    \ingroup requests
+    
+    Recording a play with recordPlay() does not make a request. The play is appended to a journal file, so it 
+    survives restarts, and repeat plays of the same station are merged. Pending plays are uploaded to 
+    /playedstations when flushInterval has passed since the first unsent play, or when flush() is called, for 
+    example when the application is idle. Each station is uploaded once with the time of its latest play, whatever 
+    the number of plays, since the played stations resource holds the time each station was last played.
+    
+    All PlayedStationsJournal objects share one journal. While plays are pending, a ResourcesModel or StationsModel 
+    with the "playedstations" resource shows them before the stations loaded from the server.
+    
+    Example usage:
+    
+    \code
+    using namespace CuteRadio;
+    
+    ...
+    
+    PlayedStationsJournal *journal = new PlayedStationsJournal(this);
+    journal->setAccessToken(token);
+    journal->recordPlay(station);
+    \endcode
+*/
+PlayedStationsJournal::PlayedStationsJournal(QObject *parent) :
+    QObject(parent)
+{
+    PlayedStationsStore *store = PlayedStationsStore::instance();
+    connect(store, SIGNAL(accessTokenChanged()), this, SIGNAL(accessTokenChanged()));
+    connect(store, SIGNAL(flushIntervalChanged()), this, SIGNAL(flushIntervalChanged()));
+    connect(store, SIGNAL(journalPathChanged()), this, SIGNAL(journalPathChanged()));
+    connect(store, SIGNAL(pendingCountChanged(int)), this, SIGNAL(pendingCountChanged(int)));
+    connect(store, SIGNAL(statusChanged(CuteRadio::Request::Status)),
+            this, SIGNAL(statusChanged(CuteRadio::Request::Status)));
+    connect(store, SIGNAL(playRecorded(QVariantMap)), this, SIGNAL(playRecorded(QVariantMap)));
+    connect(store, SIGNAL(flushed()), this, SIGNAL(flushed()));
+}
+
+/*!
+    \property QString PlayedStationsJournal::accessToken
+    \brief The access token used to upload plays.
+    
+    Plays are recorded without an access token, but are only uploaded once one is set.
+*/
+QString PlayedStationsJournal::accessToken() const {
+    return PlayedStationsStore::instance()->accessToken;
+}
+
+void PlayedStationsJournal::setAccessToken(const QString &token) {
+    PlayedStationsStore::instance()->setAccessToken(token);
+}
+
+/*!
+    \property int PlayedStationsJournal::flushInterval
+    \brief The time in milliseconds between the first unsent play and the upload of pending plays.
+    
+    The default value is 300000 (5 minutes). A value of 0 disables automatic uploads.
+*/
+int PlayedStationsJournal::flushInterval() const {
+    return PlayedStationsStore::instance()->timer->interval();
+}
+
+void PlayedStationsJournal::setFlushInterval(int interval) {
+    PlayedStationsStore::instance()->setFlushInterval(interval);
+}
+
+/*!
+    \property QString PlayedStationsJournal::journalPath
+    \brief The path of the journal file.
+    
+    Plays pending in memory are kept when the path changes, and pending plays found in the new file are added. 
+    Once they have been written to the new file, the previous file is removed, so its plays are not counted 
+    again.
+*/
+QString PlayedStationsJournal::journalPath() const {
+    return PlayedStationsStore::instance()->path;
+}
+
+void PlayedStationsJournal::setJournalPath(const QString &path) {
+    PlayedStationsStore::instance()->setJournalPath(path);
+}
+
+/*!
+    \property int PlayedStationsJournal::pendingCount
+    \brief The number of stations with plays that have not been uploaded.
+*/
+int PlayedStationsJournal::pendingCount() const {
+    return PlayedStationsStore::instance()->entries.size();
+}
+
+/*!
+    \property enum PlayedStationsJournal::status
+    \brief The status of the most recent upload.
+*/
+Request::Status PlayedStationsJournal::status() const {
+    return PlayedStationsStore::instance()->status;
+}
+
+/*!
+    \brief Records a play of \a station, which must contain the station id.
+*/
+void PlayedStationsJournal::recordPlay(const QVariantMap &station) {
+    PlayedStationsStore::instance()->recordPlay(station);
+}
+
+/*!
+    \brief Returns the stations with pending plays, most recently played first.
+    
+    The lastPlayed property of each station is the time of its most recent play.
+*/
+QVariantList PlayedStationsJournal::pendingStations() const {
+    return PlayedStationsStore::instance()->pendingStations();
+}
+
+/*!
+    \brief Uploads the pending plays now.
+    
+    Every station pending when flush() is called is uploaded, with up to 4 uploads in progress at a time. If an 
+    upload fails, the remaining plays are kept and retried after flushInterval.
+*/
+void PlayedStationsJournal::flush() {
+    PlayedStationsStore::instance()->flush();
+}
+
+/*!
+    \fn void PlayedStationsJournal::playRecorded(const QVariantMap &station)
+    \brief Emitted when a play of \a station is recorded.
+*/
+
+/*!
+    \fn void PlayedStationsJournal::flushed()
+    \brief Emitted when all pending plays have been uploaded.
+*/
+
+PlayedStationsStore* PlayedStationsStore::self = 0;
+
+PlayedStationsStore::PlayedStationsStore() :
+    QObject(QCoreApplication::instance()),
+    timer(new QTimer(this)),
+    status(Request::Null),
+    flushFailed(false)
+{
+#if QT_VERSION >= 0x050000
+    path = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation)
+           + "/cuteradio/playedstations.journal";
+#else
+    path = QDir::homePath() + "/.cuteradio/playedstations.journal";
+#endif
+    timer->setSingleShot(true);
+    timer->setInterval(DEFAULT_FLUSH_INTERVAL);
+    connect(timer, SIGNAL(timeout()), this, SLOT(flush()));
+    readJournal();
+    
+    if (!entries.isEmpty()) {
+        timer->start();
+    }
+}
+
+PlayedStationsStore::~PlayedStationsStore() {
+    if (self == this) {
+        self = 0;
+    }
+}
+
+/*!
+    \internal
+    \brief Returns the store, creating it and reading the journal if required.
+    
+    The store is owned by the application object.
+*/
+PlayedStationsStore* PlayedStationsStore::instance() {
+    if (!self) {
+        self = new PlayedStationsStore;
+    }
+    
+    return self;
+}
+
+/*!
+    \internal
+    \brief Returns the store if it has been created, otherwise 0.
+*/
+PlayedStationsStore* PlayedStationsStore::existingInstance() {
+    return self;
+}
+
+void PlayedStationsStore::setAccessToken(const QString &token) {
+    if (token != accessToken) {
+        accessToken = token;
+        emit accessTokenChanged();
+    }
+}
+
+void PlayedStationsStore::setFlushInterval(int interval) {
+    interval = qMax(0, interval);
+    
+    if (interval != timer->interval()) {
+        timer->setInterval(interval);
+        
+        if (interval == 0) {
+            timer->stop();
+        }
+        else if ((!entries.isEmpty()) && (uploads.isEmpty())) {
+            timer->start();
+        }
+        
+        emit flushIntervalChanged();
+    }
+}
+
+void PlayedStationsStore::setJournalPath(const QString &p) {
+    if (p == path) {
+        return;
+    }
+    
+    const QString previous = path;
+    path = p;
+    readJournal();
+    
+    // The previous file is kept if the plays could not be moved, so none are lost.
+    if (writeJournal()) {
+        QFile::remove(previous);
+    }
+    
+    emit journalPathChanged();
+    emit pendingCountChanged(entries.size());
+}
+
+void PlayedStationsStore::recordPlay(const QVariantMap &station) {
+    const QString id = station.value("id").toString();
+    
+    if (id.isEmpty()) {
+        return;
+    }
+    
+    addEntry(station, QDateTime::currentDateTime().toUTC(), 1);
+    const JournalEntry &entry = entries[id];
+    append(entry, 1);
+    emit playRecorded(playedStation(entry));
+    emit pendingCountChanged(entries.size());
+    
+    if ((timer->interval() > 0) && (!timer->isActive()) && (uploads.isEmpty())) {
+        timer->start();
+    }
+}
+
+QVariantList PlayedStationsStore::pendingStations() const {
+    QMap<QDateTime, QVariantMap> sorted;
+    QHashIterator<QString, JournalEntry> iterator(entries);
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        sorted.insertMulti(iterator.value().lastPlayed, playedStation(iterator.value()));
+    }
+    
+    QVariantList stations;
+    QMapIterator<QDateTime, QVariantMap> sortedIterator(sorted);
+    sortedIterator.toBack();
+    
+    while (sortedIterator.hasPrevious()) {
+        sortedIterator.previous();
+        stations << sortedIterator.value();
+    }
+    
+    return stations;
+}
+
+/*!
+    \internal
+    \brief Returns the pending stations followed by those of \a stations that are not pending.
+*/
+QVariantList PlayedStationsStore::merge(const QVariantList &stations) const {
+    if (entries.isEmpty()) {
+        return stations;
+    }
+    
+    QVariantList merged = pendingStations();
+    
+    foreach (const QVariant &station, stations) {
+        if (!entries.contains(station.toMap().value("id").toString())) {
+            merged << station;
+        }
+    }
+    
+    return merged;
+}
+
+void PlayedStationsStore::flush() {
+    timer->stop();
+    
+    if ((accessToken.isEmpty()) || (!uploads.isEmpty())) {
+        return;
+    }
+    
+    flushFailed = false;
+    queued = entries.keys();
+    startUploads();
+    
+    if (!uploads.isEmpty()) {
+        setStatus(Request::Loading);
+    }
+}
+
+/*!
+    \internal
+    \brief Starts uploads of queued stations until MAXIMUM_CONCURRENT_UPLOADS are in progress.
+*/
+void PlayedStationsStore::startUploads() {
+    while ((!queued.isEmpty()) && (uploads.size() < MAXIMUM_CONCURRENT_UPLOADS)) {
+        const QString id = queued.takeFirst();
+        QHash<QString, JournalEntry>::iterator iterator = entries.find(id);
+        
+        if ((iterator == entries.end()) || (iterator.value().sending != 0)) {
+            continue;
+        }
+        
+        iterator.value().sending = iterator.value().plays;
+        ResourcesRequest *request = new ResourcesRequest(this);
+        request->setAccessToken(accessToken);
+        connect(request, SIGNAL(finished(CuteRadio::Request*)),
+                this, SLOT(onUploadFinished(CuteRadio::Request*)));
+        uploads[request] = id;
+        QVariantMap resource;
+        resource["stationId"] = id;
+        resource["lastPlayed"] = iterator.value().lastPlayed.toString(Qt::ISODate);
+        request->insert(resource, "/playedstations");
+    }
+}
+
+void PlayedStationsStore::onUploadFinished(Request *request) {
+    ResourcesRequest *upload = static_cast<ResourcesRequest*>(request);
+    const QString id = uploads.take(upload);
+    upload->deleteLater();
+    
+    QHash<QString, JournalEntry>::iterator iterator = entries.find(id);
+    
+    if (iterator != entries.end()) {
+        const int sent = iterator.value().sending;
+        iterator.value().sending = 0;
+        
+        if (request->status() == Request::Ready) {
+            iterator.value().plays -= sent;
+            
+            // Plays recorded during the upload remain pending.
+            if (iterator.value().plays <= 0) {
+                entries.erase(iterator);
+            }
+        }
+    }
+    
+    if (request->status() != Request::Ready) {
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::PlayedStationsStore::onUploadFinished: Upload failed" << id << request->errorString();
+#endif
+        flushFailed = true;
+    }
+    
+    // The rest of the stations queued by flush() are sent as earlier uploads finish.
+    startUploads();
+    
+    if (!uploads.isEmpty()) {
+        return;
+    }
+    
+    writeJournal();
+    emit pendingCountChanged(entries.size());
+    
+    if (flushFailed) {
+        setStatus(Request::Failed);
+    }
+    else {
+        setStatus(Request::Ready);
+        
+        if (entries.isEmpty()) {
+            emit flushed();
+        }
+    }
+    
+    if ((!entries.isEmpty()) && (timer->interval() > 0)) {
+        timer->start();
+    }
+}
+
+void PlayedStationsStore::setStatus(Request::Status s) {
+    if (s != status) {
+        status = s;
+        emit statusChanged(s);
+    }
+}
+
+void PlayedStationsStore::addEntry(const QVariantMap &station, const QDateTime &lastPlayed, int plays) {
+    JournalEntry &entry = entries[station.value("id").toString()];
+    
+    if ((!entry.lastPlayed.isValid()) || (lastPlayed >= entry.lastPlayed)) {
+        entry.station = station;
+        entry.lastPlayed = lastPlayed;
+    }
+    
+    entry.plays += plays;
+}
+
+void PlayedStationsStore::append(const JournalEntry &entry, int plays) {
+    QDir().mkpath(QFileInfo(path).path());
+    QFile file(path);
+    
+    if (!file.open(QFile::WriteOnly | QFile::Append)) {
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::PlayedStationsStore::append: Unable to open" << path << file.errorString();
+#endif
+        return;
+    }
+    
+    file.write(journalLine(entry, plays));
+}
+
+void PlayedStationsStore::readJournal() {
+    QFile file(path);
+    
+    if (!file.open(QFile::ReadOnly)) {
+        return;
+    }
+    
+    while (!file.atEnd()) {
+        bool ok = false;
+        const QVariantMap line = QtJson::Json::parse(QString::fromUtf8(file.readLine().trimmed()), ok).toMap();
+        const QVariantMap station = line.value("station").toMap();
+        
+        // A line cut short by a crash is skipped.
+        if ((ok) && (!station.value("id").toString().isEmpty())) {
+            QDateTime lastPlayed = QDateTime::fromString(line.value("lastPlayed").toString(), Qt::ISODate);
+            lastPlayed.setTimeSpec(Qt::UTC);
+            addEntry(station, lastPlayed, qMax(1, line.value("plays").toInt()));
+        }
+    }
+}
+
+/*!
+    \internal
+    \brief Rewrites the journal file with the pending plays, and returns true if it was written.
+*/
+bool PlayedStationsStore::writeJournal() {
+    if (entries.isEmpty()) {
+        QFile::remove(path);
+        return true;
+    }
+    
+    QDir().mkpath(QFileInfo(path).path());
+    QFile file(path);
+    
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::PlayedStationsStore::writeJournal: Unable to open" << path << file.errorString();
+#endif
+        return false;
+    }
+    
+    QHashIterator<QString, JournalEntry> iterator(entries);
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        
+        if (file.write(journalLine(iterator.value(), iterator.value().plays)) == -1) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/*!
+    \internal
+    \brief Returns the station of \a entry, with lastPlayed set to the time of its latest play.
+*/
+QVariantMap PlayedStationsStore::playedStation(const JournalEntry &entry) {
+    QVariantMap station = entry.station;
+    station["lastPlayed"] = entry.lastPlayed.toString(Qt::ISODate);
+    return station;
+}
+
+}
+
+#include "moc_playedstationsjournal.cpp"
+#include "moc_playedstationsjournal_p.cpp"
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_PLAYEDSTATIONSJOURNAL_H
+#define CUTERADIO_PLAYEDSTATIONSJOURNAL_H
+
+#include "request.h"
+
+namespace CuteRadio {
+
+class CUTERADIOSHARED_EXPORT PlayedStationsJournal : public QObject
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(QString accessToken READ accessToken WRITE setAccessToken NOTIFY accessTokenChanged)
+    Q_PROPERTY(int flushInterval READ flushInterval WRITE setFlushInterval NOTIFY flushIntervalChanged)
+    Q_PROPERTY(QString journalPath READ journalPath WRITE setJournalPath NOTIFY journalPathChanged)
+    Q_PROPERTY(int pendingCount READ pendingCount NOTIFY pendingCountChanged)
+    Q_PROPERTY(CuteRadio::Request::Status status READ status NOTIFY statusChanged)
+    
+public:
+    explicit PlayedStationsJournal(QObject *parent = 0);
+    
+    QString accessToken() const;
+    void setAccessToken(const QString &token);
+    
+    int flushInterval() const;
+    void setFlushInterval(int interval);
+    
+    QString journalPath() const;
+    void setJournalPath(const QString &path);
+    
+    int pendingCount() const;
+    
+    Request::Status status() const;
+    
+    Q_INVOKABLE void recordPlay(const QVariantMap &station);
+    
+    Q_INVOKABLE QVariantList pendingStations() const;
+    
+public Q_SLOTS:
+    void flush();
+    
+Q_SIGNALS:
+    void accessTokenChanged();
+    void flushIntervalChanged();
+    void journalPathChanged();
+    void pendingCountChanged(int count);
+    void statusChanged(CuteRadio::Request::Status s);
+    void playRecorded(const QVariantMap &station);
+    void flushed();
+    
+private:
+    Q_DISABLE_COPY(PlayedStationsJournal)
+};
+
+}
+
+#endif // CUTERADIO_PLAYEDSTATIONSJOURNAL_H
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_PLAYEDSTATIONSJOURNAL_P_H
+#define CUTERADIO_PLAYEDSTATIONSJOURNAL_P_H
+
+#include "playedstationsjournal.h"
+#include <QDateTime>
+#include <QHash>
+#include <QStringList>
+
+class QTimer;
+
+namespace CuteRadio {
+
+class ResourcesRequest;
+
+/*!
+    \internal
+    \brief The plays of one station that have not yet been uploaded.
+*/
+class JournalEntry
+{
+
+public:
+    JournalEntry() : plays(0), sending(0) {}
+    
+    QVariantMap station;
+    QDateTime lastPlayed;
+    int plays;
+    int sending;
+};
+
+/*!
+    \internal
+    \brief The process-wide journal of plays shared by every PlayedStationsJournal object.
+    
+    Each play is appended to the journal file as one line of JSON, and repeat plays of a station are merged in 
+    memory. When plays are uploaded, the file is rewritten with one line for each station still pending.
+*/
+class PlayedStationsStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static PlayedStationsStore* instance();
+    static PlayedStationsStore* existingInstance();
+    
+    ~PlayedStationsStore();
+    
+    void setAccessToken(const QString &token);
+    void setFlushInterval(int interval);
+    void setJournalPath(const QString &path);
+    
+    void recordPlay(const QVariantMap &station);
+    
+    QVariantList pendingStations() const;
+    QVariantList merge(const QVariantList &stations) const;
+    
+    QString accessToken;
+    QString path;
+    
+    QHash<QString, JournalEntry> entries;
+    QHash<ResourcesRequest*, QString> uploads;
+    QStringList queued;
+    
+    QTimer *timer;
+    
+    Request::Status status;
+
+public Q_SLOTS:
+    void flush();
+
+Q_SIGNALS:
+    void accessTokenChanged();
+    void flushIntervalChanged();
+    void journalPathChanged();
+    void pendingCountChanged(int count);
+    void statusChanged(CuteRadio::Request::Status s);
+    void playRecorded(const QVariantMap &station);
+    void flushed();
+
+private Q_SLOTS:
+    void onUploadFinished(CuteRadio::Request *request);
+
+private:
+    PlayedStationsStore();
+    
+    void setStatus(Request::Status s);
+    
+    void startUploads();
+    
+    void addEntry(const QVariantMap &station, const QDateTime &lastPlayed, int plays);
+    void append(const JournalEntry &entry, int plays);
+    void readJournal();
+    bool writeJournal();
+    
+    static QVariantMap playedStation(const JournalEntry &entry);
+    
+    bool flushFailed;
+    
+    static PlayedStationsStore *self;
+};
+
+}
+
+#endif // CUTERADIO_PLAYEDSTATIONSJOURNAL_P_H
@@ -0,0 +1,461 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "playlistresolver.h"
+#include "playlistresolver_p.h"
+#include "request_p.h"
+#include <QCoreApplication>
+#include <QRegExp>
+#include <QTimer>
+#include <QUrl>
+#ifdef CUTERADIO_DEBUG
+#include <QDebug>
+#endif
+
+namespace CuteRadio {
+
+static const char* const PLAYLIST_SUFFIXES[] = {
+    ".pls",
+    ".m3u",
+    ".asx"
+};
+
+static const int PLAYLIST_SUFFIX_COUNT = sizeof(PLAYLIST_SUFFIXES) / sizeof(PLAYLIST_SUFFIXES[0]);
+
+// A playlist request is canceled after this time in milliseconds.
+static const int REQUEST_TIMEOUT = 10000;
+
+// A playlist request is canceled once its response is larger than this, since it is probably a stream.
+static const qint64 MAX_PLAYLIST_SIZE = 65536;
+
+// Failed playlists are requested again after this time, rather than the cacheTime.
+static const int FAILED_CACHE_TIME = 60000;
+
+// Expired playlists are purged when the cache grows beyond this size.
+static const int MAX_PLAYLISTS = 2000;
+
+/*!
+    \class PlaylistResolver
+    \brief Resolves station sources that are playlists to the stream urls they contain.
+    
+    \ingroup requests
+    
+    Many station sources are .pls, .m3u or .asx playlists rather than streams, and a player must download and 
+    parse the playlist before it can start playing. PlaylistResolver does this ahead of time, so that streamUrl() 
+    returns a stream that can be played immediately. All PlaylistResolver objects share one cache.
+    
+    Sources are recognised as playlists by the suffix of their path. Any other source is its own stream url, and 
+    is never requested. An HLS .m3u8 playlist is also returned as its own stream url, since players handle it 
+    directly.
+    
+    A playlist request that takes longer than 10 seconds, or whose response is larger than 64 KiB, fails and is 
+    requested again after a minute.
+    
+    Example usage:
+    
+    \code
+    import QtQuick 1.0
+    import CuteRadio 1.0
+    
+    PlaylistResolver {
+        id: resolver
+    }
+    
+    ListView {
+        model: StationsModel {
+            prefetchPlaylists: true
+        }
+        delegate: Text {
+            text: title
+            
+            MouseArea {
+                anchors.fill: parent
+                onClicked: player.source = (streamUrl ? streamUrl : source)
+            }
+        }
+    }
+    \endcode
+    
+    \sa StationsModel::prefetchPlaylists
+*/
+PlaylistResolver::PlaylistResolver(QObject *parent) :
+    QObject(parent)
+{
+    PlaylistStore *store = PlaylistStore::instance();
+    connect(store, SIGNAL(pendingCountChanged(int)), this, SIGNAL(pendingCountChanged(int)));
+    connect(store, SIGNAL(resolved(QString, QStringList)), this, SIGNAL(resolved(QString, QStringList)));
+}
+
+/*!
+    \property int PlaylistResolver::maximumConcurrentRequests
+    \brief The maximum number of playlists requested at once.
+    
+    The default value is 4.
+*/
+int PlaylistResolver::maximumConcurrentRequests() const {
+    return PlaylistStore::instance()->maximumConcurrentRequests;
+}
+
+void PlaylistResolver::setMaximumConcurrentRequests(int maximum) {
+    PlaylistStore *store = PlaylistStore::instance();
+    maximum = qMax(1, maximum);
+    
+    if (maximum != store->maximumConcurrentRequests) {
+        store->maximumConcurrentRequests = maximum;
+        store->startRequests();
+        emit maximumConcurrentRequestsChanged();
+    }
+}
+
+/*!
+    \property int PlaylistResolver::cacheTime
+    \brief The time in milliseconds for which the stream urls of a playlist are cached.
+    
+    The default value is 3600000 (1 hour).
+*/
+int PlaylistResolver::cacheTime() const {
+    return PlaylistStore::instance()->cacheTime;
+}
+
+void PlaylistResolver::setCacheTime(int time) {
+    PlaylistStore *store = PlaylistStore::instance();
+    time = qMax(0, time);
+    
+    if (time != store->cacheTime) {
+        store->cacheTime = time;
+        emit cacheTimeChanged();
+    }
+}
+
+/*!
+    \property int PlaylistResolver::pendingCount
+    \brief The number of playlists that are queued or being requested.
+*/
+int PlaylistResolver::pendingCount() const {
+    return PlaylistStore::instance()->pending.size();
+}
+
+/*!
+    \brief Returns true if \a source is a playlist that needs to be resolved.
+*/
+bool PlaylistResolver::isPlaylist(const QString &source) {
+    const QString path = QUrl(source).path().toLower();
+    
+    for (int i = 0; i < PLAYLIST_SUFFIX_COUNT; i++) {
+        if (path.endsWith(QLatin1String(PLAYLIST_SUFFIXES[i]))) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+/*!
+    \brief Returns true if the stream urls of \a source are known.
+    
+    A source that is not a playlist is always resolved.
+*/
+bool PlaylistResolver::isResolved(const QString &source) const {
+    return (!isPlaylist(source)) || (PlaylistStore::instance()->playlist(source));
+}
+
+/*!
+    \brief Returns the first stream url of \a source.
+    
+    Returns \a source if it is not a playlist, or an empty string if the playlist has not been resolved or 
+    contains no streams.
+*/
+QString PlaylistResolver::streamUrl(const QString &source) const {
+    const QStringList urls = streamUrls(source);
+    return urls.isEmpty() ? QString() : urls.first();
+}
+
+/*!
+    \brief Returns the stream urls of \a source, in playlist order.
+    
+    \sa streamUrl()
+*/
+QStringList PlaylistResolver::streamUrls(const QString &source) const {
+    if (!isPlaylist(source)) {
+        return QStringList() << source;
+    }
+    
+    const ResolvedPlaylist *playlist = PlaylistStore::instance()->playlist(source);
+    return playlist ? playlist->urls : QStringList();
+}
+
+/*!
+    \brief Requests the playlist at \a source in the background, unless it is cached or not a playlist.
+    
+    \sa resolved()
+*/
+void PlaylistResolver::resolve(const QString &source) {
+    PlaylistStore::instance()->resolve(source);
+}
+
+/*!
+    \brief Cancels all queued and active playlist requests.
+*/
+void PlaylistResolver::cancel() {
+    PlaylistStore::instance()->cancel();
+}
+
+/*!
+    \brief Removes all cached playlists.
+*/
+void PlaylistResolver::clearCache() {
+    PlaylistStore::instance()->playlists.clear();
+}
+
+/*!
+    \fn void PlaylistResolver::resolved(const QString &source, const QStringList &streamUrls)
+    \brief Emitted when the playlist at \a source has been requested.
+    
+    \a streamUrls is empty if the request failed or the playlist contains no streams.
+*/
+
+PlaylistRequest::PlaylistRequest(QObject *parent) :
+    Request(parent),
+    timer(new QTimer(this))
+{
+    Q_D(Request);
+    
+    d->rawResponse = true;
+    d->maximumResponseSize = MAX_PLAYLIST_SIZE;
+    setEngineMode(DirectEngine);
+    timer->setSingleShot(true);
+}
+
+/*!
+    \internal
+    \brief Sends a GET request to \a source, canceling it after \a timeout milliseconds.
+*/
+void PlaylistRequest::start(const QString &source, int timeout) {
+    this->source = source;
+    setUrl(QUrl(source));
+    timer->start(timeout);
+    get(false);
+}
+
+PlaylistStore* PlaylistStore::self = 0;
+
+PlaylistStore::PlaylistStore() :
+    QObject(QCoreApplication::instance()),
+    maximumConcurrentRequests(4),
+    cacheTime(3600000),
+    startQueued(false)
+{
+    clock.start();
+}
+
+PlaylistStore::~PlaylistStore() {
+    if (self == this) {
+        self = 0;
+    }
+}
+
+/*!
+    \internal
+    \brief Returns the store, creating it if required.
+    
+    The store is owned by the application object.
+*/
+PlaylistStore* PlaylistStore::instance() {
+    if (!self) {
+        self = new PlaylistStore;
+    }
+    
+    return self;
+}
+
+/*!
+    \internal
+    \brief Returns the store if it exists, otherwise 0.
+*/
+PlaylistStore* PlaylistStore::existingInstance() {
+    return self;
+}
+
+/*!
+    \internal
+    \brief Returns the cached playlist for \a source, or 0 if there is none.
+    
+    Expired playlists are still returned until they are requested again.
+*/
+const ResolvedPlaylist* PlaylistStore::playlist(const QString &source) const {
+    QHash<QString, ResolvedPlaylist>::const_iterator iterator = playlists.constFind(source);
+    return iterator != playlists.constEnd() ? &iterator.value() : 0;
+}
+
+/*!
+    \internal
+    \brief Returns the stream urls in \a text, the playlist downloaded from \a source.
+    
+    The format is detected from the content: PLS entries are File<n>=url lines, ASX entries are the href 
+    attributes of ref elements, and anything else is read as M3U. Relative urls are resolved against \a source.
+*/
+QStringList PlaylistStore::parse(const QString &source, const QString &text) {
+    QStringList urls;
+    const QString trimmed = text.trimmed();
+    
+    if (trimmed.contains("#EXT-X-")) {
+        // An HLS playlist is played as a stream.
+        urls << source;
+        return urls;
+    }
+    
+    if (trimmed.startsWith('<')) {
+        QRegExp re("<ref\\s+href\\s*=\\s*[\"']([^\"']+)[\"']", Qt::CaseInsensitive);
+        int pos = 0;
+        
+        while ((pos = re.indexIn(trimmed, pos)) != -1) {
+            urls << re.cap(1).trimmed().replace("&amp;", "&");
+            pos += re.matchedLength();
+        }
+    }
+    else {
+        const bool pls = trimmed.startsWith("[playlist]", Qt::CaseInsensitive);
+        QRegExp re("^File\\d+\\s*=\\s*(\\S.*)$", Qt::CaseInsensitive);
+        
+        foreach (const QString &l, trimmed.split(QRegExp("[\\r\\n]+"), QString::SkipEmptyParts)) {
+            const QString line = l.trimmed();
+            
+            if (pls) {
+                if (re.exactMatch(line)) {
+                    urls << re.cap(1).trimmed();
+                }
+            }
+            else if ((!line.isEmpty()) && (!line.startsWith('#'))) {
+                urls << line;
+            }
+        }
+    }
+    
+    const QUrl base(source);
+    
+    for (int i = 0; i < urls.size(); i++) {
+        const QUrl url(urls.at(i));
+        
+        if (url.isRelative()) {
+            urls[i] = base.resolved(url).toString();
+        }
+    }
+    
+    return urls;
+}
+
+/*!
+    \internal
+    \brief Queues the playlist at \a source to be requested, unless it is pending, cached or not a playlist.
+    
+    Requests are started from the event loop, so this is safe to call while a model is returning data.
+*/
+void PlaylistStore::resolve(const QString &source) {
+    if ((source.isEmpty()) || (pending.contains(source)) || (!PlaylistResolver::isPlaylist(source))) {
+        return;
+    }
+    
+    const ResolvedPlaylist *p = playlist(source);
+    
+    if ((p) && (p->expires > clock.elapsed())) {
+        return;
+    }
+    
+    queue << source;
+    pending.insert(source);
+    emit pendingCountChanged(pending.size());
+    
+    if (!startQueued) {
+        startQueued = true;
+        QMetaObject::invokeMethod(this, "startRequests", Qt::QueuedConnection);
+    }
+}
+
+void PlaylistStore::cancel() {
+    queue.clear();
+    pending.clear();
+    
+    foreach (PlaylistRequest *request, requests) {
+        request->timer->stop();
+        request->disconnect(this);
+        request->cancel();
+        request->deleteLater();
+    }
+    
+    requests.clear();
+    emit pendingCountChanged(0);
+}
+
+void PlaylistStore::startRequests() {
+    startQueued = false;
+    
+    while ((requests.size() < maximumConcurrentRequests) && (!queue.isEmpty())) {
+        PlaylistRequest *request = new PlaylistRequest(this);
+        connect(request, SIGNAL(finished(CuteRadio::Request*)), this, SLOT(onRequestFinished(CuteRadio::Request*)));
+        connect(request->timer, SIGNAL(timeout()), this, SLOT(onRequestTimeout()));
+        requests << request;
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::PlaylistStore::startRequests" << queue.first();
+#endif
+        request->start(queue.takeFirst(), REQUEST_TIMEOUT);
+    }
+}
+
+void PlaylistStore::onRequestFinished(Request *request) {
+    PlaylistRequest *r = static_cast<PlaylistRequest*>(request);
+    const QString source = r->source;
+    const bool ok = (r->status() == Request::Ready);
+    r->timer->stop();
+    requests.removeOne(r);
+    r->deleteLater();
+    pending.remove(source);
+    
+    if (playlists.size() >= MAX_PLAYLISTS) {
+        const qint64 now = clock.elapsed();
+        QMutableHashIterator<QString, ResolvedPlaylist> iterator(playlists);
+        
+        while (iterator.hasNext()) {
+            if (iterator.next().value().expires <= now) {
+                iterator.remove();
+            }
+        }
+    }
+    
+    ResolvedPlaylist &playlist = playlists[source];
+    playlist.urls = ok ? parse(source, r->result().toString()) : QStringList();
+    playlist.expires = clock.elapsed() + (playlist.urls.isEmpty() ? FAILED_CACHE_TIME : cacheTime);
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::PlaylistStore::onRequestFinished" << source << playlist.urls << r->errorString();
+#endif
+    emit resolved(source, playlist.urls);
+    emit pendingCountChanged(pending.size());
+    startRequests();
+}
+
+void PlaylistStore::onRequestTimeout() {
+    if (QTimer *timer = qobject_cast<QTimer*>(sender())) {
+        PlaylistRequest *r = static_cast<PlaylistRequest*>(timer->parent());
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::PlaylistStore::onRequestTimeout" << r->source;
+#endif
+        r->cancel();
+    }
+}
+
+}
+
+#include "moc_playlistresolver.cpp"
+#include "moc_playlistresolver_p.cpp"
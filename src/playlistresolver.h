@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_PLAYLISTRESOLVER_H
+#define CUTERADIO_PLAYLISTRESOLVER_H
+
+#include "cuteradio_global.h"
+#include <QObject>
+#include <QStringList>
+
+namespace CuteRadio {
+
+class CUTERADIOSHARED_EXPORT PlaylistResolver : public QObject
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(int maximumConcurrentRequests READ maximumConcurrentRequests WRITE setMaximumConcurrentRequests
+               NOTIFY maximumConcurrentRequestsChanged)
+    Q_PROPERTY(int cacheTime READ cacheTime WRITE setCacheTime NOTIFY cacheTimeChanged)
+    Q_PROPERTY(int pendingCount READ pendingCount NOTIFY pendingCountChanged)
+    
+public:
+    explicit PlaylistResolver(QObject *parent = 0);
+    
+    int maximumConcurrentRequests() const;
+    void setMaximumConcurrentRequests(int maximum);
+    
+    int cacheTime() const;
+    void setCacheTime(int time);
+    
+    int pendingCount() const;
+    
+    Q_INVOKABLE static bool isPlaylist(const QString &source);
+    
+    Q_INVOKABLE bool isResolved(const QString &source) const;
+    
+    Q_INVOKABLE QString streamUrl(const QString &source) const;
+    Q_INVOKABLE QStringList streamUrls(const QString &source) const;
+    
+public Q_SLOTS:
+    void resolve(const QString &source);
+    void cancel();
+    void clearCache();
+    
+Q_SIGNALS:
+    void maximumConcurrentRequestsChanged();
+    void cacheTimeChanged();
+    void pendingCountChanged(int count);
+    void resolved(const QString &source, const QStringList &streamUrls);
+    
+private:
+    Q_DISABLE_COPY(PlaylistResolver)
+};
+
+}
+
+#endif // CUTERADIO_PLAYLISTRESOLVER_H
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_PLAYLISTRESOLVER_P_H
+#define CUTERADIO_PLAYLISTRESOLVER_P_H
+
+#include "playlistresolver.h"
+#include "request.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+
+class QTimer;
+
+namespace CuteRadio {
+
+/*!
+    \internal
+    \brief A GET request for a playlist, returning the playlist text as its result.
+    
+    The request is canceled if it takes longer than its timeout, or if the response is larger than a playlist 
+    can reasonably be, such as when the source is actually a stream.
+*/
+class PlaylistRequest : public Request
+{
+
+public:
+    explicit PlaylistRequest(QObject *parent = 0);
+    
+    void start(const QString &source, int timeout);
+    
+    QString source;
+    
+    QTimer *timer;
+};
+
+/*!
+    \internal
+    \brief The cached stream urls of a playlist.
+*/
+class ResolvedPlaylist
+{
+
+public:
+    QStringList urls;
+    qint64 expires;
+};
+
+/*!
+    \internal
+    \brief The process-wide playlist cache shared by every PlaylistResolver and StationsModel.
+*/
+class PlaylistStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static PlaylistStore* instance();
+    static PlaylistStore* existingInstance();
+    
+    ~PlaylistStore();
+    
+    const ResolvedPlaylist* playlist(const QString &source) const;
+    
+    static QStringList parse(const QString &source, const QString &text);
+    
+    void resolve(const QString &source);
+    void cancel();
+    
+    int maximumConcurrentRequests;
+    int cacheTime;
+    
+    QHash<QString, ResolvedPlaylist> playlists;
+    
+    QStringList queue;
+    QSet<QString> pending;
+    
+    QList<PlaylistRequest*> requests;
+    
+    QElapsedTimer clock;
+    
+    bool startQueued;
+
+Q_SIGNALS:
+    void pendingCountChanged(int count);
+    void resolved(const QString &source, const QStringList &streamUrls);
+
+public Q_SLOTS:
+    void startRequests();
+
+private Q_SLOTS:
+    void onRequestFinished(CuteRadio::Request *request);
+    void onRequestTimeout();
+
+private:
+    PlaylistStore();
+    
+    static PlaylistStore *self;
+};
+
+}
+
+#endif // CUTERADIO_PLAYLISTRESOLVER_P_H
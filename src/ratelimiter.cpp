@@ -0,0 +1,563 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ratelimiter.h"
+#include "ratelimiter_p.h"
+#include "endpointselector_p.h"
+#include "request_p.h"
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTimer>
+#include <QUrl>
+#include <qmath.h>
+#ifdef CUTERADIO_DEBUG
+#include <QDebug>
+#endif
+
+namespace CuteRadio {
+
+static QString normalizedPrefix(const QString &pathPrefix) {
+    if (pathPrefix.isEmpty()) {
+        return QString("/");
+    }
+    
+    return pathPrefix.startsWith('/') ? pathPrefix : "/" + pathPrefix;
+}
+
+/*!
+    \class RateLimiter
+    \brief Limits the rate of requests made to the cuteRadio Data API.
+    
+    \ingroup requests
+    
+    RateLimiter applies a token bucket limit to requests for a host and resource path prefix. Each bucket holds up 
+    to burst tokens and is refilled at rate tokens per second, and every request takes one token. A request made 
+    when the bucket is empty is not failed, but queued until a token is available, so a burst of background 
+    requests is spread out instead of being throttled by the server.
+    
+    The host may be empty to match any host. The path prefix is matched against the path of the request url, and 
+    for API requests also against the resource path, so "/stations" matches both 
+    "http://marxoft.co.uk/api/cuteradio/stations" and "http://marxoft.co.uk/api/cuteradio/stations/12". When more 
+    than one limit matches, a limit for the host is used in preference to one for any host, then the longest path 
+    prefix.
+    
+    All RateLimiter objects share one set of limits, which applies to every Request and PagesRequest in the 
+    process. Redirects are followed without taking another token.
+    
+    Example usage:
+    
+    \code
+    using namespace CuteRadio;
+    
+    ...
+    
+    RateLimiter *limiter = new RateLimiter(this);
+    // Up to 10 requests at once, then 2 per second.
+    limiter->setLimit("marxoft.co.uk", "/stations", 2, 10);
+    limiter->setLimit("marxoft.co.uk", "/searches", 1, 5);
+    \endcode
+*/
+RateLimiter::RateLimiter(QObject *parent) :
+    QObject(parent)
+{
+    RateLimitStore *store = RateLimitStore::instance();
+    connect(store, SIGNAL(queuedCountChanged(int)), this, SIGNAL(queuedCountChanged(int)));
+    connect(store, SIGNAL(limitsChanged()), this, SIGNAL(limitsChanged()));
+    connect(store, SIGNAL(released(QString, QString, int)), this, SIGNAL(released(QString, QString, int)));
+}
+
+/*!
+    \property int RateLimiter::queuedCount
+    \brief The number of requests that are waiting for a token.
+*/
+int RateLimiter::queuedCount() const {
+    return RateLimitStore::instance()->queued;
+}
+
+/*!
+    \brief Limits requests for \a host and \a pathPrefix to \a rate per second, with bursts of up to \a burst.
+    
+    If the limit already exists, its rate and burst are changed. If \a rate is not greater than 0, the limit is 
+    removed.
+*/
+void RateLimiter::setLimit(const QString &host, const QString &pathPrefix, double rate, int burst) {
+    if (rate > 0) {
+        RateLimitStore::instance()->setLimit(host, pathPrefix, rate, burst);
+    }
+    else {
+        RateLimitStore::instance()->removeLimit(host, pathPrefix);
+    }
+}
+
+/*!
+    \brief Removes the limit for \a host and \a pathPrefix.
+    
+    Requests that are waiting for the limit are sent immediately.
+*/
+void RateLimiter::removeLimit(const QString &host, const QString &pathPrefix) {
+    RateLimitStore::instance()->removeLimit(host, pathPrefix);
+}
+
+/*!
+    \brief Returns the settings and statistics of the limit for \a host and \a pathPrefix.
+    
+    The map is empty if there is no such limit. Otherwise, it contains:
+    
+    <table>
+        <tr>
+            <th>Key</th>
+            <th>Description</th>
+        </tr>
+        <tr>
+            <td>host</td>
+            <td>The host, or an empty string for any host.</td>
+        </tr>
+        <tr>
+            <td>pathPrefix</td>
+            <td>The resource path prefix.</td>
+        </tr>
+        <tr>
+            <td>rate</td>
+            <td>The number of requests allowed per second.</td>
+        </tr>
+        <tr>
+            <td>burst</td>
+            <td>The number of requests that can be made at once.</td>
+        </tr>
+        <tr>
+            <td>tokens</td>
+            <td>The number of tokens currently available.</td>
+        </tr>
+        <tr>
+            <td>queued</td>
+            <td>The number of requests waiting for a token.</td>
+        </tr>
+        <tr>
+            <td>throttledCount</td>
+            <td>The number of requests that have had to wait.</td>
+        </tr>
+        <tr>
+            <td>averageWaitTime</td>
+            <td>The average time in milliseconds that released requests waited.</td>
+        </tr>
+        <tr>
+            <td>maximumWaitTime</td>
+            <td>The longest time in milliseconds that a request waited.</td>
+        </tr>
+        <tr>
+            <td>lastWaitTime</td>
+            <td>The time in milliseconds that the last released request waited.</td>
+        </tr>
+    </table>
+*/
+QVariantMap RateLimiter::limit(const QString &host, const QString &pathPrefix) const {
+    RateLimitStore *store = RateLimitStore::instance();
+    RateBucket *b = store->bucket(host, pathPrefix);
+    return b ? store->bucketInfo(b) : QVariantMap();
+}
+
+/*!
+    \brief Returns the settings and statistics of all limits.
+    
+    \sa limit()
+*/
+QVariantList RateLimiter::limits() const {
+    RateLimitStore *store = RateLimitStore::instance();
+    QVariantList list;
+    
+    foreach (RateBucket *b, store->buckets) {
+        list << store->bucketInfo(b);
+    }
+    
+    return list;
+}
+
+/*!
+    \brief Removes all limits.
+    
+    Requests that are waiting are sent immediately.
+*/
+void RateLimiter::clearLimits() {
+    RateLimitStore::instance()->clearLimits();
+}
+
+/*!
+    \brief Resets the wait time statistics of all limits.
+*/
+void RateLimiter::resetStatistics() {
+    RateLimitStore::instance()->resetStatistics();
+}
+
+/*!
+    \fn void RateLimiter::released(const QString &host, const QString &pathPrefix, int waitTime)
+    \brief Emitted when a queued request for the limit with \a host and \a pathPrefix is sent, after waiting for 
+    \a waitTime milliseconds.
+*/
+
+RateLimitStore* RateLimitStore::self = 0;
+
+RateLimitStore::RateLimitStore() :
+    QObject(QCoreApplication::instance()),
+    queued(0),
+    timer(new QTimer(this))
+{
+    timer->setSingleShot(true);
+    connect(timer, SIGNAL(timeout()), this, SLOT(releaseWaiters()));
+    clock.start();
+}
+
+RateLimitStore::~RateLimitStore() {
+    qDeleteAll(buckets);
+    
+    if (self == this) {
+        self = 0;
+    }
+}
+
+/*!
+    \internal
+    \brief Returns the limiter, creating it if required.
+    
+    The limiter is owned by the application object.
+*/
+RateLimitStore* RateLimitStore::instance() {
+    if (!self) {
+        self = new RateLimitStore;
+    }
+    
+    return self;
+}
+
+/*!
+    \internal
+    \brief Returns the limiter if it exists, otherwise 0.
+*/
+RateLimitStore* RateLimitStore::existingInstance() {
+    return self;
+}
+
+/*!
+    \internal
+    \brief Takes a token for a request to \a url.
+    
+    Returns true if the request can be sent now. Otherwise, the request is queued and \a member of \a receiver 
+    is invoked once a token has been taken for it. A receiver that queues more than one request has \a member 
+    invoked once for each of them, in order.
+*/
+bool RateLimitStore::acquire(const QUrl &url, QObject *receiver, const char *member) {
+    RateBucket *b = bucket(url);
+    
+    if (!b) {
+        return true;
+    }
+    
+    refill(b);
+    
+    if ((b->waiters.isEmpty()) && (b->tokens >= 1)) {
+        b->tokens -= 1;
+        return true;
+    }
+    
+    RateWaiter waiter;
+    waiter.receiver = receiver;
+    waiter.member = member;
+    waiter.queued = clock.elapsed();
+    b->waiters << waiter;
+    b->throttledCount++;
+    queued++;
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::RateLimitStore::acquire: Queued" << url << b->host << b->pathPrefix
+             << b->waiters.size();
+#endif
+    emit queuedCountChanged(queued);
+    scheduleRelease();
+    return false;
+}
+
+/*!
+    \internal
+    \brief Removes all requests queued by \a receiver.
+*/
+void RateLimitStore::cancel(QObject *receiver) {
+    const int count = queued;
+    
+    foreach (RateBucket *b, buckets) {
+        for (int i = b->waiters.size() - 1; i >= 0; i--) {
+            const QObject *r = b->waiters.at(i).receiver;
+            
+            if ((!r) || (r == receiver)) {
+                b->waiters.removeAt(i);
+                queued--;
+            }
+        }
+    }
+    
+    if (queued != count) {
+        emit queuedCountChanged(queued);
+        scheduleRelease();
+    }
+}
+
+void RateLimitStore::setLimit(const QString &host, const QString &pathPrefix, double rate, int burst) {
+    RateBucket *b = bucket(host, pathPrefix);
+    burst = qMax(1, burst);
+    
+    if (b) {
+        refill(b);
+        b->rate = rate;
+        b->burst = burst;
+        b->tokens = qMin(b->tokens, double(burst));
+    }
+    else {
+        b = new RateBucket;
+        b->host = host.toLower();
+        b->pathPrefix = normalizedPrefix(pathPrefix);
+        b->rate = rate;
+        b->burst = burst;
+        b->tokens = burst;
+        b->refilled = clock.elapsed();
+        b->throttledCount = 0;
+        b->releasedCount = 0;
+        b->totalWait = 0;
+        b->maximumWait = 0;
+        b->lastWait = 0;
+        buckets << b;
+    }
+    
+    scheduleRelease();
+    emit limitsChanged();
+}
+
+void RateLimitStore::removeLimit(const QString &host, const QString &pathPrefix) {
+    RateBucket *b = bucket(host, pathPrefix);
+    
+    if (b) {
+        buckets.removeOne(b);
+        releaseAll(b);
+        emit limitsChanged();
+    }
+}
+
+void RateLimitStore::clearLimits() {
+    if (buckets.isEmpty()) {
+        return;
+    }
+    
+    const QList<RateBucket*> removed = buckets;
+    buckets.clear();
+    timer->stop();
+    
+    foreach (RateBucket *b, removed) {
+        releaseAll(b);
+    }
+    
+    emit limitsChanged();
+}
+
+void RateLimitStore::resetStatistics() {
+    foreach (RateBucket *b, buckets) {
+        b->throttledCount = 0;
+        b->releasedCount = 0;
+        b->totalWait = 0;
+        b->maximumWait = 0;
+        b->lastWait = 0;
+    }
+}
+
+/*!
+    \internal
+    \brief Returns the bucket with exactly \a host and \a pathPrefix, or 0 if there is none.
+*/
+RateBucket* RateLimitStore::bucket(const QString &host, const QString &pathPrefix) const {
+    const QString h = host.toLower();
+    const QString p = normalizedPrefix(pathPrefix);
+    
+    foreach (RateBucket *b, buckets) {
+        if ((b->host == h) && (b->pathPrefix == p)) {
+            return b;
+        }
+    }
+    
+    return 0;
+}
+
+/*!
+    \internal
+    \brief Returns the most specific bucket that applies to \a url, or 0 if there is none.
+*/
+RateBucket* RateLimitStore::bucket(const QUrl &url) const {
+    if (buckets.isEmpty()) {
+        return 0;
+    }
+    
+    const QString host = url.host().toLower();
+    const QString path = url.path();
+    const QString resourcePath = EndpointStore::resourcePath(url);
+    RateBucket *match = 0;
+    int best = -1;
+    
+    foreach (RateBucket *b, buckets) {
+        if ((!b->host.isEmpty()) && (b->host != host)) {
+            continue;
+        }
+        
+        if ((!pathHasPrefix(path, b->pathPrefix)) && ((resourcePath.isNull())
+                                                      || (!pathHasPrefix(resourcePath, b->pathPrefix)))) {
+            continue;
+        }
+        
+        const int score = (b->host.isEmpty() ? 0 : 0x10000) + b->pathPrefix.size();
+        
+        if (score > best) {
+            match = b;
+            best = score;
+        }
+    }
+    
+    return match;
+}
+
+QVariantMap RateLimitStore::bucketInfo(RateBucket *b) {
+    refill(b);
+    QVariantMap info;
+    info["host"] = b->host;
+    info["pathPrefix"] = b->pathPrefix;
+    info["rate"] = b->rate;
+    info["burst"] = b->burst;
+    info["tokens"] = b->tokens;
+    info["queued"] = b->waiters.size();
+    info["throttledCount"] = b->throttledCount;
+    info["averageWaitTime"] = b->releasedCount > 0 ? int(b->totalWait / b->releasedCount) : 0;
+    info["maximumWaitTime"] = b->maximumWait;
+    info["lastWaitTime"] = b->lastWait;
+    return info;
+}
+
+void RateLimitStore::refill(RateBucket *b) {
+    const qint64 now = clock.elapsed();
+    b->tokens = qMin(double(b->burst), b->tokens + (now - b->refilled) * b->rate / 1000);
+    b->refilled = now;
+}
+
+/*!
+    \internal
+    \brief Starts the timer for when the next queued request can be released.
+*/
+void RateLimitStore::scheduleRelease() {
+    int delay = -1;
+    
+    foreach (RateBucket *b, buckets) {
+        if (!b->waiters.isEmpty()) {
+            refill(b);
+            const int wait = b->tokens >= 1 ? 0 : int(qCeil((1 - b->tokens) * 1000 / b->rate));
+            
+            if ((delay < 0) || (wait < delay)) {
+                delay = wait;
+            }
+        }
+    }
+    
+    if (delay >= 0) {
+        timer->start(delay);
+    }
+    else {
+        timer->stop();
+    }
+}
+
+/*!
+    \internal
+    \brief Releases every request waiting for \a b, and deletes it.
+    
+    \a b must already have been removed from the list of buckets.
+*/
+void RateLimitStore::releaseAll(RateBucket *b) {
+    const QList<RateWaiter> waiters = b->waiters;
+    delete b;
+    
+    if (!waiters.isEmpty()) {
+        queued -= waiters.size();
+        emit queuedCountChanged(queued);
+        
+        foreach (const RateWaiter &waiter, waiters) {
+            if (waiter.receiver) {
+                QMetaObject::invokeMethod(waiter.receiver, waiter.member);
+            }
+        }
+    }
+}
+
+/*!
+    \internal
+    \brief Releases queued requests for which a token is available.
+    
+    The receivers are invoked, and released() emitted, after all buckets have been updated, since either may 
+    queue or cancel requests, or change the limits.
+*/
+void RateLimitStore::releaseWaiters() {
+    QList<RateWaiter> ready;
+    QList<int> waits;
+    QStringList hosts;
+    QStringList prefixes;
+    const qint64 now = clock.elapsed();
+    
+    foreach (RateBucket *b, buckets) {
+        refill(b);
+        
+        while (!b->waiters.isEmpty()) {
+            if (!b->waiters.first().receiver) {
+                b->waiters.removeFirst();
+                queued--;
+                continue;
+            }
+            
+            if (b->tokens < 1) {
+                break;
+            }
+            
+            const RateWaiter waiter = b->waiters.takeFirst();
+            const int wait = int(now - waiter.queued);
+            b->tokens -= 1;
+            b->releasedCount++;
+            b->totalWait += wait;
+            b->maximumWait = qMax(b->maximumWait, wait);
+            b->lastWait = wait;
+            queued--;
+            ready << waiter;
+            waits << wait;
+            hosts << b->host;
+            prefixes << b->pathPrefix;
+        }
+    }
+    
+    emit queuedCountChanged(queued);
+    scheduleRelease();
+    
+    for (int i = 0; i < ready.size(); i++) {
+        const RateWaiter &waiter = ready.at(i);
+        
+        if (waiter.receiver) {
+            QMetaObject::invokeMethod(waiter.receiver, waiter.member);
+        }
+        
+        emit released(hosts.at(i), prefixes.at(i), waits.at(i));
+    }
+}
+
+}
+
+#include "moc_ratelimiter.cpp"
+#include "moc_ratelimiter_p.cpp"
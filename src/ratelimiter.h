@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_RATELIMITER_H
+#define CUTERADIO_RATELIMITER_H
+
+#include "cuteradio_global.h"
+#include <QObject>
+#include <QVariantMap>
+
+namespace CuteRadio {
+
+class CUTERADIOSHARED_EXPORT RateLimiter : public QObject
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(int queuedCount READ queuedCount NOTIFY queuedCountChanged)
+    
+public:
+    explicit RateLimiter(QObject *parent = 0);
+    
+    int queuedCount() const;
+    
+    Q_INVOKABLE void setLimit(const QString &host, const QString &pathPrefix, double rate, int burst = 1);
+    Q_INVOKABLE void removeLimit(const QString &host, const QString &pathPrefix);
+    
+    Q_INVOKABLE QVariantMap limit(const QString &host, const QString &pathPrefix) const;
+    Q_INVOKABLE QVariantList limits() const;
+    
+public Q_SLOTS:
+    void clearLimits();
+    void resetStatistics();
+    
+Q_SIGNALS:
+    void queuedCountChanged(int count);
+    void limitsChanged();
+    void released(const QString &host, const QString &pathPrefix, int waitTime);
+    
+private:
+    Q_DISABLE_COPY(RateLimiter)
+};
+
+}
+
+#endif // CUTERADIO_RATELIMITER_H
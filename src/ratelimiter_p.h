@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_RATELIMITER_P_H
+#define CUTERADIO_RATELIMITER_P_H
+
+#include "ratelimiter.h"
+#include <QElapsedTimer>
+#include <QPointer>
+
+class QTimer;
+class QUrl;
+
+namespace CuteRadio {
+
+/*!
+    \internal
+    \brief An object waiting for a token, and the slot to invoke when it gets one.
+*/
+class RateWaiter
+{
+
+public:
+    QPointer<QObject> receiver;
+    const char *member;
+    qint64 queued;
+};
+
+/*!
+    \internal
+    \brief The token bucket for one host and resource path prefix.
+    
+    The bucket holds at most burst tokens, and is refilled at rate tokens per second. Each request takes one 
+    token. Waiters are released in the order they were queued.
+*/
+class RateBucket
+{
+
+public:
+    QString host;
+    QString pathPrefix;
+    
+    double rate;
+    int burst;
+    
+    double tokens;
+    qint64 refilled;
+    
+    QList<RateWaiter> waiters;
+    
+    int throttledCount;
+    int releasedCount;
+    qint64 totalWait;
+    int maximumWait;
+    int lastWait;
+};
+
+/*!
+    \internal
+    \brief The process-wide rate limiter used by every Request and PagesRequest.
+    
+    The limiter only exists once a RateLimiter has been created, so requests do not pay for it otherwise.
+*/
+class RateLimitStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static RateLimitStore* instance();
+    static RateLimitStore* existingInstance();
+    
+    ~RateLimitStore();
+    
+    bool acquire(const QUrl &url, QObject *receiver, const char *member);
+    void cancel(QObject *receiver);
+    
+    void setLimit(const QString &host, const QString &pathPrefix, double rate, int burst);
+    void removeLimit(const QString &host, const QString &pathPrefix);
+    void clearLimits();
+    
+    void resetStatistics();
+    
+    RateBucket* bucket(const QString &host, const QString &pathPrefix) const;
+    RateBucket* bucket(const QUrl &url) const;
+    
+    QVariantMap bucketInfo(RateBucket *b);
+    
+    QList<RateBucket*> buckets;
+    
+    int queued;
+    
+    QTimer *timer;
+    
+    QElapsedTimer clock;
+
+Q_SIGNALS:
+    void queuedCountChanged(int count);
+    void limitsChanged();
+    void released(const QString &host, const QString &pathPrefix, int waitTime);
+
+private Q_SLOTS:
+    void releaseWaiters();
+
+private:
+    RateLimitStore();
+    
+    void refill(RateBucket *b);
+    void scheduleRelease();
+    void releaseAll(RateBucket *b);
+    
+    static RateLimitStore *self;
+};
+
+}
+
+#endif // CUTERADIO_RATELIMITER_P_H
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "redirectcache_p.h"
+#include "request_p.h"
+#include <QHash>
+#include <QMutex>
+#include <QNetworkReply>
+
+namespace CuteRadio {
+
+// The cache is cleared when it grows beyond this size.
+static const int MAX_CACHED_REDIRECTS = 256;
+
+typedef QHash<QString, QUrl> RedirectHash;
+
+Q_GLOBAL_STATIC(QMutex, redirectMutex)
+Q_GLOBAL_STATIC(RedirectHash, redirectHash)
+
+/*!
+    \internal
+    \brief Returns the url that a request for \a url should be sent to, following cached permanent redirects.
+    
+    Returns \a url if it has not been permanently redirected.
+*/
+QUrl RedirectCache::rewrite(const QUrl &url) {
+    QMutexLocker locker(redirectMutex());
+    const RedirectHash *hash = redirectHash();
+    
+    if (hash->isEmpty()) {
+        return url;
+    }
+    
+    QUrl u(url);
+    
+    for (int i = 0; i < MAX_REDIRECTS; i++) {
+        RedirectHash::const_iterator iterator = hash->constFind(u.toString());
+        
+        if ((iterator == hash->constEnd()) || (iterator.value() == url)) {
+            break;
+        }
+        
+        u = iterator.value();
+    }
+    
+    return u;
+}
+
+/*!
+    \internal
+    \brief Returns the resolved redirect target of \a reply, or an empty url if it was not redirected.
+    
+    If the redirect is permanent, it is added to the cache.
+*/
+QUrl RedirectCache::target(QNetworkReply *reply) {
+    QUrl redirect = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+    
+    if (redirect.isEmpty()) {
+        redirect = reply->header(QNetworkRequest::LocationHeader).toUrl();
+        
+        if (redirect.isEmpty()) {
+            return redirect;
+        }
+    }
+    
+    redirect = reply->url().resolved(redirect);
+    
+    switch (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt()) {
+    case 301:
+    case 308:
+        insert(reply->url(), redirect);
+        break;
+    default:
+        break;
+    }
+    
+    return redirect;
+}
+
+/*!
+    \internal
+    \brief Returns the operation used to follow a redirect with \a statusCode from a request using \a op.
+    
+    307 and 308 redirects keep the operation and body. A POST redirected with 301 or 302 becomes a GET, as it does 
+    in browsers, and anything else (such as 303) becomes a GET. A HEAD request is always followed with HEAD.
+*/
+Request::Operation RedirectCache::operation(Request::Operation op, int statusCode) {
+    switch (statusCode) {
+    case 307:
+    case 308:
+        return op;
+    case 301:
+    case 302:
+        return op == Request::PostOperation ? Request::GetOperation : op;
+    default:
+        return op == Request::HeadOperation ? op : Request::GetOperation;
+    }
+}
+
+void RedirectCache::insert(const QUrl &url, const QUrl &redirect) {
+    if (url == redirect) {
+        return;
+    }
+    
+    QMutexLocker locker(redirectMutex());
+    RedirectHash *hash = redirectHash();
+    
+    if (hash->size() >= MAX_CACHED_REDIRECTS) {
+        hash->clear();
+    }
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::RedirectCache::insert" << url << redirect;
+#endif
+    hash->insert(url.toString(), redirect);
+}
+
+/*!
+    \internal
+    \brief Removes the redirects to \a redirect, so that requests are sent to the original url again.
+    
+    This is used when a request to a rewritten url fails, since the resource may have moved back.
+*/
+void RedirectCache::invalidate(const QUrl &redirect) {
+    QMutexLocker locker(redirectMutex());
+    QMutableHashIterator<QString, QUrl> iterator(*redirectHash());
+    
+    while (iterator.hasNext()) {
+        if (iterator.next().value() == redirect) {
+            iterator.remove();
+        }
+    }
+}
+
+void RedirectCache::clear() {
+    QMutexLocker locker(redirectMutex());
+    redirectHash()->clear();
+}
+
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_REDIRECTCACHE_P_H
+#define CUTERADIO_REDIRECTCACHE_P_H
+
+#include "request.h"
+#include <QUrl>
+
+class QNetworkReply;
+
+namespace CuteRadio {
+
+/*!
+    \internal
+    \brief The process-wide record of permanent (301 and 308) redirects.
+    
+    The cache is shared by the thread that owns the requests and the RequestEngine thread, so every function is 
+    thread-safe.
+*/
+class RedirectCache
+{
+
+public:
+    static QUrl rewrite(const QUrl &url);
+    
+    static QUrl target(QNetworkReply *reply);
+    
+    static Request::Operation operation(Request::Operation op, int statusCode);
+    
+    static void insert(const QUrl &url, const QUrl &redirect);
+    static void invalidate(const QUrl &redirect);
+    static void clear();
+};
+
+}
+
+#endif // CUTERADIO_REDIRECTCACHE_P_H
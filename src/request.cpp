@@ -15,13 +15,19 @@
  */
 
 #include "request_p.h"
-#include "urls.h"
+#include "circuitbreaker_p.h"
+#include "endpointselector_p.h"
+#include "ratelimiter_p.h"
+#include "redirectcache_p.h"
+#include "requestengine_p.h"
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QDebug>
 
 namespace CuteRadio {
 
+static Request::EngineMode defaultMode = Request::DirectEngine;
+
 /*!
     \class Request
     \brief The base class for making requests to the cuteRadio Data API.
@@ -50,6 +56,9 @@ Request::~Request() {
         delete d->reply;
         d->reply = 0;
     }
+    
+    d->discardJob();
+    d->cancelThrottled();
 }
 
 /*!
@@ -72,6 +81,7 @@ void Request::setAccessToken(const QString &token) {
     
     if (token != d->accessToken) {
         d->accessToken = token;
+        d->reqTemplateValid = false;
         emit accessTokenChanged();
     }
 #ifdef CUTERADIO_DEBUG
@@ -125,6 +135,7 @@ void Request::setHeaders(const QVariantMap &headers) {
     Q_D(Request);
     
     d->headers = headers;
+    d->reqTemplateValid = false;
     emit headersChanged();
 #ifdef CUTERADIO_DEBUG
     qDebug() << "CuteRadio::Request::setHeaders" << headers;
@@ -394,6 +405,10 @@ QVariant Request::result() const {
             <td>ParseError</td>
             <td>There was an error in parsing the server response.</td>
         </tr>
+        <tr>
+            <td>CircuitOpenError</td>
+            <td>The request was not sent because the CircuitBreaker circuit for the endpoint is open.</td>
+        </tr>
     </table>
 */
 
@@ -417,6 +432,105 @@ QString Request::errorString() const {
     return d->errorString;
 }
 
+/*!
+    \property int Request::redirectCount
+    \brief The number of redirects followed by the last HTTP request.
+    
+    Permanent (301 and 308) redirects are remembered for the lifetime of the process, and later requests for the 
+    same url are sent to the new url directly, so they do not count here. 307 and 308 redirects are followed with 
+    the same operation and body. A POST redirected with 301 or 302, or any request redirected with 303, is followed 
+    with a GET, except that HEAD requests always stay HEAD.
+*/
+int Request::redirectCount() const {
+    Q_D(const Request);
+    
+    return d->redirects;
+}
+
+/*!
+    \brief Forgets all permanent redirects.
+    
+    \sa redirectCount
+*/
+void Request::clearRedirectCache() {
+    RedirectCache::clear();
+}
+
+/*!
+    \enum Request::EngineMode
+    \brief Where network replies are handled and parsed.
+    
+    Can be one of the following:
+    
+    <table>
+        <tr>
+            <th>Value</th>
+            <th>Description</th>
+        </tr>
+        <tr>
+            <td>DirectEngine</td>
+            <td>Replies are handled and parsed in the thread that owns the request (default).</td>
+        </tr>
+        <tr>
+            <td>WorkerThreadEngine</td>
+            <td>
+                Replies are handled and parsed in a dedicated worker thread shared by all requests. Only the 
+                finished result is delivered to the thread that owns the request.
+            </td>
+        </tr>
+    </table>
+*/
+
+/*!
+    \property EngineMode Request::engineMode
+    \brief Where network replies are handled and parsed.
+    
+    In WorkerThreadEngine mode, requests are sent using a QNetworkAccessManager owned by the worker thread, so any 
+    manager set with setNetworkAccessManager() is not used.
+    
+    The default value is defaultEngineMode(). Changes take effect from the next request.
+    
+    \sa setDefaultEngineMode()
+*/
+
+/*!
+    \fn void Request::engineModeChanged()
+    \brief Emitted when the engineMode changes.
+*/
+Request::EngineMode Request::engineMode() const {
+    Q_D(const Request);
+    
+    return d->engineMode;
+}
+
+void Request::setEngineMode(Request::EngineMode mode) {
+    Q_D(Request);
+    
+    if (mode != d->engineMode) {
+        d->engineMode = mode;
+        emit engineModeChanged();
+    }
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::Request::setEngineMode" << mode;
+#endif
+}
+
+/*!
+    \brief Returns the engine mode used by newly created requests.
+*/
+Request::EngineMode Request::defaultEngineMode() {
+    return defaultMode;
+}
+
+/*!
+    \brief Sets the engine mode used by newly created requests to \a mode.
+    
+    This is normally called once at startup, before any requests or models are created.
+*/
+void Request::setDefaultEngineMode(Request::EngineMode mode) {
+    defaultMode = mode;
+}
+
 /*!
     \brief Sets the QNetworkAccessManager instance to be used 
     when making requests to the cuteRadio API.
@@ -455,14 +569,10 @@ void Request::head(bool authRequired) {
     d->setOperation(HeadOperation);
     d->setStatus(Loading);
     
-    if (d->reply) {
-        delete d->reply;
-    }
 #ifdef CUTERADIO_DEBUG
     qDebug() << "CuteRadio::Request::head" << d->url;
 #endif
-    d->reply = d->networkAccessManager()->head(d->buildRequest(authRequired));
-    connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+    d->sendRequest(d->buildRequest(authRequired));
 }
 
 /*!
@@ -480,14 +590,10 @@ void Request::get(bool authRequired) {
     d->setOperation(GetOperation);
     d->setStatus(Loading);
     
-    if (d->reply) {
-        delete d->reply;
-    }
 #ifdef CUTERADIO_DEBUG
     qDebug() << "CuteRadio::Request::get" << d->url;
 #endif
-    d->reply = d->networkAccessManager()->get(d->buildRequest(authRequired));
-    connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+    d->sendRequest(d->buildRequest(authRequired));
 }
 
 /*!
@@ -504,30 +610,14 @@ void Request::post(bool authRequired) {
     d->redirects = 0;
     d->setOperation(PostOperation);
     
-    bool ok = true;
     QByteArray data;
-    
-    switch (d->data.type()) {
-    case QVariant::String:
-    case QVariant::ByteArray:
-    case QVariant::Invalid:
-        data = d->data.toString().toUtf8();
-        break;
-    default:
-        data = QtJson::Json::serialize(d->data, ok);
-        break;
-    }
+    const bool ok = d->buildBody(&data);
 #ifdef CUTERADIO_DEBUG
     qDebug() << "CuteRadio::Request::post" << d->url << data;
 #endif
     if (ok) {
-        if (d->reply) {
-            delete d->reply;
-        }
-        
-        d->setStatus(Loading);        
-        d->reply = d->networkAccessManager()->post(d->buildRequest(authRequired), data);
-        connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+        d->setStatus(Loading);
+        d->sendRequest(d->buildRequest(authRequired), data);
     }
     else {
         d->setStatus(Failed);
@@ -551,30 +641,14 @@ void Request::put(bool authRequired) {
     d->redirects = 0;
     d->setOperation(PutOperation);
         
-    bool ok = true;
     QByteArray data;
-    
-    switch (d->data.type()) {
-    case QVariant::String:
-    case QVariant::ByteArray:
-    case QVariant::Invalid:
-        data = d->data.toString().toUtf8();
-        break;
-    default:
-        data = QtJson::Json::serialize(d->data, ok);
-        break;
-    }
+    const bool ok = d->buildBody(&data);
 #ifdef CUTERADIO_DEBUG
     qDebug() << "CuteRadio::Request::put" << d->url << data;
 #endif
     if (ok) {
-        if (d->reply) {
-            delete d->reply;
-        }
-        
-        d->setStatus(Loading);        
-        d->reply = d->networkAccessManager()->put(d->buildRequest(authRequired), data);
-        connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+        d->setStatus(Loading);
+        d->sendRequest(d->buildRequest(authRequired), data);
     }
     else {
         d->setStatus(Failed);
@@ -599,14 +673,22 @@ void Request::deleteResource(bool authRequired) {
     d->setOperation(DeleteOperation);
     d->setStatus(Loading);
     
-    if (d->reply) {
-        delete d->reply;
-    }
 #ifdef CUTERADIO_DEBUG
     qDebug() << "CuteRadio::Request::deleteResource" << d->url;
 #endif
-    d->reply = d->networkAccessManager()->deleteResource(d->buildRequest(authRequired));
-    connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+    d->sendRequest(d->buildRequest(authRequired));
+}
+
+/*!
+    \brief Releases the result of the last request.
+    
+    This is useful once the result has been copied elsewhere, so that it is not held in memory until the next 
+    request completes. The status and error are not changed.
+*/
+void Request::clearResult() {
+    Q_D(Request);
+    
+    d->result = QVariant();
 }
 
 /*!
@@ -618,17 +700,42 @@ void Request::cancel() {
     if (d->reply) {
         d->reply->abort();
     }
+    else if (d->job) {
+        QMetaObject::invokeMethod(d->job, "abort", Qt::QueuedConnection);
+    }
+    else if (d->throttled) {
+        d->cancelThrottled();
+        d->finish(QVariant(), true, QNetworkReply::OperationCanceledError, QString());
+    }
+    else if (d->rejected) {
+        d->rejected = false;
+        d->finish(QVariant(), true, QNetworkReply::OperationCanceledError, QString());
+    }
 }
 
 RequestPrivate::RequestPrivate(Request *parent) :
     q_ptr(parent),
     manager(0),
     reply(0),
+    job(0),
+    jobId(0),
+    rowDictionaries(0),
+    engineMode(Request::defaultEngineMode()),
     ownNetworkAccessManager(false),
+    reqTemplateValid(false),
     operation(Request::UnknownOperation),
     status(Request::Null),
     error(Request::NoError),
-    redirects(0)
+    redirects(0),
+    replyOperation(Request::UnknownOperation),
+    failover(true),
+    failedOver(false),
+    rateLimited(true),
+    throttled(false),
+    rejected(false),
+    rawResponse(false),
+    cacheResult(true),
+    maximumResponseSize(0)
 {
 }
 
@@ -695,29 +802,277 @@ QNetworkRequest RequestPrivate::buildRequest(QUrl u, bool authRequired) {
 #ifdef CUTERADIO_DEBUG
     qDebug() << "CuteRadio::RequestPrivate::buildRequest " << u;
 #endif
-    QNetworkRequest request(u);
-    
-    if ((authRequired) && (!accessToken.isEmpty())) {
-        request.setRawHeader("Authorization", "Basic " + QByteArray(accessToken.toUtf8() + ":").toBase64());
-    }
+    QNetworkRequest request = requestTemplate().request(u, authRequired);
     
     switch (operation) {
     case Request::PostOperation:
     case Request::PutOperation:
-        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+        if (!request.hasRawHeader("Content-Type")) {
+            request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+        }
+        
         break;
     default:
         break;
     }
     
-    if (!headers.isEmpty()) {
-        addRequestHeaders(&request, headers);
+    return request;
+}
+
+/*!
+    \internal
+    \brief Returns the request template for the current access token and headers, creating it if needed.
+*/
+const RequestTemplate& RequestPrivate::requestTemplate() {
+    if (!reqTemplateValid) {
+        reqTemplate = RequestTemplate(accessToken, headers);
+        reqTemplateValid = true;
     }
     
-    return request;
+    return reqTemplate;
+}
+
+/*!
+    \internal
+    \brief Returns the url for \a resourcePath on the current API endpoint.
+    
+    Urls are cached per resource path, so repeated requests for the same resource do not need to build and parse 
+    the url again. Paths that already carry a query (such as next/previous links) are not cached. The cache is 
+    cleared when the EndpointSelector selects another endpoint.
+*/
+QUrl RequestPrivate::resourceUrl(const QString &resourcePath) {
+    const QString base = EndpointStore::apiUrl();
+    
+    if (base != resourceUrlBase) {
+        resourceUrls.clear();
+        resourceUrlBase = base;
+    }
+    
+    QHash<QString, QUrl>::const_iterator iterator = resourceUrls.constFind(resourcePath);
+    
+    if (iterator != resourceUrls.constEnd()) {
+        return iterator.value();
+    }
+    
+    const QUrl u(resourcePath.startsWith('/') ? base + resourcePath : base + '/' + resourcePath);
+    
+    if (!resourcePath.contains('?')) {
+        if (resourceUrls.size() >= MAX_RESOURCE_URLS) {
+            resourceUrls.clear();
+        }
+        
+        resourceUrls.insert(resourcePath, u);
+    }
+    
+    return u;
+}
+
+/*!
+    \internal
+    \brief Writes the PUT/POST body for the current data to \a body.
+    
+    A QByteArray is passed through as-is (implicitly shared, so not copied), a QString is 
+    encoded as UTF-8, and anything else is serialized as JSON.
+    
+    Returns false if the data cannot be serialized.
+*/
+bool RequestPrivate::buildBody(QByteArray *body) const {
+    switch (data.type()) {
+    case QVariant::ByteArray:
+        *body = data.toByteArray();
+        return true;
+    case QVariant::String:
+        *body = data.toString().toUtf8();
+        return true;
+    case QVariant::Invalid:
+        return true;
+    default:
+        return QtJson::Json::serialize(data, *body);
+    }
+}
+
+/*!
+    \internal
+    \brief Sends \a request using the current operation and engine mode.
+    
+    Any reply or job still in progress is discarded. If \a request has been permanently redirected before, it is 
+    sent to the new url straight away. If the CircuitBreaker circuit for the endpoint is open, the 
+    request is not sent, and is finished from _q_onCircuitRejected(). If a RateLimiter limit applies to the 
+    request and has no tokens left, the request is queued and sent from _q_onThrottleReleased().
+*/
+void RequestPrivate::sendRequest(const QNetworkRequest &r, const QByteArray &body) {
+    Q_Q(Request);
+    
+    if (reply) {
+        delete reply;
+        reply = 0;
+    }
+    
+    discardJob();
+    cancelThrottled();
+    rejected = false;
+    
+    QNetworkRequest request(r);
+    const QUrl u = RedirectCache::rewrite(r.url());
+    
+    if (u != r.url()) {
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::RequestPrivate::sendRequest: Using permanent redirect" << r.url() << u;
+#endif
+        request.setUrl(u);
+        rewrittenUrl = u;
+    }
+    else {
+        rewrittenUrl = QUrl();
+    }
+    
+    sentRequest = r;
+    sentUrl = request.url();
+    
+    CircuitBreakerStore *breaker = CircuitBreakerStore::existingInstance();
+    
+    if ((breaker) && (!breaker->allow(request.url()))) {
+        // Finished asynchronously, like a request that fails to connect.
+        rejected = true;
+        QMetaObject::invokeMethod(q, "_q_onCircuitRejected", Qt::QueuedConnection);
+        return;
+    }
+    
+    RateLimitStore *limiter = RateLimitStore::existingInstance();
+    
+    if ((rateLimited) && (limiter) && (!limiter->acquire(request.url(), q, "_q_onThrottleReleased"))) {
+        throttled = true;
+        throttledRequest = request;
+        throttledBody = body;
+        return;
+    }
+    
+    dispatchRequest(request, body);
+}
+
+/*!
+    \internal
+    \brief Sends \a request immediately, without applying rate limits.
+*/
+void RequestPrivate::dispatchRequest(const QNetworkRequest &request, const QByteArray &body) {
+    Q_Q(Request);
+    
+    rowBatch = QVariant();
+    
+    if (engineMode == Request::WorkerThreadEngine) {
+        job = new RequestJob(++jobId, operation, request, body);
+        
+        if (rowDictionaries) {
+            job->setRowDictionaries(*rowDictionaries);
+        }
+        
+        Request::connect(job, SIGNAL(finished(int,QVariant,bool,int,QString,int,QVariant)),
+                         q, SLOT(_q_onJobFinished(int,QVariant,bool,int,QString,int,QVariant)));
+        RequestEngine::instance()->start(job);
+        return;
+    }
+    
+    replyOperation = operation;
+    replyBody = body;
+    reply = sendReply(operation, request, body);
+    Request::connect(reply, SIGNAL(finished()), q, SLOT(_q_onReplyFinished()));
+    
+    if (maximumResponseSize > 0) {
+        Request::connect(reply, SIGNAL(downloadProgress(qint64,qint64)), q, SLOT(_q_onDownloadProgress(qint64,qint64)));
+    }
+}
+
+/*!
+    \internal
+    \brief Sends \a request with operation \a op and returns the reply.
+*/
+QNetworkReply* RequestPrivate::sendReply(Request::Operation op, const QNetworkRequest &request,
+                                         const QByteArray &body) {
+    switch (op) {
+    case Request::HeadOperation:
+        return networkAccessManager()->head(request);
+    case Request::PostOperation:
+        return networkAccessManager()->post(request, body);
+    case Request::PutOperation:
+        return networkAccessManager()->put(request, body);
+    case Request::DeleteOperation:
+        return networkAccessManager()->deleteResource(request);
+    default:
+        return networkAccessManager()->get(request);
+    }
+}
+
+/*!
+    \internal
+    \brief Disconnects and schedules deletion of the worker thread job, if any.
+*/
+void RequestPrivate::discardJob() {
+    if (job) {
+        Q_Q(Request);
+        Request::disconnect(job, 0, q, 0);
+        job->deleteLater();
+        job = 0;
+    }
+}
+
+/*!
+    \internal
+    \brief Removes the request from the RateLimiter queue, if it is waiting there.
+*/
+void RequestPrivate::cancelThrottled() {
+    if (throttled) {
+        Q_Q(Request);
+        throttled = false;
+        throttledRequest = QNetworkRequest();
+        throttledBody.clear();
+        RateLimitStore *limiter = RateLimitStore::existingInstance();
+        
+        if (limiter) {
+            limiter->cancel(q);
+        }
+    }
+}
+
+/*!
+    \internal
+    \brief Sends a failed GET or HEAD request again to the current EndpointSelector endpoint, if it was sent to 
+    another one.
+    
+    Returns true if the request was sent again. A request is only sent again once.
+*/
+bool RequestPrivate::failOver() {
+    if ((failedOver) || ((operation != Request::GetOperation) && (operation != Request::HeadOperation))) {
+        return false;
+    }
+    
+    EndpointStore *endpoints = EndpointStore::existingInstance();
+    
+    if (!endpoints) {
+        return false;
+    }
+    
+    const QUrl u = endpoints->rebase(sentUrl);
+    
+    if (u.isEmpty()) {
+        return false;
+    }
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::RequestPrivate::failOver" << sentUrl << u;
+#endif
+    failedOver = true;
+    QNetworkRequest request(sentRequest);
+    request.setUrl(u);
+    sendRequest(request);
+    return true;
 }
 
-void RequestPrivate::followRedirect(const QUrl &redirect) {
+/*!
+    \internal
+    \brief Sends the reply in progress again to \a redirect, following a response with \a statusCode.
+    
+    \sa RedirectCache::operation()
+*/
+void RequestPrivate::followRedirect(const QUrl &redirect, int statusCode) {
     Q_Q(Request);
     
     redirects++;
@@ -725,9 +1080,24 @@ void RequestPrivate::followRedirect(const QUrl &redirect) {
     if (reply) {
         delete reply;
     }
-        
-    reply = networkAccessManager()->get(buildRequest(redirect));
+    
+    QNetworkRequest request = buildRequest(redirect);
+    const Request::Operation op = RedirectCache::operation(replyOperation, statusCode);
+    
+    if (op != replyOperation) {
+        replyOperation = op;
+        replyBody.clear();
+        request.setHeader(QNetworkRequest::ContentTypeHeader, QVariant());
+    }
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::RequestPrivate::followRedirect" << statusCode << redirect << op;
+#endif
+    reply = sendReply(op, request, replyBody);
     Request::connect(reply, SIGNAL(finished()), q, SLOT(_q_onReplyFinished()));
+    
+    if (maximumResponseSize > 0) {
+        Request::connect(reply, SIGNAL(downloadProgress(qint64,qint64)), q, SLOT(_q_onDownloadProgress(qint64,qint64)));
+    }
 }
 
 void RequestPrivate::_q_onReplyFinished() {
@@ -735,31 +1105,159 @@ void RequestPrivate::_q_onReplyFinished() {
         return;
     }
     
-    Q_Q(Request);
-    
     if (redirects < MAX_REDIRECTS) {
-        QUrl redirect = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toString();
-    
-        if (redirect.isEmpty()) {
-            redirect = reply->header(QNetworkRequest::LocationHeader).toString();
-        }
-    
+        const QUrl redirect = RedirectCache::target(reply);
+        
         if (!redirect.isEmpty()) {
+            const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
             reply->deleteLater();
             reply = 0;
-            followRedirect(redirect);
+            followRedirect(redirect, statusCode);
             return;
         }
     }
     
     bool ok = true;
     const QString response = QString::fromUtf8(reply->readAll());
-    setResult(response.isEmpty() ? response : QtJson::Json::parse(response, ok));
+    const QVariant res = (rawResponse) || (response.isEmpty()) ? QVariant(response)
+                                                               : QtJson::Json::parse(response, ok);
     
     const QNetworkReply::NetworkError e = reply->error();
     const QString es = reply->errorString();
     reply->deleteLater();
     reply = 0;
+    replyBody.clear();
+    
+    finish(res, ok, e, es);
+}
+
+/*!
+    \internal
+    \brief Aborts the reply once it has received more than maximumResponseSize bytes.
+    
+    The request then finishes as canceled, without reading the rest of the response.
+*/
+void RequestPrivate::_q_onDownloadProgress(qint64 received, qint64) {
+    if ((reply) && (maximumResponseSize > 0) && (received > maximumResponseSize)) {
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::RequestPrivate::_q_onDownloadProgress: Response too large" << url << received;
+#endif
+        reply->abort();
+    }
+}
+
+void RequestPrivate::_q_onThrottleReleased() {
+    if (!throttled) {
+        return;
+    }
+    
+    const QNetworkRequest request = throttledRequest;
+    const QByteArray body = throttledBody;
+    throttled = false;
+    throttledRequest = QNetworkRequest();
+    throttledBody.clear();
+    dispatchRequest(request, body);
+}
+
+/*!
+    \internal
+    \brief Finishes a request rejected by the CircuitBreaker, with the cached result of a GET request if there is 
+    one.
+    
+    If another EndpointSelector endpoint is available, the request is sent there instead.
+*/
+void RequestPrivate::_q_onCircuitRejected() {
+    if (!rejected) {
+        return;
+    }
+    
+    Q_Q(Request);
+    
+    rejected = false;
+    EndpointStore *endpoints = EndpointStore::existingInstance();
+    
+    if ((endpoints) && (failover)) {
+        endpoints->record(sentUrl, true);
+        
+        if (failOver()) {
+            return;
+        }
+    }
+    
+    failedOver = false;
+    QVariant cached;
+    CircuitBreakerStore *breaker = CircuitBreakerStore::existingInstance();
+    
+    if ((operation == Request::GetOperation) && (breaker) && (breaker->cachedResponse(url, &cached))) {
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::RequestPrivate::_q_onCircuitRejected: Using cached result for" << url;
+#endif
+        setResult(cached);
+        setStatus(Request::Ready);
+        setError(Request::NoError);
+        setErrorString(QString());
+    }
+    else {
+        setResult(QVariant());
+        setStatus(Request::Failed);
+        setError(Request::CircuitOpenError);
+        setErrorString(Request::tr("The server is unavailable"));
+    }
+    
+    emit q->finished(q);
+}
+
+void RequestPrivate::_q_onJobFinished(int id, const QVariant &res, bool ok, int e, const QString &es, int hops,
+                                      const QVariant &rows) {
+    if ((!job) || (id != jobId)) {
+        return;
+    }
+    
+    redirects = hops;
+    rowBatch = rows;
+
+    job->deleteLater();
+    job = 0;
+    finish(res, ok, QNetworkReply::NetworkError(e), es);
+}
+
+/*!
+    \internal
+    \brief Sets the result, status and error of a completed request and emits Request::finished().
+*/
+void RequestPrivate::finish(const QVariant &res, bool ok, QNetworkReply::NetworkError e, const QString &es) {
+    Q_Q(Request);
+    
+    if ((!rewrittenUrl.isEmpty()) && (e != QNetworkReply::NoError) && (e != QNetworkReply::OperationCanceledError)) {
+        // The resource may have moved back, so send the next request to the original url.
+        RedirectCache::invalidate(rewrittenUrl);
+        rewrittenUrl = QUrl();
+    }
+    
+    CircuitBreakerStore *breaker = CircuitBreakerStore::existingInstance();
+    
+    if (breaker) {
+        breaker->record(sentUrl, e);
+        
+        if ((ok) && (e == QNetworkReply::NoError) && (operation == Request::GetOperation) && (cacheResult)
+            && (!rawResponse)) {
+            breaker->storeResponse(url, res);
+        }
+    }
+    
+    EndpointStore *endpoints = EndpointStore::existingInstance();
+    
+    if ((endpoints) && (failover) && (e != QNetworkReply::OperationCanceledError)) {
+        const bool failed = isEndpointFailure(e);
+        endpoints->record(sentUrl, failed);
+        
+        if ((failed) && (failOver())) {
+            return;
+        }
+    }
+    
+    failedOver = false;
+    setResult(res);
     
     switch (e) {
     case QNetworkReply::NoError:
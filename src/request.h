@@ -34,6 +34,7 @@ class CUTERADIOSHARED_EXPORT Request : public QObject
     Q_OBJECT
     
     Q_PROPERTY(QString accessToken READ accessToken WRITE setAccessToken NOTIFY accessTokenChanged)
+    Q_PROPERTY(EngineMode engineMode READ engineMode WRITE setEngineMode NOTIFY engineModeChanged)
     Q_PROPERTY(QUrl url READ url NOTIFY urlChanged)
     Q_PROPERTY(QVariantMap headers READ headers NOTIFY headersChanged)
     Q_PROPERTY(QVariant data READ data NOTIFY dataChanged)
@@ -42,8 +43,9 @@ class CUTERADIOSHARED_EXPORT Request : public QObject
     Q_PROPERTY(QVariant result READ result NOTIFY finished)
     Q_PROPERTY(Error error READ error NOTIFY finished)
     Q_PROPERTY(QString errorString READ errorString NOTIFY finished)
+    Q_PROPERTY(int redirectCount READ redirectCount NOTIFY finished)
     
-    Q_ENUMS(Operation Status Error)
+    Q_ENUMS(Operation Status Error EngineMode)
     
 public:
     enum Operation {
@@ -99,7 +101,15 @@ public:
         ProtocolFailure = 399,
         
         // Json parser error
-        ParseError = 401
+        ParseError = 401,
+        
+        // Circuit breaker error
+        CircuitOpenError = 501
+    };
+    
+    enum EngineMode {
+        DirectEngine = 0,
+        WorkerThreadEngine
     };
     
     explicit Request(QObject *parent = 0);
@@ -108,6 +118,12 @@ public:
     QString accessToken() const;
     void setAccessToken(const QString &token);
     
+    EngineMode engineMode() const;
+    void setEngineMode(EngineMode mode);
+    
+    static EngineMode defaultEngineMode();
+    static void setDefaultEngineMode(EngineMode mode);
+    
     QUrl url() const;
     
     QVariantMap headers() const;
@@ -123,10 +139,15 @@ public:
     Error error() const;
     QString errorString() const;
     
+    int redirectCount() const;
+    
+    static void clearRedirectCache();
+    
     void setNetworkAccessManager(QNetworkAccessManager *manager);
     
 public Q_SLOTS:
     void cancel();
+    void clearResult();
     
 protected:
     void setUrl(const QUrl &url);
@@ -142,6 +163,7 @@ protected Q_SLOTS:
     
 Q_SIGNALS:
     void accessTokenChanged();
+    void engineModeChanged();
     void urlChanged();
     void dataChanged();
     void headersChanged();
@@ -157,6 +179,10 @@ protected:
     Q_DECLARE_PRIVATE(Request)
     
     Q_PRIVATE_SLOT(d_func(), void _q_onReplyFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_onDownloadProgress(qint64, qint64))
+    Q_PRIVATE_SLOT(d_func(), void _q_onJobFinished(int, QVariant, bool, int, QString, int, QVariant))
+    Q_PRIVATE_SLOT(d_func(), void _q_onThrottleReleased())
+    Q_PRIVATE_SLOT(d_func(), void _q_onCircuitRejected())
     
 private:
     Q_DISABLE_COPY(Request)
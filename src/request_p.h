@@ -20,8 +20,10 @@
 #include "request.h"
 #include "json.h"
 #include <QUrl>
+#include <QHash>
 #include <QVariantMap>
 #include <QNetworkRequest>
+#include <QNetworkReply>
 #if QT_VERSION >= 0x050000
 #include <QUrlQuery>
 #endif
@@ -29,10 +31,11 @@
 #include <QDebug>
 #endif
 
-class QNetworkReply;
-
 namespace CuteRadio {
 
+class RequestJob;
+class ValueDictionary;
+
 static const int MAX_REDIRECTS = 8;
 
 #if QT_VERSION >= 0x050000
@@ -77,31 +80,6 @@ inline void addRequestHeaders(QNetworkRequest *request, const QVariantMap &map)
         }
     }
 }
-
-inline void addPostBody(QString *body, const QVariantMap &map) {
-#ifdef CUTERADIO_DEBUG
-    qDebug() << "addPostBody:" << body << map;
-#endif
-    QMapIterator<QString, QVariant> iterator(map);
-        
-    while (iterator.hasNext()) {
-        iterator.next();
-        
-        switch (iterator.value().type()) {
-        case QVariant::String:
-        case QVariant::ByteArray:
-            body->append(iterator.key() + "=" + iterator.value().toString());
-            break;
-        default:
-            body->append(iterator.key() + "=" + QtJson::Json::serialize(iterator.value()));
-            break;
-        }        
-        
-        if (iterator.hasNext()) {
-            body->append("&");
-        }
-    }
-}
 #else
 inline void addUrlQueryItems(QUrl *url, const QVariantMap &map) {
 #ifdef CUTERADIO_DEBUG
@@ -150,35 +128,185 @@ inline void addRequestHeaders(QNetworkRequest *request, const QVariantMap &map)
         }
     }
 }
+#endif
+
+inline void addFormEncoded(QByteArray *body, uchar c) {
+    static const char hex[] = "0123456789ABCDEF";
+    
+    if (((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || ((c >= '0') && (c <= '9'))
+        || (c == '-') || (c == '.') || (c == '_') || (c == '~')) {
+        body->append(char(c));
+    }
+    else {
+        const char escaped[3] = { '%', hex[c >> 4], hex[c & 0xf] };
+        body->append(escaped, 3);
+    }
+}
+
+inline void addFormEncoded(QByteArray *body, const char *bytes, int size) {
+    for (int i = 0; i < size; i++) {
+        addFormEncoded(body, uchar(bytes[i]));
+    }
+}
+
+inline void addFormEncoded(QByteArray *body, const QString &s) {
+    const QChar *p = s.unicode();
+    const QChar *end = p + s.size();
+    
+    // ASCII is encoded in place. Only a non-ASCII tail is converted to UTF-8 first.
+    for (; p != end; ++p) {
+        if (p->unicode() >= 0x80) {
+            const QByteArray utf8 = QString(p, int(end - p)).toUtf8();
+            addFormEncoded(body, utf8.constData(), utf8.size());
+            return;
+        }
+        
+        addFormEncoded(body, uchar(p->unicode()));
+    }
+}
 
-inline void addPostBody(QString *body, const QVariantMap &map) {
+inline void addPostBody(QByteArray *body, const QVariantMap &map) {
 #ifdef CUTERADIO_DEBUG
-    qDebug() << "addPostBody:" << body << map;
+    qDebug() << "addPostBody:" << *body << map;
 #endif
     QMapIterator<QString, QVariant> iterator(map);
+    int size = body->size();
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        size += iterator.key().size() + 2;
+        
+        switch (iterator.value().type()) {
+        case QVariant::String:
+            size += iterator.value().toString().size();
+            break;
+        case QVariant::ByteArray:
+            size += iterator.value().toByteArray().size();
+            break;
+        default:
+            size += 16;
+            break;
+        }
+    }
+    
+    body->reserve(size + size / 4);
+    iterator.toFront();
     
     while (iterator.hasNext()) {
         iterator.next();
+        addFormEncoded(body, iterator.key());
+        body->append('=');
         
         switch (iterator.value().type()) {
         case QVariant::String:
+            addFormEncoded(body, iterator.value().toString());
+            break;
         case QVariant::ByteArray:
-            body->append(iterator.key() + "=" + iterator.value().toString());
+        {
+            const QByteArray bytes = iterator.value().toByteArray();
+            addFormEncoded(body, bytes.constData(), bytes.size());
             break;
+        }
+#if QT_VERSION < 0x050000
         case QVariant::Double: // In QtQuick 1.x, integers declared in JS are passed as doubles.
-            body->append(iterator.key() + "=" + QString::number(iterator.value().toInt()));
+            body->append(QByteArray::number(iterator.value().toInt()));
             break;
+#endif
         default:
-            body->append(iterator.key() + "=" + QtJson::Json::serialize(iterator.value()));
+        {
+            QByteArray json;
+            QtJson::Json::serialize(iterator.value(), json);
+            addFormEncoded(body, json.constData(), json.size());
             break;
-        }        
+        }
+        }
         
         if (iterator.hasNext()) {
-            body->append("&");
+            body->append('&');
         }
     }
 }
+
+/*!
+    \internal
+    \brief Returns true if \a e means that the endpoint could not be reached or could not handle the request.
+    
+    Content errors, such as 404 (Not Found) or 401 (Unauthorized), show that the endpoint is working.
+*/
+inline bool isEndpointFailure(QNetworkReply::NetworkError e) {
+    switch (e) {
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::HostNotFoundError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::SslHandshakeFailedError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::UnknownNetworkError:
+#if QT_VERSION >= 0x050300
+    case QNetworkReply::InternalServerError:
+    case QNetworkReply::ServiceUnavailableError:
+    case QNetworkReply::UnknownServerError:
 #endif
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*!
+    \internal
+    \brief Returns true if \a path is \a prefix, or is below it.
+*/
+inline bool pathHasPrefix(const QString &path, const QString &prefix) {
+    if ((prefix.isEmpty()) || (prefix == "/")) {
+        return true;
+    }
+    
+    if (!path.startsWith(prefix)) {
+        return false;
+    }
+    
+    return (path.size() == prefix.size()) || (prefix.endsWith('/')) || (path.at(prefix.size()) == '/');
+}
+
+static const int MAX_RESOURCE_URLS = 32;
+
+/*!
+    \internal
+    \brief The parts of a QNetworkRequest that stay the same for every call made with a given access token and
+    set of headers.
+    
+    The Authorization header is base64-encoded, and non-string headers are serialized, once when the template is 
+    created. Custom headers are applied after the Authorization header, so a caller-supplied Authorization header 
+    takes precedence. Building a request from the template is then a copy of an implicitly shared QNetworkRequest 
+    plus setUrl().
+*/
+class RequestTemplate
+{
+
+public:
+    RequestTemplate() {}
+    
+    RequestTemplate(const QString &accessToken, const QVariantMap &headers) {
+        if (!accessToken.isEmpty()) {
+            authorized.setRawHeader("Authorization", "Basic " + QByteArray(accessToken.toUtf8() + ":").toBase64());
+        }
+        
+        if (!headers.isEmpty()) {
+            addRequestHeaders(&anonymous, headers);
+            addRequestHeaders(&authorized, headers);
+        }
+    }
+    
+    QNetworkRequest request(const QUrl &url, bool authRequired = true) const {
+        QNetworkRequest r(authRequired ? authorized : anonymous);
+        r.setUrl(url);
+        return r;
+    }
+    
+    QNetworkRequest anonymous;
+    QNetworkRequest authorized;
+};
 
 class RequestPrivate
 {
@@ -187,6 +315,8 @@ public:
     RequestPrivate(Request *parent);
     virtual ~RequestPrivate();
     
+    static RequestPrivate* get(Request *request) { return request->d_func(); }
+    
     QNetworkAccessManager* networkAccessManager();
     
     void setOperation(Request::Operation op);
@@ -202,16 +332,53 @@ public:
     virtual QNetworkRequest buildRequest(bool authRequired = true);
     virtual QNetworkRequest buildRequest(QUrl u, bool authRequired = true);
     
-    virtual void followRedirect(const QUrl &redirect);
+    bool buildBody(QByteArray *body) const;
+    
+    const RequestTemplate& requestTemplate();
+    
+    QUrl resourceUrl(const QString &resourcePath);
+    
+    void sendRequest(const QNetworkRequest &request, const QByteArray &body = QByteArray());
+    void dispatchRequest(const QNetworkRequest &request, const QByteArray &body);
+    
+    QNetworkReply* sendReply(Request::Operation op, const QNetworkRequest &request, const QByteArray &body);
+    
+    void cancelThrottled();
+    
+    bool failOver();
+    
+    void discardJob();
+    
+    virtual void followRedirect(const QUrl &redirect, int statusCode);
+    
+    void finish(const QVariant &res, bool ok, QNetworkReply::NetworkError e, const QString &es);
         
     virtual void _q_onReplyFinished();
     
+    void _q_onDownloadProgress(qint64 received, qint64 total);
+    
+    void _q_onJobFinished(int id, const QVariant &res, bool ok, int e, const QString &es, int hops,
+                          const QVariant &rows);
+    
+    void _q_onThrottleReleased();
+    
+    void _q_onCircuitRejected();
+    
     Request *q_ptr;
     
     QNetworkAccessManager *manager;
     
     QNetworkReply *reply;
     
+    RequestJob *job;
+    
+    int jobId;
+    
+    const QHash<QString, ValueDictionary> *rowDictionaries;
+    QVariant rowBatch;
+    
+    Request::EngineMode engineMode;
+    
     bool ownNetworkAccessManager;
     
     QString accessToken;
@@ -220,6 +387,13 @@ public:
     
     QVariantMap headers;
     
+    RequestTemplate reqTemplate;
+    
+    bool reqTemplateValid;
+    
+    QHash<QString, QUrl> resourceUrls;
+    QString resourceUrlBase;
+    
     QVariant data;
     
     QVariant result;
@@ -234,6 +408,43 @@ public:
     
     int redirects;
     
+    // The operation and body of the reply in progress, which differ from operation after some redirects.
+    Request::Operation replyOperation;
+    QByteArray replyBody;
+    
+    // The url the request was sent to, if a cached permanent redirect was applied to it.
+    QUrl rewrittenUrl;
+    
+    // The request passed to sendRequest(), and the url it was actually sent to.
+    QNetworkRequest sentRequest;
+    QUrl sentUrl;
+    
+    // Whether the outcome is recorded by the EndpointSelector, so that a failed GET or HEAD request may be sent 
+    // again to another endpoint, and whether it already has been. Probes record their own outcome.
+    bool failover;
+    bool failedOver;
+    
+    // Whether the request waits for a RateLimiter token. Probes are sent at once, so their timeout and latency 
+    // do not include time spent in the queue.
+    bool rateLimited;
+    
+    // Set while the request is queued by the RateLimiter, until throttledRequest can be sent.
+    bool throttled;
+    QNetworkRequest throttledRequest;
+    QByteArray throttledBody;
+    
+    // Set while a request rejected by the CircuitBreaker waits to be finished by _q_onCircuitRejected().
+    bool rejected;
+    
+    // When true, the response body is returned as a QString instead of being parsed as JSON (DirectEngine only).
+    bool rawResponse;
+    
+    // Whether a successful GET result may be kept by the CircuitBreaker, to be served while the circuit is open.
+    bool cacheResult;
+    
+    // When greater than 0, a reply is aborted once more than this many bytes have been received (DirectEngine only).
+    qint64 maximumResponseSize;
+    
     Q_DECLARE_PUBLIC(Request)
 };
 
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "requestengine_p.h"
+#include "request_p.h"
+#include "redirectcache_p.h"
+#include <QCoreApplication>
+#include <QMutex>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QThread>
+#ifdef CUTERADIO_DEBUG
+#include <QDebug>
+#endif
+
+namespace CuteRadio {
+
+Q_GLOBAL_STATIC(QMutex, engineMutex)
+
+RequestEngine* RequestEngine::self = 0;
+QThread* RequestEngine::workerThread = 0;
+
+/*!
+    \internal
+    \class RequestJob
+    \brief Sends a single request and parses its response in the RequestEngine thread.
+    
+    A RequestJob is created by RequestPrivate in the thread that owns the request, then moved to the engine 
+    thread. Redirects are followed and the response is parsed in the engine thread, and only the finished result 
+    is emitted back to the owning thread.
+    
+    If row dictionaries are set, the items of a page are also built into a RowBatch in the engine thread.
+*/
+RequestJob::RequestJob(int id, Request::Operation operation, const QNetworkRequest &request,
+                       const QByteArray &body) :
+    QObject(),
+    engine(0),
+    id(id),
+    operation(operation),
+    request(request),
+    body(body),
+    reply(0),
+    redirects(0),
+    aborted(false),
+    done(false),
+    rowsEnabled(false)
+{
+}
+
+RequestJob::~RequestJob() {
+    if (reply) {
+        delete reply;
+        reply = 0;
+    }
+}
+
+/*!
+    \internal
+    \brief Makes the job build the items of the response into a RowBatch, interning values with \a dictionaries.
+*/
+void RequestJob::setRowDictionaries(const QHash<QString, ValueDictionary> &dictionaries) {
+    this->dictionaries = dictionaries;
+    rowsEnabled = true;
+}
+
+void RequestJob::start() {
+    if (aborted) {
+        complete(QVariant(), true, QNetworkReply::OperationCanceledError, QString());
+        return;
+    }
+    
+    send(request);
+}
+
+void RequestJob::abort() {
+    aborted = true;
+    
+    if (reply) {
+        reply->abort();
+    }
+}
+
+void RequestJob::send(const QNetworkRequest &request) {
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::RequestJob::send" << request.url() << operation;
+#endif
+    QNetworkAccessManager *manager = engine->networkAccessManager();
+    
+    switch (operation) {
+    case Request::HeadOperation:
+        reply = manager->head(request);
+        break;
+    case Request::PostOperation:
+        reply = manager->post(request, body);
+        break;
+    case Request::PutOperation:
+        reply = manager->put(request, body);
+        break;
+    case Request::DeleteOperation:
+        reply = manager->deleteResource(request);
+        break;
+    default:
+        reply = manager->get(request);
+        break;
+    }
+    
+    connect(reply, SIGNAL(finished()), this, SLOT(onReplyFinished()));
+}
+
+void RequestJob::onReplyFinished() {
+    if (!reply) {
+        return;
+    }
+    
+    if ((!aborted) && (redirects < MAX_REDIRECTS)) {
+        const QUrl redirect = RedirectCache::target(reply);
+        
+        if (!redirect.isEmpty()) {
+            const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            const Request::Operation op = RedirectCache::operation(operation, statusCode);
+            reply->deleteLater();
+            reply = 0;
+            redirects++;
+            // The operation and body are kept or dropped as in RequestPrivate::followRedirect().
+            request.setUrl(redirect);
+            
+            if (op != operation) {
+                operation = op;
+                body.clear();
+                request.setHeader(QNetworkRequest::ContentTypeHeader, QVariant());
+            }
+            
+            send(request);
+            return;
+        }
+    }
+    
+    bool ok = true;
+    const QString response = QString::fromUtf8(reply->readAll());
+    const QVariant result = response.isEmpty() ? QVariant(response) : QtJson::Json::parse(response, ok);
+    const int e = reply->error();
+    const QString es = reply->errorString();
+    reply->deleteLater();
+    reply = 0;
+    
+    if ((rowsEnabled) && (ok) && (e == QNetworkReply::NoError) && (operation == Request::GetOperation)) {
+        complete(result, ok, e, es, buildRows(result));
+    }
+    else {
+        complete(result, ok, e, es);
+    }
+}
+
+void RequestJob::complete(const QVariant &result, bool ok, int error, const QString &errorString,
+                          const QVariant &rows) {
+    if (!done) {
+        done = true;
+        emit finished(id, result, ok, error, errorString, redirects, rows);
+    }
+}
+
+/*!
+    \internal
+    \brief Returns the items of \a result as a RowBatch, or an invalid QVariant if \a result has no items.
+*/
+QVariant RequestJob::buildRows(const QVariant &result) {
+    const QVariantList list = result.toMap().value("items").toList();
+    
+    if (list.isEmpty()) {
+        return QVariant();
+    }
+    
+    RowBatch batch;
+    batch.rows.reserve(list.size());
+    
+    foreach (const QVariant &item, list) {
+        QVariantMap row = item.toMap();
+        
+        if (!dictionaries.isEmpty()) {
+            internValues(dictionaries, row);
+        }
+        
+        batch.rows << row;
+    }
+    
+    batch.dictionaries = dictionaries;
+    return QVariant::fromValue(batch);
+}
+
+/*!
+    \internal
+    \class RequestEngine
+    \brief Owns the worker thread and QNetworkAccessManager used by requests in Request::WorkerThreadEngine mode.
+    
+    The engine is created on first use and lives in its own thread until the application exits.
+*/
+RequestEngine::RequestEngine() :
+    QObject(),
+    manager(0)
+{
+}
+
+RequestEngine* RequestEngine::instance() {
+    QMutexLocker locker(engineMutex());
+    
+    if (!self) {
+        workerThread = new QThread;
+        self = new RequestEngine;
+        self->moveToThread(workerThread);
+        workerThread->start();
+        qAddPostRoutine(RequestEngine::cleanup);
+    }
+    
+    return self;
+}
+
+/*!
+    \internal
+    \brief Returns the engine's QNetworkAccessManager, creating it if needed.
+    
+    Must only be called from the engine thread.
+*/
+QNetworkAccessManager* RequestEngine::networkAccessManager() {
+    Q_ASSERT(QThread::currentThread() == thread());
+    
+    if (!manager) {
+        manager = new QNetworkAccessManager(this);
+    }
+    
+    return manager;
+}
+
+/*!
+    \internal
+    \brief Moves \a job to the engine thread and starts it there.
+*/
+void RequestEngine::start(RequestJob *job) {
+    job->engine = this;
+    job->moveToThread(workerThread);
+    QMetaObject::invokeMethod(job, "start", Qt::QueuedConnection);
+}
+
+void RequestEngine::cleanup() {
+    engineMutex()->lock();
+    RequestEngine *engine = self;
+    QThread *t = workerThread;
+    self = 0;
+    workerThread = 0;
+    engineMutex()->unlock();
+    
+    if (engine) {
+        // Deferred deletions are processed when the thread finishes, so the manager is destroyed in its own thread.
+        engine->deleteLater();
+        t->quit();
+        t->wait();
+        delete t;
+    }
+}
+
+}
+
+#include "moc_requestengine_p.cpp"
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_REQUESTENGINE_P_H
+#define CUTERADIO_REQUESTENGINE_P_H
+
+#include "request.h"
+#include "model_p.h"
+#include <QNetworkRequest>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QThread;
+
+namespace CuteRadio {
+
+class RequestEngine;
+
+/*!
+    \internal
+    \brief The rows of a page, built and interned by a RequestJob so that a model can insert them as they are.
+    
+    The rows hold the strings of the dictionaries, which start as a copy of the model's dictionaries when the 
+    job is created.
+*/
+class RowBatch
+{
+
+public:
+    QList<QVariantMap> rows;
+    
+    QHash<QString, ValueDictionary> dictionaries;
+};
+
+class RequestJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    RequestJob(int id, Request::Operation operation, const QNetworkRequest &request, const QByteArray &body);
+    ~RequestJob();
+    
+    void setRowDictionaries(const QHash<QString, ValueDictionary> &dictionaries);
+
+public Q_SLOTS:
+    void start();
+    void abort();
+
+Q_SIGNALS:
+    void finished(int id, const QVariant &result, bool ok, int error, const QString &errorString, int redirects,
+                  const QVariant &rows);
+
+private Q_SLOTS:
+    void onReplyFinished();
+
+private:
+    void send(const QNetworkRequest &request);
+    
+    void complete(const QVariant &result, bool ok, int error, const QString &errorString,
+                  const QVariant &rows = QVariant());
+    
+    QVariant buildRows(const QVariant &result);
+
+    RequestEngine *engine;
+    
+    int id;
+    
+    Request::Operation operation;
+    
+    QNetworkRequest request;
+    
+    QByteArray body;
+    
+    QNetworkReply *reply;
+    
+    int redirects;
+    
+    bool aborted;
+    
+    bool done;
+    
+    bool rowsEnabled;
+    
+    QHash<QString, ValueDictionary> dictionaries;
+    
+    friend class RequestEngine;
+};
+
+class RequestEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    static RequestEngine* instance();
+    
+    QNetworkAccessManager* networkAccessManager();
+    
+    void start(RequestJob *job);
+
+private:
+    RequestEngine();
+    
+    static void cleanup();
+    
+    static RequestEngine *self;
+    
+    static QThread *workerThread;
+    
+    QNetworkAccessManager *manager;
+};
+
+}
+
+Q_DECLARE_METATYPE(CuteRadio::RowBatch)
+
+#endif // CUTERADIO_REQUESTENGINE_P_H
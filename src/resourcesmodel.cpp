@@ -16,6 +16,10 @@
 
 #include "resourcesmodel.h"
 #include "resourcesmodel_p.h"
+#include "playedstationsjournal_p.h"
+#include "request_p.h"
+#include "requestengine_p.h"
+#include "rowsorter_p.h"
 #include "urls.h"
 #ifdef CUTERADIO_DEBUG
 #include <QDebug>
@@ -23,6 +27,10 @@
 
 namespace CuteRadio {
 
+// Models with fewer rows are sorted without using a thread.
+static const int THREADED_SORT_ROWS = 2000;
+static const int DEFAULT_FILTER_DELAY = 250;
+
 /*!
     \class ResourcesModel
     \brief A list model for retrieving cuteRadio resources.
@@ -93,7 +101,33 @@ namespace CuteRadio {
     }
     \endcode
     
-    \sa ResourcesRequest
+    Windowed mode
+    
+    By default, every page that is fetched stays in memory. When windowPages is greater than zero, the model 
+    keeps at most that many pages resident. When a page is added, the resident pages furthest from the 
+    most recently viewed row are evicted and their rows become placeholders, with no data. The row count does 
+    not change. When a placeholder row is viewed, its page is fetched again using the next link of the page 
+    before it, and the rows are filled in place. Rows should not be inserted or removed in windowed mode.
+    
+    Offline mode
+    
+    When the mirror property is set to a CatalogMirror, resources that the mirror holds are read from its local 
+    database instead of the network, using the same resource and filters.
+    
+    Snapshots
+    
+    When snapshotPath is set, the rows of the last complete load are saved to that file, and are shown when the 
+    model is next created, before any request is made. The snapshot is memory-mapped and its values are read when 
+    they are requested, so opening it does not depend on the number of rows. The snapshot rows are read-only, and 
+    are replaced when the first page of the next load is received.
+    
+    Local sorting
+    
+    Once every page has been fetched, sortItems() changes the order of the rows without making a request. The 
+    sort key of each row is computed once, and large models are sorted in a thread, so the model stays responsive 
+    while it is sorted. The order is kept until the model is reloaded.
+    
+    \sa ResourcesRequest, CatalogMirror
 */
 
 ResourcesModel::ResourcesModel(QObject *parent) :
@@ -102,8 +136,15 @@ ResourcesModel::ResourcesModel(QObject *parent) :
     Q_D(ResourcesModel);
 
     d->request = new ResourcesRequest(this);
+    RequestPrivate::get(d->request)->rowDictionaries = &d->dictionaries;
     connect(d->request, SIGNAL(accessTokenChanged()), this, SIGNAL(accessTokenChanged()));
+    connect(d->request, SIGNAL(engineModeChanged()), this, SIGNAL(engineModeChanged()));
     connect(d->request, SIGNAL(finished(CuteRadio::Request*)), this, SLOT(_q_onRequestFinished()));
+    
+    d->filterTimer = new QTimer(this);
+    d->filterTimer->setSingleShot(true);
+    d->filterTimer->setInterval(DEFAULT_FILTER_DELAY);
+    connect(d->filterTimer, SIGNAL(timeout()), this, SLOT(reload()));
 }
 
 /*!
@@ -128,10 +169,47 @@ QString ResourcesModel::accessToken() const {
 void ResourcesModel::setAccessToken(const QString &token) {
     Q_D(ResourcesModel);
     
+    d->supersede();
     d->request->setAccessToken(token);
+    
+    if (d->pages) {
+        d->pages->setAccessToken(token);
+    }
+    
+    d->closeSnapshot();
     clear();
 }
 
+/*!
+    \property enum ResourcesModel::engineMode
+    \brief Where network replies are handled and parsed.
+    
+    In Request::WorkerThreadEngine mode, responses are parsed in a worker thread and each finished page is 
+    inserted into the model as a single batch, so large pages do not block the thread that owns the model.
+    
+    \sa Request::engineMode
+*/
+
+/*!
+    \fn void ResourcesModel::engineModeChanged()
+    \brief Emitted when the engineMode changes.
+*/
+Request::EngineMode ResourcesModel::engineMode() const {
+    Q_D(const ResourcesModel);
+    
+    return d->request->engineMode();
+}
+
+void ResourcesModel::setEngineMode(Request::EngineMode mode) {
+    Q_D(ResourcesModel);
+    
+    d->request->setEngineMode(mode);
+    
+    if (d->pages) {
+        d->pages->setEngineMode(mode);
+    }
+}
+
 /*!
     \property QString ResourcesModel::resource
     \brief The resource type to be retrieved by the model.
@@ -174,7 +252,9 @@ QString ResourcesModel::resource() const {
 void ResourcesModel::setResource(const QString &name) {
     if (name != resource()) {
         Q_D(ResourcesModel);
+        d->supersede();
         d->resource = name;
+        d->closeSnapshot();
         clear();
         emit resourceChanged();
     }
@@ -194,14 +274,58 @@ void ResourcesModel::setFilters(const QVariantMap &map) {
     Q_D(ResourcesModel);
     
     d->filters = map;
+    d->supersede();
+    d->closeSnapshot();
     clear();
     emit filtersChanged();
+    
+    if (filterDelay() > 0) {
+        d->filterTimer->start();
+    }
 }
 
 void ResourcesModel::resetFilters() {
     setFilters(QVariantMap());
 }
 
+/*!
+    \property int ResourcesModel::filterDelay
+    \brief The time in milliseconds after the last change of filters before the model reloads.
+    
+    Changing the filters always cancels any request that is in progress, since its result is no longer wanted. 
+    When filterDelay is greater than zero, the model also reloads automatically once the filters have not changed 
+    for filterDelay milliseconds, so typing a search only requests the final filters.
+    
+    The default value is 250. A value of 0 does not reload automatically, so reload() must be called after 
+    changing the filters.
+*/
+
+/*!
+    \fn void ResourcesModel::filterDelayChanged()
+    \brief Emitted when the filterDelay changes.
+*/
+int ResourcesModel::filterDelay() const {
+    Q_D(const ResourcesModel);
+    
+    return d->filterTimer->interval();
+}
+
+void ResourcesModel::setFilterDelay(int delay) {
+    Q_D(ResourcesModel);
+    
+    delay = qMax(0, delay);
+    
+    if (delay != filterDelay()) {
+        d->filterTimer->setInterval(delay);
+        
+        if (delay == 0) {
+            d->filterTimer->stop();
+        }
+        
+        emit filterDelayChanged();
+    }
+}
+
 /*!
     \property enum ResourcesModel::status
     \brief The current status of the model.
@@ -216,7 +340,11 @@ void ResourcesModel::resetFilters() {
 ResourcesRequest::Status ResourcesModel::status() const {
     Q_D(const ResourcesModel);
     
-    return d->request->status();
+    if (d->mirrorActive) {
+        return ResourcesRequest::Ready;
+    }
+    
+    return (d->pages) && (d->pagesActive) ? d->pages->status() : d->request->status();
 }
 
 /*!
@@ -240,7 +368,11 @@ QVariant ResourcesModel::result() const {
 ResourcesRequest::Error ResourcesModel::error() const {
     Q_D(const ResourcesModel);
     
-    return d->request->error();
+    if (d->mirrorActive) {
+        return ResourcesRequest::NoError;
+    }
+    
+    return (d->pages) && (d->pagesActive) ? d->pages->error() : d->request->error();
 }
 
 /*!
@@ -252,7 +384,180 @@ ResourcesRequest::Error ResourcesModel::error() const {
 QString ResourcesModel::errorString() const {
     Q_D(const ResourcesModel);
     
-    return d->request->errorString();
+    if (d->mirrorActive) {
+        return QString();
+    }
+    
+    return (d->pages) && (d->pagesActive) ? d->pages->errorString() : d->request->errorString();
+}
+
+/*!
+    \enum ResourcesModel::ResultRetention
+    \brief Whether the parsed result of a request is kept after its items have been added to the model.
+    
+    Can be one of the following:
+    
+    <table>
+        <tr>
+            <th>Value</th>
+            <th>Description</th>
+        </tr>
+        <tr>
+            <td>RetainResult</td>
+            <td>The result is kept until the next request completes (default).</td>
+        </tr>
+        <tr>
+            <td>DiscardIngestedResult</td>
+            <td>
+                The result is released as soon as its items have been added, so the model's memory use is bounded 
+                by its rows. The result property is then invalid, and the result is not kept by a CircuitBreaker 
+                either.
+            </td>
+        </tr>
+    </table>
+*/
+
+/*!
+    \property enum ResourcesModel::resultRetention
+    \brief Whether the parsed result of a request is kept after its items have been added to the model.
+    
+    \sa memoryUsage()
+*/
+
+/*!
+    \fn void ResourcesModel::resultRetentionChanged()
+    \brief Emitted when the resultRetention changes.
+*/
+ResourcesModel::ResultRetention ResourcesModel::resultRetention() const {
+    Q_D(const ResourcesModel);
+    
+    return d->retention;
+}
+
+void ResourcesModel::setResultRetention(ResourcesModel::ResultRetention retention) {
+    Q_D(ResourcesModel);
+    
+    if (retention != d->retention) {
+        d->retention = retention;
+        RequestPrivate::get(d->request)->cacheResult = (retention == RetainResult);
+        
+        if ((retention == DiscardIngestedResult) && (d->request->status() != ResourcesRequest::Loading)) {
+            d->request->clearResult();
+        }
+        
+        emit resultRetentionChanged();
+    }
+}
+
+/*!
+    \property int ResourcesModel::windowPages
+    \brief The maximum number of pages kept in memory.
+    
+    The default value is 0, which keeps every page.
+*/
+
+/*!
+    \fn void ResourcesModel::windowPagesChanged()
+    \brief Emitted when the windowPages changes.
+*/
+int ResourcesModel::windowPages() const {
+    Q_D(const ResourcesModel);
+    
+    return d->windowPages;
+}
+
+void ResourcesModel::setWindowPages(int pages) {
+    Q_D(ResourcesModel);
+    
+    pages = qMax(0, pages);
+    
+    if (pages != d->windowPages) {
+        d->windowPages = pages;
+        d->evictPages();
+        emit windowPagesChanged();
+    }
+}
+
+/*!
+    \property CatalogMirror* ResourcesModel::mirror
+    \brief The local mirror from which resources are read instead of the network.
+    
+    If the mirror does not hold the resource, it is requested from the network as usual. The model is not 
+    reloaded when the mirror changes.
+    
+    The default value is 0, which always uses the network.
+    
+    \sa CatalogMirror::canQuery()
+*/
+
+/*!
+    \fn void ResourcesModel::mirrorChanged()
+    \brief Emitted when the mirror changes.
+*/
+CatalogMirror* ResourcesModel::mirror() const {
+    Q_D(const ResourcesModel);
+    
+    return d->mirror;
+}
+
+void ResourcesModel::setMirror(CatalogMirror *mirror) {
+    Q_D(ResourcesModel);
+    
+    if (mirror != d->mirror) {
+        d->mirror = mirror;
+        emit mirrorChanged();
+    }
+}
+
+/*!
+    \property QString ResourcesModel::snapshotPath
+    \brief The path of the file used to save and restore the rows of the model.
+    
+    Setting the path while the model is empty shows the rows of the snapshot at that path, if there is one. Each 
+    model should use a different path for each resource and set of filters, since the snapshot is shown without 
+    checking them.
+    
+    The default value is empty, which does not use a snapshot.
+    
+    \sa saveSnapshot()
+*/
+
+/*!
+    \fn void ResourcesModel::snapshotPathChanged()
+    \brief Emitted when the snapshotPath changes.
+*/
+QString ResourcesModel::snapshotPath() const {
+    Q_D(const ResourcesModel);
+    
+    return d->snapshotPath;
+}
+
+void ResourcesModel::setSnapshotPath(const QString &path) {
+    Q_D(ResourcesModel);
+    
+    if (path != d->snapshotPath) {
+        d->closeSnapshot();
+        d->snapshotPath = path;
+        d->openSnapshot();
+        emit snapshotPathChanged();
+    }
+}
+
+/*!
+    \property bool ResourcesModel::sorting
+    \brief Whether the rows are being sorted in a thread.
+    
+    \sa sortItems()
+*/
+
+/*!
+    \fn void ResourcesModel::sortingChanged()
+    \brief Emitted when sorting changes.
+*/
+bool ResourcesModel::isSorting() const {
+    Q_D(const ResourcesModel);
+    
+    return d->sorting;
 }
 
 /*!
@@ -267,7 +572,40 @@ QString ResourcesModel::errorString() const {
 void ResourcesModel::setNetworkAccessManager(QNetworkAccessManager *manager) {
     Q_D(ResourcesModel);
     
+    d->manager = manager;
     d->request->setNetworkAccessManager(manager);
+    
+    if (d->pages) {
+        d->pages->setNetworkAccessManager(manager);
+    }
+}
+
+/*!
+    \brief Re-implemented from Model::data()
+    
+    In windowed mode, requesting the data of a placeholder row fetches its page again.
+*/
+QVariant ResourcesModel::data(const QModelIndex &index, int role) const {
+    Q_D(const ResourcesModel);
+    
+    if (d->snapshot.isOpen()) {
+        return d->snapshot.value(index.row(), QString::fromUtf8(d->roles.value(role)));
+    }
+    
+    d->touch(index.row());
+    
+    return Model::data(index, role);
+}
+
+/*!
+    \brief Re-implemented from Model::itemData()
+*/
+QMap<int, QVariant> ResourcesModel::itemData(const QModelIndex &index) const {
+    Q_D(const ResourcesModel);
+    
+    d->touch(index.row());
+    
+    return Model::itemData(index);
 }
 
 bool ResourcesModel::canFetchMore(const QModelIndex &) const {
@@ -277,6 +615,10 @@ bool ResourcesModel::canFetchMore(const QModelIndex &) const {
     
     Q_D(const ResourcesModel);
     
+    if (d->mirrorActive) {
+        return (d->mirrorMore) && (d->mirror);
+    }
+    
     return !d->next.isEmpty();
 }
 
@@ -284,11 +626,105 @@ void ResourcesModel::fetchMore(const QModelIndex &) {
     if (canFetchMore()) {
         Q_D(ResourcesModel);
         
-        d->request->get(d->next);
+        if (d->mirrorActive) {
+            d->loadFromMirror();
+            return;
+        }
+        
+        d->pagesActive = false;
+        d->sendRequest(d->next);
         emit statusChanged(d->request->status());
     }
 }
 
+/*!
+    \brief Fetches the next \a count pages of resources in parallel, appending them in order.
+    
+    Pages start at the current row count, using the "limit" filter as the page size. They are downloaded 
+    concurrently and parsed in a thread pool, and each page is appended to the model as soon as it and every 
+    page before it are ready.
+    
+    \sa PagesRequest
+*/
+void ResourcesModel::fetchPages(int count) {
+    if ((count <= 0) || (status() == ResourcesRequest::Loading)) {
+        return;
+    }
+    
+    Q_D(ResourcesModel);
+    
+    if (d->mirrorActive) {
+        while ((count-- > 0) && (canFetchMore())) {
+            d->loadFromMirror();
+        }
+        
+        return;
+    }
+    
+    d->pagesActive = true;
+    d->pagesRequest()->get(d->resource.startsWith('/') ? d->resource : "/" + d->resource, d->filters,
+                           d->items.size(), count);
+    emit statusChanged(status());
+}
+
+/*!
+    \brief Saves the rows of the model to the file at snapshotPath.
+    
+    This is done automatically when a load completes, but can be called to save a partial load, for example when 
+    the application exits. Returns false if there are no rows to save, the rows are already those of the 
+    snapshot, or some pages have been evicted in windowed mode.
+*/
+bool ResourcesModel::saveSnapshot() {
+    Q_D(ResourcesModel);
+    
+    if ((d->snapshotPath.isEmpty()) || (d->snapshot.isOpen()) || (d->items.isEmpty())
+        || (d->residentPages.size() != d->pageTable.size())) {
+        return false;
+    }
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::ResourcesModel::saveSnapshot" << d->snapshotPath << d->items.size();
+#endif
+    return ModelSnapshot::write(d->snapshotPath, d->items);
+}
+
+/*!
+    \brief Sorts the rows by \a property in \a order, without requesting them again.
+    
+    Numbers and dates, including ISO 8601 date strings such as lastPlayed, are sorted by value, and other 
+    properties are sorted as text using the collation of the current locale. Rows without the property are 
+    placed last, and rows with equal values keep their relative order.
+    
+    Large models are sorted in a thread, and the new order is applied with layoutChanged() when sorting is 
+    complete. Sorting again, or reloading, discards a sort that is in progress.
+    
+    Returns false if the model is not fully loaded, since the order of rows that have not been fetched is not 
+    known. Use the "sort" filter in that case.
+*/
+bool ResourcesModel::sortItems(const QString &property, Qt::SortOrder order) {
+    Q_D(ResourcesModel);
+    
+    if ((property.isEmpty()) || (d->snapshot.isOpen()) || (status() == ResourcesRequest::Loading)
+        || (canFetchMore()) || (d->residentPages.size() != d->pageTable.size())) {
+        return false;
+    }
+    
+    d->sortGeneration++;
+    
+    if (d->items.size() < THREADED_SORT_ROWS) {
+        d->applySort(RowSorter::sort(d->items, property, order));
+        d->setSorting(false);
+        return true;
+    }
+    
+    qRegisterMetaType< QVector<int> >("QVector<int>");
+    RowSorter *sorter = new RowSorter(d->sortGeneration, d->items, property, order);
+    connect(sorter, SIGNAL(finished(int, QVector<int>)), this, SLOT(_q_onSorted(int, QVector<int>)),
+            Qt::QueuedConnection);
+    RowSorter::start(sorter);
+    d->setSorting(true);
+    return true;
+}
+
 /*!
     \brief Cancels the current request.
     
@@ -300,69 +736,691 @@ void ResourcesModel::cancel() {
     if (d->request) {
         d->request->cancel();
     }
+    
+    if (d->pages) {
+        d->pages->cancel();
+    }
 }
 
 /*!
     \brief Clears any existing data and retreives a new list of cuteRadio resources using the existing properties.
+    
+    If a request is in progress, it is canceled and its result is discarded.
 */
 void ResourcesModel::reload() {
-    if (status() != ResourcesRequest::Loading) {
-        Q_D(ResourcesModel);
-        d->next = QString();
-        d->previous = QString();
+    Q_D(ResourcesModel);
+    
+    d->filterTimer->stop();
+    d->mirrorActive = false;
+    d->sortGeneration++;
+    d->setSorting(false);
+    
+    if (status() == ResourcesRequest::Loading) {
+        // The reload is started once the canceled request has finished, even if it finishes immediately.
+        d->reloadPending = true;
+        d->supersede();
+        return;
+    }
+    
+    d->reloadPending = false;
+    d->pagesActive = false;
+    d->next = QString();
+    d->previous = QString();
+    d->loadingPage = -1;
+    
+    // The snapshot rows are shown until the first page is received, so they keep their roles.
+    if (!d->snapshot.isOpen()) {
         clear();
         
         if (d->dynamicRoles) {
             d->roles.clear();
         }
-        
-        d->request->get(d->resource.startsWith('/') ? d->resource : "/" + d->resource, d->filters);
-        emit statusChanged(d->request->status());
     }
+    
+    if (d->isPlayedStations()) {
+        connect(PlayedStationsStore::instance(), SIGNAL(playRecorded(QVariantMap)),
+                this, SLOT(_q_onPlayRecorded(QVariantMap)), Qt::UniqueConnection);
+    }
+    
+    if ((d->mirror) && (d->mirror->canQuery(d->resource))) {
+        d->mirrorActive = true;
+        d->mirrorOffset = 0;
+        d->loadFromMirror();
+        emit statusChanged(ResourcesRequest::Ready);
+        return;
+    }
+    
+    d->sendRequest();
+    emit statusChanged(d->request->status());
 }
 
 ResourcesModelPrivate::ResourcesModelPrivate(ResourcesModel *parent) :
     ModelPrivate(parent),
     request(0),
+    pages(0),
+    manager(0),
     resource("stations"),
-    dynamicRoles(true)
+    filterTimer(0),
+    dynamicRoles(true),
+    pagesActive(false),
+    superseded(false),
+    reloadPending(false),
+    retention(ResourcesModel::RetainResult),
+    windowPages(0),
+    loadingPage(-1),
+    currentPage(0),
+    loadQueued(false),
+    mirrorOffset(0),
+    mirrorMore(false),
+    mirrorActive(false),
+    probeSources(false),
+    prefetchPlaylists(false),
+    sortGeneration(0),
+    sorting(false)
 {
 }
     
-void ResourcesModelPrivate::_q_onRequestFinished() {
-    if (!request) {
+PagesRequest* ResourcesModelPrivate::pagesRequest() {
+    if (!pages) {
+        Q_Q(ResourcesModel);
+        pages = new PagesRequest(q);
+        pages->setAccessToken(request->accessToken());
+        pages->setEngineMode(request->engineMode());
+        pages->setHeaders(request->headers());
+        
+        if (manager) {
+            pages->setNetworkAccessManager(manager);
+        }
+        
+        ResourcesModel::connect(pages, SIGNAL(pageReady(int, QVariant)), q, SLOT(_q_onPageReady(int, QVariant)));
+        ResourcesModel::connect(pages, SIGNAL(finished(CuteRadio::PagesRequest*)), q, SLOT(_q_onPagesFinished()));
+    }
+    
+    return pages;
+}
+
+/*!
+    \internal
+    \brief Appends the items of \a result as a new page.
+    
+    If \a batch holds a RowBatch built from the same items in the RequestEngine thread, its rows are inserted 
+    as they are.
+*/
+void ResourcesModelPrivate::appendPage(const QVariantMap &result, const QVariant &batch) {
+    if (result.isEmpty()) {
         return;
     }
+    
+    Q_Q(ResourcesModel);
+    
+    closeSnapshot();
+    
+    if (items.isEmpty()) {
+        pageTable.clear();
+        residentPages.clear();
+        currentPage = 0;
+    }
+    
+    const QString link = next;
+    next = result.value("next").toString();
+    previous = result.value("previous").toString();
+    
+    QVariantList list = result.value("items").toList();
+    bool merged = false;
+    
+    // Plays that have not yet been uploaded are shown before the first page of played stations.
+    if ((items.isEmpty()) && (windowPages == 0) && (isPlayedStations())) {
+        if (const PlayedStationsStore *journal = PlayedStationsStore::existingInstance()) {
+            list = journal->merge(list);
+            merged = true;
+        }
+    }
+    
+    if (!list.isEmpty()) {
+        ResourcesPage page;
+        page.first = items.size();
+        page.count = list.size();
+        page.link = link;
+        page.resident = true;
+        
+        if (roles.isEmpty()) {
+            setRoleNames(list.first().toMap());
+        }
+        
+        const QList<QVariantMap> rows = buildRows(list, merged ? QVariant() : batch);
+        q->beginInsertRows(QModelIndex(), items.size(), items.size() + rows.size() - 1);
+        items += rows;
+        q->endInsertRows();
+        rowsChanged();
+        emit q->countChanged(q->rowCount());
+        
+        residentPages << pageTable.size();
+        pageTable << page;
+        evictPages();
+    }
+}
 
+void ResourcesModelPrivate::fillPage(int index, const QVariantMap &result, const QVariant &batch) {
+    if ((index < 0) || (index >= pageTable.size()) || (pageTable.at(index).resident)
+        || (pageTable.at(index).first + pageTable.at(index).count > items.size())) {
+        return;
+    }
+    
     Q_Q(ResourcesModel);
+    
+    ResourcesPage &page = pageTable[index];
+    const QList<QVariantMap> rows = buildRows(result.value("items").toList(), batch);
+    const int count = qMin(rows.size(), page.count);
+    
+    for (int i = 0; i < count; i++) {
+        items[page.first + i] = rows.at(i);
+    }
+    
+    // The page is marked resident even if the server returned fewer items, so it is not requested repeatedly.
+    page.resident = true;
+    residentPages << index;
+    emit q->dataChanged(q->index(page.first), q->index(page.first + page.count - 1));
+    evictPages();
+}
 
-    if (request->status() == ResourcesRequest::Ready) {
-        const QVariantMap result = request->result().toMap();
+/*!
+    \internal
+    \brief Returns the rows of \a list with their values interned.
+    
+    The rows of \a batch are returned instead if it holds a RowBatch built from \a list, and its dictionaries 
+    can replace the model's.
+*/
+QList<QVariantMap> ResourcesModelPrivate::buildRows(const QVariantList &list, const QVariant &batch) {
+    if (batch.canConvert<RowBatch>()) {
+        const RowBatch b = batch.value<RowBatch>();
+        
+        if ((b.rows.size() == list.size()) && (adoptDictionaries(b.dictionaries))) {
+            return b.rows;
+        }
+    }
+    
+    QList<QVariantMap> rows;
+    rows.reserve(list.size());
     
-        if (!result.isEmpty()) {
-            next = result.value("next").toString();
-            previous = result.value("previous").toString();
+    foreach (const QVariant &item, list) {
+        rows << item.toMap();
         
-            const QVariantList list = result.value("items").toList();
+        if (!dictionaries.isEmpty()) {
+            internValues(rows.last());
+        }
+    }
+    
+    return rows;
+}
+
+/*!
+    \internal
+    \brief Replaces the model's dictionaries with \a other if \a other only adds values to them.
+    
+    Returns false if the dictionaries were changed or replaced after \a other was copied from them, in which 
+    case rows interned with \a other must be interned again.
+*/
+bool ResourcesModelPrivate::adoptDictionaries(const QHash<QString, ValueDictionary> &other) {
+    if (other.size() != dictionaries.size()) {
+        return false;
+    }
+    
+    QHash<QString, ValueDictionary>::const_iterator dictionary = dictionaries.constBegin();
+    
+    while (dictionary != dictionaries.constEnd()) {
+        QHash<QString, ValueDictionary>::const_iterator o = other.constFind(dictionary.key());
+        
+        if (o == other.constEnd()) {
+            return false;
+        }
+        
+        const QStringList &values = dictionary.value().values;
+        
+        if ((o.value().values.size() < values.size()) || (o.value().values.mid(0, values.size()) != values)) {
+            return false;
+        }
+        
+        ++dictionary;
+    }
+    
+    dictionaries = other;
+    return true;
+}
+
+void ResourcesModelPrivate::loadPage(int index) {
+    Q_Q(ResourcesModel);
+    
+    if (mirrorActive) {
+        if (mirror) {
+            const ResourcesPage &page = pageTable.at(index);
+            QVariantMap f = filters;
+            f["offset"] = filters.value("offset").toInt() + page.first;
+            f["limit"] = page.count;
+            fillPage(index, mirror->query(resource, f));
+        }
+        
+        return;
+    }
+    
+    const QString link = pageTable.at(index).link;
+    loadingPage = index;
+    pagesActive = false;
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::ResourcesModelPrivate::loadPage" << index << link;
+#endif
+    sendRequest(link);
+    emit q->statusChanged(request->status());
+}
+
+/*!
+    \internal
+    \brief Requests the resource with the current filters, or \a link if it is not empty.
+*/
+void ResourcesModelPrivate::sendRequest(const QString &link) {
+    requestResource = resource;
+    requestFilters = filters;
+    
+    if (link.isEmpty()) {
+        request->get(resource.startsWith('/') ? resource : "/" + resource, filters);
+    }
+    else {
+        request->get(link);
+    }
+}
+
+void ResourcesModelPrivate::evictPages() {
+    if (windowPages <= 0) {
+        return;
+    }
+    
+    Q_Q(ResourcesModel);
+    
+    while (residentPages.size() > windowPages) {
+        int furthest = 0;
+        int distance = -1;
         
-            if (!list.isEmpty()) {
-                if (roles.isEmpty()) {
-                    setRoleNames(list.first().toMap());
-                }
-                
-                q->beginInsertRows(QModelIndex(), items.size(), items.size() + list.size() - 1);
-                
-                foreach (const QVariant &item, list) {
-                    items << item.toMap();
-                }
-                
-                q->endInsertRows();
-                emit q->countChanged(q->rowCount());
+        for (int i = 0; i < residentPages.size(); i++) {
+            const int d = qAbs(residentPages.at(i) - currentPage);
+            
+            if (d > distance) {
+                furthest = i;
+                distance = d;
             }
         }
+        
+        ResourcesPage &page = pageTable[residentPages.takeAt(furthest)];
+        page.resident = false;
+        
+        for (int row = page.first; row < page.first + page.count; row++) {
+            items[row] = QVariantMap();
+        }
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::ResourcesModelPrivate::evictPages: Evicted rows" << page.first << "to"
+                 << page.first + page.count - 1;
+#endif
+        emit q->dataChanged(q->index(page.first), q->index(page.first + page.count - 1));
+    }
+}
+
+/*!
+    \internal
+    \brief Cancels the request in progress, if any, so that its result is discarded when it finishes.
+    
+    In Request::WorkerThreadEngine mode, the request may still finish normally before it is aborted.
+*/
+void ResourcesModelPrivate::supersede() {
+    Q_Q(ResourcesModel);
+    
+    if (q->status() == ResourcesRequest::Loading) {
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::ResourcesModelPrivate::supersede: Canceling request";
+#endif
+        superseded = true;
+        q->cancel();
+    }
+}
+
+/*!
+    \internal
+    \brief Appends the next page of resources from the mirror.
+*/
+void ResourcesModelPrivate::loadFromMirror() {
+    if (!mirror) {
+        mirrorMore = false;
+        return;
+    }
+    
+    QVariantMap f = filters;
+    f["offset"] = filters.value("offset").toInt() + mirrorOffset;
+    const QVariantMap result = mirror->query(resource, f);
+    mirrorOffset += result.value("items").toList().size();
+    mirrorMore = result.value("more").toBool();
+    appendPage(result);
+}
+
+/*!
+    \internal
+    \brief Shows the rows of the snapshot at snapshotPath if the model is empty.
+*/
+void ResourcesModelPrivate::openSnapshot() {
+    if ((snapshotPath.isEmpty()) || (!items.isEmpty()) || (snapshot.isOpen())) {
+        return;
+    }
+    
+    Q_Q(ResourcesModel);
+    
+    q->beginResetModel();
+    
+    if (snapshot.open(snapshotPath)) {
+        if ((dynamicRoles) && (snapshot.rowCount() > 0)) {
+            setRoleNames(snapshot.row(0));
+        }
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::ResourcesModelPrivate::openSnapshot" << snapshotPath << snapshot.rowCount();
+#endif
+    }
+    
+    q->endResetModel();
+    emit q->countChanged(q->rowCount());
+}
+
+/*!
+    \internal
+    \brief Removes the rows of the snapshot from the model.
+*/
+void ResourcesModelPrivate::closeSnapshot() {
+    if (!snapshot.isOpen()) {
+        return;
+    }
+    
+    Q_Q(ResourcesModel);
+    
+    q->beginResetModel();
+    snapshot.close();
+    q->endResetModel();
+    emit q->countChanged(q->rowCount());
+}
+
+/*!
+    \internal
+    \brief Reorders the rows so that row i is the row that was at \a permutation[i].
+    
+    Persistent indexes are moved with their rows. Pages no longer describe the rows once they are reordered, 
+    so the page table is cleared.
+*/
+void ResourcesModelPrivate::applySort(const QVector<int> &permutation) {
+    if (permutation.size() != items.size()) {
+        return;
+    }
+    
+    Q_Q(ResourcesModel);
+    
+    emit q->layoutAboutToBeChanged();
+    
+    QList<QVariantMap> sorted;
+    sorted.reserve(items.size());
+    QVector<int> rows(permutation.size());
+    
+    for (int i = 0; i < permutation.size(); i++) {
+        sorted << items.at(permutation.at(i));
+        rows[permutation.at(i)] = i;
+    }
+    
+    items = sorted;
+    pageTable.clear();
+    residentPages.clear();
+    
+    const QModelIndexList from = q->persistentIndexList();
+    QModelIndexList to;
+    
+    foreach (const QModelIndex &index, from) {
+        to << q->index(rows.at(index.row()), index.column());
+    }
+    
+    q->changePersistentIndexList(from, to);
+    emit q->layoutChanged();
+}
+
+void ResourcesModelPrivate::setSorting(bool s) {
+    if (s != sorting) {
+        Q_Q(ResourcesModel);
+        sorting = s;
+        emit q->sortingChanged();
+    }
+}
+
+bool ResourcesModelPrivate::isPlayedStations() const {
+    return (resource == "playedstations") || (resource == "/playedstations");
+}
+
+int ResourcesModelPrivate::pageAt(int row) const {
+    int low = 0;
+    int high = pageTable.size() - 1;
+    
+    while (low <= high) {
+        const int middle = (low + high) / 2;
+        const ResourcesPage &page = pageTable.at(middle);
+        
+        if (row < page.first) {
+            high = middle - 1;
+        }
+        else if (row >= page.first + page.count) {
+            low = middle + 1;
+        }
+        else {
+            return middle;
+        }
+    }
+    
+    return -1;
+}
+
+void ResourcesModelPrivate::touch(int row) const {
+    if (residentPages.size() == pageTable.size()) {
+        return;
+    }
+    
+    const int index = pageAt(row);
+    
+    if (index == -1) {
+        return;
+    }
+    
+    currentPage = index;
+    
+    if ((!pageTable.at(index).resident) && (!loadQueued)) {
+        loadQueued = true;
+        QMetaObject::invokeMethod(q_ptr, "_q_loadCurrentPage", Qt::QueuedConnection);
+    }
+}
+
+void ResourcesModelPrivate::_q_onRequestFinished() {
+    if (!request) {
+        return;
+    }
+
+    Q_Q(ResourcesModel);
+
+    const int page = loadingPage;
+    // A result for other filters than the current ones is stale, even if the request was not canceled in time.
+    const bool discard = (superseded) || (requestResource != resource) || (requestFilters != filters);
+    loadingPage = -1;
+    superseded = false;
+
+    RequestPrivate *r = RequestPrivate::get(request);
+    const QVariant batch = r->rowBatch;
+    r->rowBatch = QVariant();
+
+    if ((!discard) && (request->status() == ResourcesRequest::Ready)) {
+        if (page == -1) {
+            appendPage(request->result().toMap(), batch);
+        }
+        else {
+            fillPage(page, request->result().toMap(), batch);
+        }
+        
+        if (retention == ResourcesModel::DiscardIngestedResult) {
+            request->clearResult();
+        }
+        
+        if ((page == -1) && (next.isEmpty())) {
+            q->saveSnapshot();
+        }
     }
         
     emit q->statusChanged(request->status());
+    
+    if (reloadPending) {
+        QMetaObject::invokeMethod(q, "_q_startPendingReload", Qt::QueuedConnection);
+    }
+    else if ((!discard) && (request->status() == ResourcesRequest::Ready)) {
+        _q_loadCurrentPage();
+    }
+}
+
+/*!
+    \internal
+    \brief Starts a reload that was requested while a request was in progress.
+    
+    This is queued, so the reload does not start from within the finished() signal of the canceled request. 
+    If reload() was called again in the meantime, there is nothing to do.
+*/
+void ResourcesModelPrivate::_q_startPendingReload() {
+    if (reloadPending) {
+        Q_Q(ResourcesModel);
+        q->reload();
+    }
+}
+
+void ResourcesModelPrivate::_q_loadCurrentPage() {
+    loadQueued = false;
+    
+    if ((currentPage < 0) || (currentPage >= pageTable.size()) || (pageTable.at(currentPage).resident)) {
+        return;
+    }
+    
+    Q_Q(ResourcesModel);
+    
+    if (q->status() != ResourcesRequest::Loading) {
+        loadPage(currentPage);
+    }
+}
+
+int ResourcesModelPrivate::count() const {
+    return snapshot.isOpen() ? snapshot.rowCount() : items.size();
+}
+
+QVariantMap ResourcesModelPrivate::itemAt(int row) const {
+    return snapshot.isOpen() ? snapshot.row(row) : items.at(row);
+}
+
+/*!
+    \internal
+    \brief Discards a sort that is in progress, since its permutation no longer matches the rows.
+*/
+void ResourcesModelPrivate::rowsChanged() {
+    if (sorting) {
+        sortGeneration++;
+        setSorting(false);
+    }
+}
+
+/*!
+    \internal
+    \brief Returns true while the rows of the snapshot are shown.
+*/
+bool ResourcesModelPrivate::isReadOnly() const {
+    return snapshot.isOpen();
+}
+
+/*!
+    \internal
+    \brief Removes all items, the rows of the snapshot, and the pages that describe them.
+    
+    A page that is still being fetched no longer has rows to fill, so its result is discarded.
+*/
+void ResourcesModelPrivate::clearItems() {
+    items.clear();
+    snapshot.close();
+    pageTable.clear();
+    residentPages.clear();
+    currentPage = 0;
+    
+    if (loadingPage != -1) {
+        loadingPage = -1;
+        superseded = true;
+    }
+}
+
+qint64 ResourcesModelPrivate::retainedBytes(QSet<const void*> &seen) const {
+    return variantBytes(request->result(), seen);
+}
+
+void ResourcesModelPrivate::_q_onPageReady(int, const QVariant &result) {
+    appendPage(result.toMap());
+}
+
+/*!
+    \internal
+    \brief Moves a station that has just been played to the top of a played stations model.
+    
+    Models in windowed mode are not changed, since inserting rows would move their pages.
+*/
+void ResourcesModelPrivate::_q_onPlayRecorded(const QVariantMap &station) {
+    if ((!isPlayedStations()) || (windowPages > 0) || (items.isEmpty())) {
+        return;
+    }
+    
+    Q_Q(ResourcesModel);
+    
+    const QString id = station.value("id").toString();
+    
+    for (int i = 0; i < items.size(); i++) {
+        if (items.at(i).value("id").toString() == id) {
+            q->beginRemoveRows(QModelIndex(), i, i);
+            items.removeAt(i);
+            q->endRemoveRows();
+            rowsChanged();
+            break;
+        }
+    }
+    
+    q->beginInsertRows(QModelIndex(), 0, 0);
+    items.prepend(station);
+    
+    if (!dictionaries.isEmpty()) {
+        internValues(items.first());
+    }
+    
+    q->endInsertRows();
+    rowsChanged();
+    emit q->countChanged(q->rowCount());
+}
+
+void ResourcesModelPrivate::_q_onSorted(int generation, const QVector<int> &permutation) {
+    if (generation == sortGeneration) {
+        applySort(permutation);
+        setSorting(false);
+    }
+}
+
+void ResourcesModelPrivate::_q_onPagesFinished() {
+    Q_Q(ResourcesModel);
+    
+    superseded = false;
+    
+    if ((pages->status() == ResourcesRequest::Ready) && (next.isEmpty())) {
+        q->saveSnapshot();
+    }
+    
+    emit q->statusChanged(q->status());
+    
+    if (reloadPending) {
+        QMetaObject::invokeMethod(q, "_q_startPendingReload", Qt::QueuedConnection);
+    }
+    else {
+        _q_loadCurrentPage();
+    }
 }
 
 }
@@ -22,6 +22,7 @@
 
 namespace CuteRadio {
 
+class CatalogMirror;
 class ResourcesModelPrivate;
 
 class CUTERADIOSHARED_EXPORT ResourcesModel : public Model
@@ -30,25 +31,47 @@ class CUTERADIOSHARED_EXPORT ResourcesModel : public Model
     
     Q_PROPERTY(bool canFetchMore READ canFetchMore NOTIFY statusChanged)
     Q_PROPERTY(QString accessToken READ accessToken WRITE setAccessToken NOTIFY accessTokenChanged)
+    Q_PROPERTY(CuteRadio::Request::EngineMode engineMode READ engineMode WRITE setEngineMode
+               NOTIFY engineModeChanged)
     Q_PROPERTY(QString resource READ resource WRITE setResource NOTIFY resourceChanged)
     Q_PROPERTY(QVariantMap filters READ filters WRITE setFilters RESET resetFilters NOTIFY filtersChanged)
+    Q_PROPERTY(int filterDelay READ filterDelay WRITE setFilterDelay NOTIFY filterDelayChanged)
     Q_PROPERTY(CuteRadio::ResourcesRequest::Status status READ status NOTIFY statusChanged)
     Q_PROPERTY(QVariant result READ result NOTIFY statusChanged)
     Q_PROPERTY(CuteRadio::ResourcesRequest::Error error READ error NOTIFY statusChanged)
     Q_PROPERTY(QString errorString READ errorString NOTIFY statusChanged)
+    Q_PROPERTY(ResultRetention resultRetention READ resultRetention WRITE setResultRetention
+               NOTIFY resultRetentionChanged)
+    Q_PROPERTY(int windowPages READ windowPages WRITE setWindowPages NOTIFY windowPagesChanged)
+    Q_PROPERTY(CuteRadio::CatalogMirror* mirror READ mirror WRITE setMirror NOTIFY mirrorChanged)
+    Q_PROPERTY(QString snapshotPath READ snapshotPath WRITE setSnapshotPath NOTIFY snapshotPathChanged)
+    Q_PROPERTY(bool sorting READ isSorting NOTIFY sortingChanged)
+    
+    Q_ENUMS(ResultRetention)
+    
+public:
+    enum ResultRetention {
+        RetainResult = 0,
+        DiscardIngestedResult
+    };
     
-public: 
     explicit ResourcesModel(QObject *parent = 0);
 
     QString accessToken() const;
     void setAccessToken(const QString &token);
     
+    Request::EngineMode engineMode() const;
+    void setEngineMode(Request::EngineMode mode);
+    
     QString resource() const;
     void setResource(const QString &name);
     
     QVariantMap filters() const;
     void setFilters(const QVariantMap &map);
     void resetFilters();
+    
+    int filterDelay() const;
+    void setFilterDelay(int delay);
 
     ResourcesRequest::Status status() const;
     
@@ -57,25 +80,61 @@ public:
     ResourcesRequest::Error error() const;
     QString errorString() const;
     
+    ResultRetention resultRetention() const;
+    void setResultRetention(ResultRetention retention);
+    
+    int windowPages() const;
+    void setWindowPages(int pages);
+    
+    CatalogMirror* mirror() const;
+    void setMirror(CatalogMirror *mirror);
+    
+    QString snapshotPath() const;
+    void setSnapshotPath(const QString &path);
+    
+    bool isSorting() const;
+    
     void setNetworkAccessManager(QNetworkAccessManager *manager);
     
+    QVariant data(const QModelIndex &index, int role) const;
+    QMap<int, QVariant> itemData(const QModelIndex &index) const;
+    
     bool canFetchMore(const QModelIndex &parent = QModelIndex()) const;
     Q_INVOKABLE void fetchMore(const QModelIndex &parent = QModelIndex());
     
+    Q_INVOKABLE void fetchPages(int count);
+    
+    Q_INVOKABLE bool saveSnapshot();
+    
+    Q_INVOKABLE bool sortItems(const QString &property, Qt::SortOrder order = Qt::AscendingOrder);
+    
 public Q_SLOTS:
     void cancel();
     void reload();
     
 Q_SIGNALS:
     void accessTokenChanged();
+    void engineModeChanged();
     void resourceChanged();
     void filtersChanged();
+    void filterDelayChanged();
     void statusChanged(CuteRadio::ResourcesRequest::Status s);
+    void resultRetentionChanged();
+    void windowPagesChanged();
+    void mirrorChanged();
+    void snapshotPathChanged();
+    void sortingChanged();
     
 protected:        
     Q_DECLARE_PRIVATE(ResourcesModel)
     
     Q_PRIVATE_SLOT(d_func(), void _q_onRequestFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_onPageReady(int, QVariant))
+    Q_PRIVATE_SLOT(d_func(), void _q_onPagesFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_loadCurrentPage())
+    Q_PRIVATE_SLOT(d_func(), void _q_startPendingReload())
+    Q_PRIVATE_SLOT(d_func(), void _q_onPlayRecorded(QVariantMap))
+    Q_PRIVATE_SLOT(d_func(), void _q_onSorted(int, QVector<int>))
 
 private:
     Q_DISABLE_COPY(ResourcesModel)
@@ -16,27 +16,128 @@
 
 #include "resourcesmodel.h"
 #include "model_p.h"
+#include "catalogmirror.h"
+#include "modelsnapshot_p.h"
+#include "pagesrequest.h"
+#include <QPointer>
+#include <QTimer>
 
 namespace CuteRadio {
 
+/*!
+    \internal
+    \brief A page of rows in a ResourcesModel.
+    
+    The link is the next link returned with the page before it, or empty for the first page, which is 
+    requested using the model's resource and filters.
+*/
+class ResourcesPage
+{
+
+public:
+    int first;
+    int count;
+    QString link;
+    bool resident;
+};
+
 class ResourcesModelPrivate : public ModelPrivate
 {
 
 public:
     ResourcesModelPrivate(ResourcesModel *parent);
     
+    PagesRequest* pagesRequest();
+    
+    void appendPage(const QVariantMap &result, const QVariant &batch = QVariant());
+    void fillPage(int index, const QVariantMap &result, const QVariant &batch = QVariant());
+    
+    QList<QVariantMap> buildRows(const QVariantList &list, const QVariant &batch);
+    bool adoptDictionaries(const QHash<QString, ValueDictionary> &other);
+    void loadPage(int index);
+    void sendRequest(const QString &link = QString());
+    void evictPages();
+    
+    void supersede();
+    
+    void loadFromMirror();
+    
+    void openSnapshot();
+    void closeSnapshot();
+    
+    void applySort(const QVector<int> &permutation);
+    void setSorting(bool s);
+    
+    bool isPlayedStations() const;
+    
+    int pageAt(int row) const;
+    void touch(int row) const;
+    
+    int count() const;
+    QVariantMap itemAt(int row) const;
+    
+    bool isReadOnly() const;
+    void clearItems();
+    void rowsChanged();
+    
+    qint64 retainedBytes(QSet<const void*> &seen) const;
+    
     void _q_onRequestFinished();
+    void _q_onPageReady(int page, const QVariant &result);
+    void _q_onPagesFinished();
+    void _q_loadCurrentPage();
+    void _q_startPendingReload();
+    void _q_onPlayRecorded(const QVariantMap &station);
+    void _q_onSorted(int generation, const QVector<int> &permutation);
     
     ResourcesRequest *request;
     
+    PagesRequest *pages;
+    
+    QNetworkAccessManager *manager;
+    
     QString resource;
     QVariantMap filters;
+    
+    // The resource and filters of the request in progress, so a result for other filters can be discarded.
+    QString requestResource;
+    QVariantMap requestFilters;
+    
+    QTimer *filterTimer;
         
     QString next;
     QString previous;
     
     bool dynamicRoles;
     
+    bool pagesActive;
+    
+    bool superseded;
+    bool reloadPending;
+    
+    ResourcesModel::ResultRetention retention;
+    
+    QList<ResourcesPage> pageTable;
+    QList<int> residentPages;
+    int windowPages;
+    int loadingPage;
+    mutable int currentPage;
+    mutable bool loadQueued;
+    
+    QPointer<CatalogMirror> mirror;
+    int mirrorOffset;
+    bool mirrorMore;
+    bool mirrorActive;
+    
+    ModelSnapshot snapshot;
+    QString snapshotPath;
+    
+    bool probeSources;
+    bool prefetchPlaylists;
+    
+    int sortGeneration;
+    bool sorting;
+    
     Q_DECLARE_PUBLIC(ResourcesModel)
 };
 
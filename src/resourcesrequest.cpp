@@ -109,8 +109,8 @@ void ResourcesRequest::get(const QString &resourcePath, const QVariantMap &filte
         return;
     }
     
-    QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
-                            .arg(resourcePath));
+    Q_D(Request);
+    QUrl u = d->resourceUrl(resourcePath);
 #if QT_VERSION >= 0x050000
     if (!filters.isEmpty()) {
         QUrlQuery query(u);
@@ -145,9 +145,9 @@ void ResourcesRequest::insert(const QVariantMap &resource, const QString &resour
         return;
     }
     
-    QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
-                            .arg(resourcePath));
-    QString body;
+    Q_D(Request);
+    const QUrl u = d->resourceUrl(resourcePath);
+    QByteArray body;
     addPostBody(&body, resource);
     setUrl(u);
     setData(body);
@@ -173,9 +173,9 @@ void ResourcesRequest::update(const QString &resourcePath, const QVariantMap &re
         return;
     }
     
-    QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
-                            .arg(resourcePath));
-    QString body;
+    Q_D(Request);
+    const QUrl u = d->resourceUrl(resourcePath);
+    QByteArray body;
     addPostBody(&body, resource);
     setUrl(u);
     setData(body);
@@ -198,8 +198,8 @@ void ResourcesRequest::del(const QString &resourcePath) {
         return;
     }
     
-    QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
-                            .arg(resourcePath));
+    Q_D(Request);
+    const QUrl u = d->resourceUrl(resourcePath);
     setUrl(u);
     setData(QVariant());
     deleteResource();
@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rowsorter_p.h"
+#include <QDateTime>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#if QT_VERSION >= 0x050200
+#include <QCollator>
+#include <vector>
+#endif
+#include <algorithm>
+#ifdef CUTERADIO_DEBUG
+#include <QDebug>
+#include <QElapsedTimer>
+#endif
+
+namespace CuteRadio {
+
+// Rows are sorted in parallel chunks when there are at least this many.
+static const int PARALLEL_SORT_ROWS = 8192;
+// The smallest chunk sorted by one thread.
+static const int MIN_CHUNK_ROWS = 2048;
+
+// Sorters wait for their chunks, which run in the global pool, so they have a pool of their own.
+Q_GLOBAL_STATIC(QThreadPool, rowSorterPool)
+
+/*!
+    \internal
+    \brief The sort key of each row, computed once before sorting.
+    
+    Numbers, booleans and dates (including ISO 8601 date strings) are compared as numbers. Other values are 
+    compared as text, using collation keys for the current locale where QCollator is available.
+*/
+class RowKeys
+{
+
+public:
+    RowKeys(const QList<QVariantMap> &items, const QString &property);
+    
+    int compare(int a, int b) const {
+        if (numeric) {
+            return numbers.at(a) < numbers.at(b) ? -1 : numbers.at(a) > numbers.at(b) ? 1 : 0;
+        }
+#if QT_VERSION >= 0x050200
+        return texts[a].compare(texts[b]);
+#else
+        return texts.at(a).compare(texts.at(b));
+#endif
+    }
+    
+    bool numeric;
+    QVector<char> missing;
+    QVector<double> numbers;
+#if QT_VERSION >= 0x050200
+    std::vector<QCollatorSortKey> texts;
+#else
+    QVector<QString> texts;
+#endif
+};
+
+RowKeys::RowKeys(const QList<QVariantMap> &items, const QString &property) :
+    numeric(false),
+    missing(items.size(), 0)
+{
+    bool dates = false;
+    
+    foreach (const QVariantMap &item, items) {
+        const QVariant value = item.value(property);
+        
+        if (!value.isNull()) {
+            switch (value.type()) {
+            case QVariant::String:
+                dates = QDateTime::fromString(value.toString(), Qt::ISODate).isValid();
+                numeric = dates;
+                break;
+            case QVariant::Date:
+            case QVariant::DateTime:
+                dates = true;
+                numeric = true;
+                break;
+            default:
+                numeric = value.canConvert(QVariant::Double);
+                break;
+            }
+            
+            break;
+        }
+    }
+    
+    if (numeric) {
+        numbers.resize(items.size());
+    }
+#if QT_VERSION >= 0x050200
+    QCollator collator;
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+    collator.setNumericMode(true);
+    
+    if (!numeric) {
+        texts.reserve(items.size());
+    }
+#else
+    if (!numeric) {
+        texts.resize(items.size());
+    }
+#endif
+    for (int i = 0; i < items.size(); i++) {
+        const QVariant value = items.at(i).value(property);
+        missing[i] = value.isNull();
+        
+        if (numeric) {
+            if (dates) {
+                const QDateTime dt = value.type() == QVariant::String
+                                     ? QDateTime::fromString(value.toString(), Qt::ISODate) : value.toDateTime();
+                missing[i] = !dt.isValid();
+                numbers[i] = missing[i] ? 0 : double(dt.toMSecsSinceEpoch());
+            }
+            else {
+                numbers[i] = value.toDouble();
+            }
+        }
+        else {
+#if QT_VERSION >= 0x050200
+            texts.push_back(collator.sortKey(value.toString()));
+#else
+            texts[i] = value.toString().toCaseFolded();
+#endif
+        }
+    }
+}
+
+/*!
+    \internal
+    \brief Orders row numbers by their keys, with missing values last and equal keys in their original order.
+*/
+class RowLessThan
+{
+
+public:
+    RowLessThan(const RowKeys &keys, Qt::SortOrder order) :
+        keys(keys),
+        descending(order == Qt::DescendingOrder)
+    {
+    }
+    
+    bool operator()(int a, int b) const {
+        const bool ma = keys.missing.at(a);
+        const bool mb = keys.missing.at(b);
+        
+        if ((ma) || (mb)) {
+            return ma == mb ? a < b : mb;
+        }
+        
+        const int c = keys.compare(a, b);
+        
+        if (c == 0) {
+            return a < b;
+        }
+        
+        return descending ? c > 0 : c < 0;
+    }
+    
+private:
+    const RowKeys &keys;
+    bool descending;
+};
+
+/*!
+    \internal
+    \brief Sorts one chunk of a permutation, or merges two adjacent sorted chunks, in the global thread pool.
+*/
+class ChunkSorter : public QRunnable
+{
+
+public:
+    ChunkSorter(int *first, int *middle, int *last, const RowLessThan &lessThan, QSemaphore *done) :
+        QRunnable(),
+        first(first),
+        middle(middle),
+        last(last),
+        lessThan(lessThan),
+        done(done)
+    {
+        setAutoDelete(true);
+    }
+    
+    void run() {
+        if (middle) {
+            std::inplace_merge(first, middle, last, lessThan);
+        }
+        else {
+            std::sort(first, last, lessThan);
+        }
+        
+        if (done) {
+            done->release();
+        }
+    }
+    
+private:
+    int *first;
+    int *middle;
+    int *last;
+    RowLessThan lessThan;
+    QSemaphore *done;
+};
+
+RowSorter::RowSorter(int generation, const QList<QVariantMap> &items, const QString &property,
+                     Qt::SortOrder order) :
+    QObject(),
+    QRunnable(),
+    generation(generation),
+    items(items),
+    property(property),
+    order(order)
+{
+    // The pool must not delete the sorter in its own thread, so it is deleted by run() with deleteLater().
+    setAutoDelete(false);
+}
+
+void RowSorter::run() {
+    const QVector<int> permutation = sort(items, property, order);
+    items.clear();
+    emit finished(generation, permutation);
+    deleteLater();
+}
+
+/*!
+    \internal
+    \brief Returns the permutation that sorts \a items by \a property in \a order.
+    
+    Large models are split into chunks that are sorted concurrently and then merged in pairs, with the merges 
+    of each round also running concurrently.
+*/
+QVector<int> RowSorter::sort(const QList<QVariantMap> &items, const QString &property, Qt::SortOrder order) {
+#ifdef CUTERADIO_DEBUG
+    QElapsedTimer timer;
+    timer.start();
+#endif
+    const int count = items.size();
+    const RowKeys keys(items, property);
+    const RowLessThan lessThan(keys, order);
+    QVector<int> permutation(count);
+    
+    for (int i = 0; i < count; i++) {
+        permutation[i] = i;
+    }
+    
+    int *rows = permutation.data();
+    const int chunks = count < PARALLEL_SORT_ROWS ? 1
+                                                  : qBound(1, QThread::idealThreadCount(), count / MIN_CHUNK_ROWS);
+    
+    if (chunks == 1) {
+        std::sort(rows, rows + count, lessThan);
+    }
+    else {
+        QVector<int> bounds;
+        
+        for (int i = 0; i <= chunks; i++) {
+            bounds << int(qint64(count) * i / chunks);
+        }
+        
+        QThreadPool *pool = QThreadPool::globalInstance();
+        QSemaphore done;
+        
+        for (int i = 1; i < chunks; i++) {
+            pool->start(new ChunkSorter(rows + bounds.at(i), 0, rows + bounds.at(i + 1), lessThan, &done));
+        }
+        
+        std::sort(rows, rows + bounds.at(1), lessThan);
+        done.acquire(chunks - 1);
+        
+        while (bounds.size() > 2) {
+            QVector<int> merged;
+            int jobs = 0;
+            
+            for (int i = 0; i + 2 < bounds.size(); i += 2) {
+                merged << bounds.at(i);
+                
+                if (i > 0) {
+                    pool->start(new ChunkSorter(rows + bounds.at(i), rows + bounds.at(i + 1), rows + bounds.at(i + 2),
+                                                lessThan, &done));
+                    jobs++;
+                }
+            }
+            
+            // An odd chunk at the end is carried into the next round unmerged.
+            if (bounds.size() % 2 == 0) {
+                merged << bounds.at(bounds.size() - 2);
+            }
+            
+            merged << bounds.last();
+            std::inplace_merge(rows, rows + bounds.at(1), rows + bounds.at(2), lessThan);
+            done.acquire(jobs);
+            bounds = merged;
+        }
+    }
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::RowSorter::sort: Sorted" << count << "rows by" << property << "in" << chunks
+             << "chunks in" << timer.elapsed() << "ms";
+#endif
+    return permutation;
+}
+
+/*!
+    \internal
+    \brief Runs \a sorter in the sorter thread pool.
+    
+    The sorter is deleted in the thread that created it once it has run.
+*/
+void RowSorter::start(RowSorter *sorter) {
+    rowSorterPool()->start(sorter);
+}
+
+}
+
+#include "moc_rowsorter_p.cpp"
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_ROWSORTER_P_H
+#define CUTERADIO_ROWSORTER_P_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QVariantMap>
+#include <QVector>
+
+namespace CuteRadio {
+
+/*!
+    \internal
+    \brief Sorts the rows of a model by one property in a QThreadPool thread.
+    
+    The result is a permutation, where the row at position i of the sorted model is row permutation[i] of the 
+    model that was sorted.
+*/
+class RowSorter : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    RowSorter(int generation, const QList<QVariantMap> &items, const QString &property, Qt::SortOrder order);
+    
+    void run();
+    
+    static QVector<int> sort(const QList<QVariantMap> &items, const QString &property, Qt::SortOrder order);
+    
+    static void start(RowSorter *sorter);
+
+Q_SIGNALS:
+    void finished(int generation, const QVector<int> &permutation);
+
+private:
+    int generation;
+    QList<QVariantMap> items;
+    QString property;
+    Qt::SortOrder order;
+};
+
+}
+
+#endif // CUTERADIO_ROWSORTER_P_H
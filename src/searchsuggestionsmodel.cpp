@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "searchsuggestionsmodel.h"
+#include "searchsuggestionsmodel_p.h"
+
+namespace CuteRadio {
+
+static const int DEFAULT_SUGGESTION_LIMIT = 10;
+static const int MAXIMUM_HISTORY = 50;
+
+/*!
+    \class SearchSuggestionsModel
+    \brief A model for suggesting completions of a search keyword.
+    
+    \ingroup models
+    
+    SearchSuggestionsModel builds a prefix trie from the keywords of a source SearchesModel, weighted by their 
+    count, and from a local history of searches. Setting the prefix property updates the model with the best 
+    completions, at most limit of them, without making any requests. An empty prefix gives the best keywords 
+    overall.
+    
+    Keywords are matched case-insensitively. Keywords in the history are always suggested before those that 
+    are only in the source model, most recent first. The history is not saved, so applications that want to keep 
+    it should store the history property and restore it at startup.
+    
+    SearchSuggestionsModel provides the following roles:
+    
+    <table>
+        <tr>
+        <th>Role</th>
+        <th>Role name</th>
+        <th>Description</th>
+        </tr>
+        <tr>
+            <td>Qt::DisplayRole/KeywordRole</td>
+            <td>keyword</td>
+            <td>The suggested keyword.</td>
+        </tr>
+        <tr>
+            <td>CountRole</td>
+            <td>count</td>
+            <td>The number of times the keyword has been used, according to the source model.</td>
+        </tr>
+        <tr>
+            <td>RecentRole</td>
+            <td>recent</td>
+            <td>Whether the keyword is in the local history.</td>
+        </tr>
+    </table>
+    
+    \sa SearchesModel
+*/
+SearchSuggestionsModel::SearchSuggestionsModel(QObject *parent) :
+    Model(*new SearchSuggestionsModelPrivate(this), parent)
+{
+    Q_D(SearchSuggestionsModel);
+    d->roles[Qt::DisplayRole] = "keyword";
+    d->roles[KeywordRole] = "keyword";
+    d->roles[CountRole] = "count";
+    d->roles[RecentRole] = "recent";
+#if QT_VERSION < 0x050000
+    setRoleNames(d->roles);
+#endif
+}
+
+/*!
+    \property SearchesModel* SearchSuggestionsModel::source
+    \brief The model from which keywords and their counts are taken.
+    
+    The suggestions are rebuilt whenever the rows of the source model change.
+*/
+SearchesModel* SearchSuggestionsModel::source() const {
+    Q_D(const SearchSuggestionsModel);
+    
+    return d->source;
+}
+
+void SearchSuggestionsModel::setSource(SearchesModel *model) {
+    Q_D(SearchSuggestionsModel);
+    
+    if (model == d->source) {
+        return;
+    }
+    
+    if (d->source) {
+        disconnect(d->source, 0, this, 0);
+    }
+    
+    d->source = model;
+    
+    if (model) {
+        connect(model, SIGNAL(rowsInserted(QModelIndex, int, int)), this, SLOT(_q_onSourceChanged()));
+        connect(model, SIGNAL(rowsRemoved(QModelIndex, int, int)), this, SLOT(_q_onSourceChanged()));
+        connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(_q_onSourceChanged()));
+        connect(model, SIGNAL(modelReset()), this, SLOT(_q_onSourceChanged()));
+        connect(model, SIGNAL(destroyed()), this, SLOT(_q_onSourceDestroyed()));
+    }
+    
+    d->rebuild();
+    d->complete();
+    emit sourceChanged();
+}
+
+/*!
+    \property QString SearchSuggestionsModel::prefix
+    \brief The text to be completed.
+*/
+QString SearchSuggestionsModel::prefix() const {
+    Q_D(const SearchSuggestionsModel);
+    
+    return d->prefix;
+}
+
+void SearchSuggestionsModel::setPrefix(const QString &prefix) {
+    Q_D(SearchSuggestionsModel);
+    
+    if (prefix != d->prefix) {
+        d->prefix = prefix;
+        d->complete();
+        emit prefixChanged();
+    }
+}
+
+/*!
+    \property int SearchSuggestionsModel::limit
+    \brief The maximum number of suggestions.
+    
+    The default value is 10.
+*/
+int SearchSuggestionsModel::limit() const {
+    Q_D(const SearchSuggestionsModel);
+    
+    return d->limit;
+}
+
+void SearchSuggestionsModel::setLimit(int limit) {
+    Q_D(SearchSuggestionsModel);
+    
+    limit = qMax(0, limit);
+    
+    if (limit != d->limit) {
+        d->limit = limit;
+        d->rebuild();
+        d->complete();
+        emit limitChanged();
+    }
+}
+
+/*!
+    \property QStringList SearchSuggestionsModel::history
+    \brief The keywords searched locally, most recent first.
+    
+    At most 50 keywords are kept.
+    
+    \sa addToHistory()
+*/
+QStringList SearchSuggestionsModel::history() const {
+    Q_D(const SearchSuggestionsModel);
+    
+    return d->history;
+}
+
+void SearchSuggestionsModel::setHistory(const QStringList &keywords) {
+    Q_D(SearchSuggestionsModel);
+    
+    if (keywords != d->history) {
+        d->history = keywords.mid(0, MAXIMUM_HISTORY);
+        d->rebuild();
+        d->complete();
+        emit historyChanged();
+    }
+}
+
+/*!
+    \brief Adds \a keyword to the start of the history, removing any earlier use of it.
+*/
+void SearchSuggestionsModel::addToHistory(const QString &keyword) {
+    const QString k = keyword.trimmed();
+    
+    if (k.isEmpty()) {
+        return;
+    }
+    
+    QStringList keywords = history();
+    
+    for (int i = keywords.size() - 1; i >= 0; i--) {
+        if (keywords.at(i).compare(k, Qt::CaseInsensitive) == 0) {
+            keywords.removeAt(i);
+        }
+    }
+    
+    keywords.prepend(k);
+    setHistory(keywords);
+}
+
+/*!
+    \brief Removes all keywords from the history.
+*/
+void SearchSuggestionsModel::clearHistory() {
+    setHistory(QStringList());
+}
+
+SearchSuggestionsModelPrivate::SearchSuggestionsModelPrivate(SearchSuggestionsModel *parent) :
+    ModelPrivate(parent),
+    limit(DEFAULT_SUGGESTION_LIMIT)
+{
+}
+
+void SearchSuggestionsModelPrivate::rebuild() {
+    QHash<QString, int> positions;
+    QStringList keys;
+    QVector<qint64> weights;
+    qint64 maximum = 0;
+    entries.clear();
+    
+    if (source) {
+        for (int row = 0; row < source->rowCount(); row++) {
+            const QVariantMap item = source->get(row);
+            const QString keyword = item.value("keyword").toString().trimmed();
+            const QString key = keyword.toLower();
+            
+            if ((!keyword.isEmpty()) && (!positions.contains(key))) {
+                QVariantMap entry;
+                entry["keyword"] = keyword;
+                entry["count"] = item.value("count");
+                entry["recent"] = false;
+                positions[key] = entries.size();
+                entries << entry;
+                keys << key;
+                weights << item.value("count").toLongLong();
+                maximum = qMax(maximum, weights.last());
+            }
+        }
+    }
+    
+    // History keywords are weighted above every source keyword, the most recent highest.
+    for (int i = 0; i < history.size(); i++) {
+        const QString keyword = history.at(i).trimmed();
+        const QString key = keyword.toLower();
+        const qint64 weight = maximum + history.size() - i;
+        const int position = positions.value(key, -1);
+        
+        if (keyword.isEmpty()) {
+            continue;
+        }
+        
+        if (position != -1) {
+            entries[position]["recent"] = true;
+            weights[position] = qMax(weights.at(position), weight);
+        }
+        else {
+            QVariantMap entry;
+            entry["keyword"] = keyword;
+            entry["count"] = 0;
+            entry["recent"] = true;
+            positions[key] = entries.size();
+            entries << entry;
+            keys << key;
+            weights << weight;
+        }
+    }
+    
+    trie.build(keys, weights, limit);
+}
+
+void SearchSuggestionsModelPrivate::complete() {
+    Q_Q(SearchSuggestionsModel);
+    
+    const QVector<int> indexes = trie.complete(prefix.toLower());
+    
+    q->beginResetModel();
+    items.clear();
+    
+    foreach (int i, indexes) {
+        items << entries.at(i);
+    }
+    
+    q->endResetModel();
+    emit q->countChanged(q->rowCount());
+}
+
+void SearchSuggestionsModelPrivate::_q_onSourceChanged() {
+    rebuild();
+    complete();
+}
+
+void SearchSuggestionsModelPrivate::_q_onSourceDestroyed() {
+    Q_Q(SearchSuggestionsModel);
+    
+    source = 0;
+    rebuild();
+    complete();
+    emit q->sourceChanged();
+}
+
+}
+
+#include "moc_searchsuggestionsmodel.cpp"
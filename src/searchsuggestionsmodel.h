@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_SEARCHSUGGESTIONSMODEL_H
+#define CUTERADIO_SEARCHSUGGESTIONSMODEL_H
+
+#include "model.h"
+
+namespace CuteRadio {
+
+class SearchesModel;
+class SearchSuggestionsModelPrivate;
+
+class CUTERADIOSHARED_EXPORT SearchSuggestionsModel : public Model
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(CuteRadio::SearchesModel* source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(QString prefix READ prefix WRITE setPrefix NOTIFY prefixChanged)
+    Q_PROPERTY(int limit READ limit WRITE setLimit NOTIFY limitChanged)
+    Q_PROPERTY(QStringList history READ history WRITE setHistory NOTIFY historyChanged)
+    
+    Q_ENUMS(Roles)
+    
+public:
+    enum Roles {
+        KeywordRole = Qt::UserRole + 1,
+        CountRole,
+        RecentRole
+    };
+    
+    explicit SearchSuggestionsModel(QObject *parent = 0);
+    
+    SearchesModel* source() const;
+    void setSource(SearchesModel *model);
+    
+    QString prefix() const;
+    void setPrefix(const QString &prefix);
+    
+    int limit() const;
+    void setLimit(int limit);
+    
+    QStringList history() const;
+    void setHistory(const QStringList &keywords);
+    
+    Q_INVOKABLE void addToHistory(const QString &keyword);
+    
+public Q_SLOTS:
+    void clearHistory();
+    
+Q_SIGNALS:
+    void sourceChanged();
+    void prefixChanged();
+    void limitChanged();
+    void historyChanged();
+    
+private:
+    Q_DECLARE_PRIVATE(SearchSuggestionsModel)
+    
+    Q_PRIVATE_SLOT(d_func(), void _q_onSourceChanged())
+    Q_PRIVATE_SLOT(d_func(), void _q_onSourceDestroyed())
+    
+    Q_DISABLE_COPY(SearchSuggestionsModel)
+};
+
+}
+
+#endif // CUTERADIO_SEARCHSUGGESTIONSMODEL_H
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_SEARCHSUGGESTIONSMODEL_P_H
+#define CUTERADIO_SEARCHSUGGESTIONSMODEL_P_H
+
+#include "searchsuggestionsmodel.h"
+#include "model_p.h"
+#include "searchesmodel.h"
+#include "searchtrie_p.h"
+#include <QPointer>
+
+namespace CuteRadio {
+
+class SearchSuggestionsModelPrivate : public ModelPrivate
+{
+
+public:
+    SearchSuggestionsModelPrivate(SearchSuggestionsModel *parent);
+    
+    void rebuild();
+    void complete();
+    
+    void _q_onSourceChanged();
+    void _q_onSourceDestroyed();
+    
+    SearchTrie trie;
+    
+    QList<QVariantMap> entries;
+    
+    QPointer<SearchesModel> source;
+    
+    QString prefix;
+    
+    int limit;
+    
+    QStringList history;
+    
+    Q_DECLARE_PUBLIC(SearchSuggestionsModel)
+};
+
+}
+
+#endif // CUTERADIO_SEARCHSUGGESTIONSMODEL_P_H
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "searchtrie_p.h"
+#include <algorithm>
+
+namespace CuteRadio {
+
+class EntryRanking
+{
+
+public:
+    explicit EntryRanking(const QVector<qint64> &w) : weights(w) {}
+    
+    bool operator()(int a, int b) const {
+        return weights.at(a) == weights.at(b) ? a < b : weights.at(a) > weights.at(b);
+    }
+    
+    const QVector<qint64> &weights;
+};
+
+SearchTrie::SearchTrie() :
+    limit(0)
+{
+    nodes.resize(1);
+}
+
+/*!
+    \internal
+    \brief Rebuilds the trie from \a keys, keeping the \a limit highest \a weights below each node.
+    
+    \a keys are matched exactly, so they should already be case folded. The index of a key in \a keys is 
+    returned by complete(), and equal weights are ranked by index.
+*/
+void SearchTrie::build(const QStringList &keys, const QVector<qint64> &w, int l) {
+    clear();
+    weights = w;
+    limit = l;
+    
+    for (int i = 0; i < keys.size(); i++) {
+        insert(keys.at(i), i);
+    }
+    
+    rank(0);
+}
+
+/*!
+    \internal
+    \brief Removes all keys.
+*/
+void SearchTrie::clear() {
+    nodes.clear();
+    nodes.resize(1);
+    weights.clear();
+}
+
+/*!
+    \internal
+    \brief Returns the indexes of the best keys that start with \a prefix, highest weight first.
+*/
+QVector<int> SearchTrie::complete(const QString &prefix) const {
+    int node = 0;
+    
+    for (int i = 0; (i < prefix.size()) && (node != -1); i++) {
+        node = child(node, prefix.at(i));
+    }
+    
+    return node == -1 ? QVector<int>() : nodes.at(node).top;
+}
+
+int SearchTrie::child(int node, QChar c) const {
+    const Node &n = nodes.at(node);
+    const int i = n.keys.indexOf(c);
+    
+    return i == -1 ? -1 : n.children.at(i);
+}
+
+void SearchTrie::insert(const QString &key, int entry) {
+    int node = 0;
+    
+    for (int i = 0; i < key.size(); i++) {
+        int next = child(node, key.at(i));
+        
+        if (next == -1) {
+            next = nodes.size();
+            nodes.append(Node());
+            nodes[node].keys.append(key.at(i));
+            nodes[node].children.append(next);
+        }
+        
+        node = next;
+    }
+    
+    if ((nodes.at(node).entry == -1) || (weights.at(entry) > weights.at(nodes.at(node).entry))) {
+        nodes[node].entry = entry;
+    }
+}
+
+void SearchTrie::rank(int node) {
+    QVector<int> candidates;
+    
+    if (nodes.at(node).entry != -1) {
+        candidates << nodes.at(node).entry;
+    }
+    
+    const QVector<int> children = nodes.at(node).children;
+    
+    foreach (int c, children) {
+        rank(c);
+        candidates << nodes.at(c).top;
+    }
+    
+    const int count = qMin(limit, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), EntryRanking(weights));
+    candidates.resize(count);
+    nodes[node].top = candidates;
+}
+
+}
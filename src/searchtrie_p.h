@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_SEARCHTRIE_P_H
+#define CUTERADIO_SEARCHTRIE_P_H
+
+#include <QStringList>
+#include <QVector>
+
+namespace CuteRadio {
+
+/*!
+    \internal
+    \brief A prefix trie of search keywords that returns the highest weighted completions of a prefix.
+    
+    Each node caches the best completions below it, so a lookup only walks the characters of the prefix.
+*/
+class SearchTrie
+{
+
+public:
+    SearchTrie();
+    
+    void build(const QStringList &keys, const QVector<qint64> &weights, int limit);
+    void clear();
+    
+    QVector<int> complete(const QString &prefix) const;
+
+private:
+    class Node
+    {
+    
+    public:
+        Node() : entry(-1) {}
+        
+        QString keys;
+        QVector<int> children;
+        QVector<int> top;
+        int entry;
+    };
+    
+    int child(int node, QChar c) const;
+    void insert(const QString &key, int entry);
+    void rank(int node);
+    
+    QVector<Node> nodes;
+    QVector<qint64> weights;
+    
+    int limit;
+};
+
+}
+
+#endif // CUTERADIO_SEARCHTRIE_P_H
@@ -3,7 +3,7 @@ TEMPLATE = lib
 #DEFINES += CUTERADIO_DEBUG
 #DEFINES += CUTERADIO_STATIC_LIBRARY
 
-QT += network
+QT += network sql
 QT -= gui
 
 TARGET = cuteradio
@@ -11,44 +11,110 @@ DESTDIR = ../lib
 
 HEADERS += \
     json.h \
+    batchwriterequest.h \
+    batchwriterequest_p.h \
+    catalogmirror.h \
+    catalogmirror_p.h \
+    circuitbreaker.h \
+    circuitbreaker_p.h \
     cuteradio_global.h \
     countriesmodel.h \
+    endpointselector.h \
+    endpointselector_p.h \
+    facetindex_p.h \
+    favourites.h \
+    favourites_p.h \
     genresmodel.h \
     languagesmodel.h \
     model.h \
     model_p.h \
+    modelsnapshot_p.h \
+    pagesrequest.h \
+    pagesrequest_p.h \
+    playedstationsjournal.h \
+    playedstationsjournal_p.h \
+    playlistresolver.h \
+    playlistresolver_p.h \
+    ratelimiter.h \
+    ratelimiter_p.h \
+    redirectcache_p.h \
     request.h \
     request_p.h \
+    requestengine_p.h \
     resourcesmodel.h \
     resourcesmodel_p.h \
     resourcesrequest.h \
+    rowsorter_p.h \
     searchesmodel.h \
+    searchsuggestionsmodel.h \
+    searchsuggestionsmodel_p.h \
+    searchtrie_p.h \
+    stationfiltermodel.h \
+    stationfiltermodel_p.h \
+    stationindex_p.h \
+    stationsearchmodel.h \
+    stationsearchmodel_p.h \
     stationsmodel.h \
+    streamprober.h \
+    streamprober_p.h \
     urls.h
 
 SOURCES += \
     json.cpp \
+    batchwriterequest.cpp \
+    catalogmirror.cpp \
+    circuitbreaker.cpp \
     countriesmodel.cpp \
+    endpointselector.cpp \
+    facetindex.cpp \
+    favourites.cpp \
     genresmodel.cpp \
     languagesmodel.cpp \
     model.cpp \
+    modelsnapshot.cpp \
+    pagesrequest.cpp \
+    playedstationsjournal.cpp \
+    playlistresolver.cpp \
+    ratelimiter.cpp \
+    redirectcache.cpp \
     request.cpp \
+    requestengine.cpp \
     resourcesmodel.cpp \
     resourcesrequest.cpp \
+    rowsorter.cpp \
     searchesmodel.cpp \
-    stationsmodel.cpp
+    searchsuggestionsmodel.cpp \
+    searchtrie.cpp \
+    stationfiltermodel.cpp \
+    stationindex.cpp \
+    stationsearchmodel.cpp \
+    stationsmodel.cpp \
+    streamprober.cpp
     
 headers.files += \
+    batchwriterequest.h \
+    catalogmirror.h \
+    circuitbreaker.h \
     cuteradio_global.h \
     countriesmodel.h \
+    endpointselector.h \
+    favourites.h \
     genresmodel.h \
     languagesmodel.h \
     model.h \
+    pagesrequest.h \
+    playedstationsjournal.h \
+    playlistresolver.h \
+    ratelimiter.h \
     request.h \
     resourcesmodel.h \
     resourcesrequest.h \
     searchesmodel.h \
+    searchsuggestionsmodel.h \
+    stationfiltermodel.h \
+    stationsearchmodel.h \
     stationsmodel.h \
+    streamprober.h \
     urls.h
     
 symbian {
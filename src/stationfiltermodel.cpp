@@ -0,0 +1,539 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stationfiltermodel.h"
+#include "stationfiltermodel_p.h"
+#include <algorithm>
+#ifdef CUTERADIO_DEBUG
+#include <QDebug>
+#endif
+
+namespace CuteRadio {
+
+/*!
+    \class StationFilterModel
+    \brief A list model that filters the stations of a StationsModel by genre, country and language.
+    
+    \ingroup models
+    
+    StationFilterModel shows the rows of its source StationsModel whose facets match the selection. The selection 
+    maps each facet to a value or a list of values. A row matches a facet if it has any of the selected values, 
+    and matchMode decides whether a row must match every selected facet, or only one of them.
+    
+    For each distinct value of each facet, the model keeps a bitmap of the rows that have it, so changing the 
+    selection only combines bitmaps, and does not read the rows again. The same bitmaps give facetCounts(), the 
+    number of matching rows for each value of a facet.
+    
+    The roles of StationFilterModel are those of its source.
+    
+    Example usage:
+    
+    \code
+    import QtQuick 1.0
+    import CuteRadio 1.0
+    
+    ListView {
+        model: StationFilterModel {
+            id: filterModel
+            
+            source: StationsModel {
+                id: stationsModel
+            }
+            selection: {"genre": ["Rock", "Metal"], "country": "UK"}
+        }
+        delegate: Text {
+            text: title
+        }
+    }
+    \endcode
+    
+    \sa StationsModel
+*/
+StationFilterModel::StationFilterModel(QObject *parent) :
+    QAbstractListModel(parent),
+    d_ptr(new StationFilterModelPrivate(this))
+{
+    Q_D(StationFilterModel);
+    
+    d->index.setFacets(QStringList() << "genre" << "country" << "language");
+}
+
+StationFilterModel::~StationFilterModel() {}
+
+/*!
+    \property StationsModel* StationFilterModel::source
+    \brief The model whose stations are filtered.
+*/
+StationsModel* StationFilterModel::source() const {
+    Q_D(const StationFilterModel);
+    
+    return d->source;
+}
+
+void StationFilterModel::setSource(StationsModel *model) {
+    Q_D(StationFilterModel);
+    
+    if (model == d->source) {
+        return;
+    }
+    
+    if (d->source) {
+        disconnect(d->source, 0, this, 0);
+    }
+    
+    d->source = model;
+    
+    if (model) {
+        connect(model, SIGNAL(rowsInserted(QModelIndex, int, int)),
+                this, SLOT(_q_onSourceRowsInserted(QModelIndex, int, int)));
+        connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)),
+                this, SLOT(_q_onSourceDataChanged(QModelIndex, QModelIndex)));
+        connect(model, SIGNAL(rowsRemoved(QModelIndex, int, int)), this, SLOT(_q_rebuild()));
+        connect(model, SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)), this, SLOT(_q_rebuild()));
+        connect(model, SIGNAL(layoutChanged()), this, SLOT(_q_rebuild()));
+        connect(model, SIGNAL(modelReset()), this, SLOT(_q_rebuild()));
+        connect(model, SIGNAL(destroyed()), this, SLOT(_q_onSourceDestroyed()));
+#if QT_VERSION < 0x050000
+        setRoleNames(model->roleNames());
+#endif
+    }
+    
+    d->_q_rebuild();
+    emit sourceChanged();
+}
+
+/*!
+    \property QStringList StationFilterModel::facets
+    \brief The properties by which stations can be filtered.
+    
+    The default value is genre, country and language. Changing the facets indexes the source again.
+*/
+QStringList StationFilterModel::facets() const {
+    Q_D(const StationFilterModel);
+    
+    return d->index.facets();
+}
+
+void StationFilterModel::setFacets(const QStringList &facets) {
+    Q_D(StationFilterModel);
+    
+    if (facets != d->index.facets()) {
+        d->index.setFacets(facets);
+        d->_q_rebuild();
+        emit facetsChanged();
+    }
+}
+
+/*!
+    \property QVariantMap StationFilterModel::selection
+    \brief The selected values of each facet.
+    
+    Each value is either a string or a list of strings. Facets that are not in the selection, or have no selected 
+    values, do not filter the stations, so an empty selection shows every station.
+*/
+QVariantMap StationFilterModel::selection() const {
+    Q_D(const StationFilterModel);
+    
+    return d->selection;
+}
+
+void StationFilterModel::setSelection(const QVariantMap &selection) {
+    Q_D(StationFilterModel);
+    
+    if (selection != d->selection) {
+        d->selection = selection;
+        d->filter();
+        emit selectionChanged();
+    }
+}
+
+void StationFilterModel::clearSelection() {
+    setSelection(QVariantMap());
+}
+
+/*!
+    \enum StationFilterModel::MatchMode
+    \brief How the selected facets are combined.
+    
+    <table>
+        <tr>
+            <th>Value</th>
+            <th>Description</th>
+        </tr>
+        <tr>
+            <td>MatchAllFacets</td>
+            <td>A station must match every selected facet (default).</td>
+        </tr>
+        <tr>
+            <td>MatchAnyFacet</td>
+            <td>A station must match at least one selected facet.</td>
+        </tr>
+    </table>
+*/
+
+/*!
+    \property enum StationFilterModel::matchMode
+    \brief How the selected facets are combined.
+*/
+StationFilterModel::MatchMode StationFilterModel::matchMode() const {
+    Q_D(const StationFilterModel);
+    
+    return d->matchMode;
+}
+
+void StationFilterModel::setMatchMode(StationFilterModel::MatchMode mode) {
+    Q_D(StationFilterModel);
+    
+    if (mode != d->matchMode) {
+        d->matchMode = mode;
+        d->filter();
+        emit matchModeChanged();
+    }
+}
+
+#if QT_VERSION >= 0x050000
+QHash<int, QByteArray> StationFilterModel::roleNames() const {
+    Q_D(const StationFilterModel);
+    
+    return d->source ? d->source->roleNames() : QHash<int, QByteArray>();
+}
+#endif
+
+/*!
+    \brief Returns the number of matching stations.
+*/
+int StationFilterModel::rowCount(const QModelIndex &) const {
+    Q_D(const StationFilterModel);
+    
+    return d->count();
+}
+
+QVariant StationFilterModel::data(const QModelIndex &index, int role) const {
+    Q_D(const StationFilterModel);
+    
+    if ((!d->source) || (!index.isValid()) || (index.row() >= d->count())) {
+        return QVariant();
+    }
+    
+    return d->source->data(d->source->index(d->rowAt(index.row())), role);
+}
+
+/*!
+    \brief Returns the station at \a row.
+*/
+QVariantMap StationFilterModel::get(int row) const {
+    Q_D(const StationFilterModel);
+    
+    return (d->source) && (row >= 0) && (row < d->count()) ? d->source->get(d->rowAt(row)) : QVariantMap();
+}
+
+/*!
+    \brief Returns the row in the source model of the station at \a row, or -1.
+*/
+int StationFilterModel::sourceRow(int row) const {
+    Q_D(const StationFilterModel);
+    
+    return (row >= 0) && (row < d->count()) ? d->rowAt(row) : -1;
+}
+
+/*!
+    \brief Returns the distinct values of \a facet in the source model.
+*/
+QStringList StationFilterModel::facetValues(const QString &facet) const {
+    Q_D(const StationFilterModel);
+    
+    QStringList values = d->index.values(facet);
+    values.sort();
+    return values;
+}
+
+/*!
+    \brief Returns the number of stations with each value of \a facet.
+    
+    In MatchAllFacets mode, the counts are of the stations that match the selection of every other facet, so each 
+    count is the number of stations that would be shown if that value were the only selected value of \a facet. 
+    In MatchAnyFacet mode, the counts are of all stations.
+    
+    \sa facetCountsChanged()
+*/
+QVariantMap StationFilterModel::facetCounts(const QString &facet) const {
+    Q_D(const StationFilterModel);
+    
+    return d->index.counts(facet, d->matchMode == MatchAllFacets ? d->selectedRows(facet) : d->index.all());
+}
+
+/*!
+    \fn void StationFilterModel::facetCountsChanged()
+    \brief Emitted when the results of facetCounts() may have changed.
+*/
+
+static QStringList selectedValues(const QVariant &value) {
+    QStringList values;
+    
+    switch (value.type()) {
+    case QVariant::List:
+    case QVariant::StringList:
+        values = value.toStringList();
+        break;
+    default:
+        values << value.toString();
+        break;
+    }
+    
+    values.removeAll(QString());
+    return values;
+}
+
+StationFilterModelPrivate::StationFilterModelPrivate(StationFilterModel *parent) :
+    q_ptr(parent),
+    matchMode(StationFilterModel::MatchAllFacets),
+    gapStart(0),
+    gapSize(0)
+{
+}
+
+/*!
+    \internal
+    \brief Returns the number of rows in the model.
+*/
+int StationFilterModelPrivate::count() const {
+    return rows.size() - gapSize;
+}
+
+/*!
+    \internal
+    \brief Returns the source row of \a row, skipping the gap left while update() moves rows.
+*/
+int StationFilterModelPrivate::rowAt(int row) const {
+    return rows.at(row < gapStart ? row : row + gapSize);
+}
+
+/*!
+    \internal
+    \brief Updates the index for source rows \a first to \a last, appending rows that are not yet indexed.
+    
+    Empty rows, such as evicted rows in windowed mode, keep the values they had. Rows that start or stop 
+    matching the selection are inserted or removed, and matching rows that were already indexed are reported 
+    as changed.
+*/
+void StationFilterModelPrivate::indexRows(int first, int last) {
+    if (!source) {
+        return;
+    }
+    
+    Q_Q(StationFilterModel);
+    
+    const int indexed = index.rowCount();
+    bool changed = false;
+    
+    for (int row = first; row <= last; row++) {
+        const QVariantMap item = source->get(row);
+        
+        if (row >= index.rowCount()) {
+            index.appendRow(item);
+            changed = true;
+        }
+        else if ((!item.isEmpty()) && (index.updateRow(row, item))) {
+            changed = true;
+        }
+    }
+    
+    if (changed) {
+        update();
+    }
+    
+    const int changedFirst = int(std::lower_bound(rows.constBegin(), rows.constEnd(), first) - rows.constBegin());
+    const int changedLast = int(std::upper_bound(rows.constBegin(), rows.constEnd(), qMin(last, indexed - 1))
+                                - rows.constBegin()) - 1;
+    
+    if (changedFirst <= changedLast) {
+        emit q->dataChanged(q->index(changedFirst), q->index(changedLast));
+    }
+}
+
+/*!
+    \internal
+    \brief Returns the rows that match the selection, ignoring the selection of \a excludedFacet.
+*/
+RowBitmap StationFilterModelPrivate::selectedRows(const QString &excludedFacet) const {
+    RowBitmap result;
+    bool selected = false;
+    
+    foreach (const QString &facet, index.facets()) {
+        if (facet == excludedFacet) {
+            continue;
+        }
+        
+        const QStringList values = selectedValues(selection.value(facet));
+        
+        if (values.isEmpty()) {
+            continue;
+        }
+        
+        const RowBitmap matches = index.match(facet, values);
+        
+        if (!selected) {
+            result = matches;
+            selected = true;
+        }
+        else if (matchMode == StationFilterModel::MatchAllFacets) {
+            result &= matches;
+        }
+        else {
+            result |= matches;
+        }
+    }
+    
+    return selected ? result : index.all();
+}
+
+/*!
+    \internal
+    \brief Replaces the rows of the model with the source rows that match the selection.
+*/
+void StationFilterModelPrivate::filter() {
+    Q_Q(StationFilterModel);
+    
+    const int count = rows.size();
+    q->beginResetModel();
+    rows = source ? selectedRows().rows() : QVector<int>();
+    q->endResetModel();
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::StationFilterModelPrivate::filter" << selection << rows.size();
+#endif
+    if (rows.size() != count) {
+        emit q->countChanged(rows.size());
+    }
+    
+    emit q->facetCountsChanged();
+}
+
+/*!
+    \internal
+    \brief Inserts and removes rows so that the rows of the model are the source rows that match the selection.
+    
+    Unlike filter(), the model is not reset, so views keep their position and delegates.
+*/
+void StationFilterModelPrivate::update() {
+    Q_Q(StationFilterModel);
+    
+    const QVector<int> matched = source ? selectedRows().rows() : QVector<int>();
+    const int count = rows.size();
+    
+    // Rows that no longer match are removed from the front, and each row that still matches is moved down across 
+    // the gap they leave, so every row is moved at most once.
+    while (gapStart + gapSize < rows.size()) {
+        const int first = gapStart + gapSize;
+        
+        if (std::binary_search(matched.constBegin(), matched.constEnd(), rows.at(first))) {
+            rows[gapStart] = rows.at(first);
+            gapStart++;
+            continue;
+        }
+        
+        int last = first;
+        
+        while ((last + 1 < rows.size())
+               && (!std::binary_search(matched.constBegin(), matched.constEnd(), rows.at(last + 1)))) {
+            last++;
+        }
+        
+        q->beginRemoveRows(QModelIndex(), gapStart, gapStart + last - first);
+        gapSize += last - first + 1;
+        q->endRemoveRows();
+    }
+    
+    rows.resize(gapStart);
+    
+    // The remaining rows are a subsequence of the matched rows. They are moved to their final positions from the 
+    // end, and each block of new rows is copied into the gap in front of them, in a single pass.
+    gapSize = matched.size() - rows.size();
+    rows.resize(matched.size());
+    int last = matched.size() - 1;
+    
+    while (gapSize > 0) {
+        if ((gapStart > 0) && (rows.at(gapStart - 1) == matched.at(last))) {
+            rows[last] = matched.at(last);
+            gapStart--;
+            last--;
+            continue;
+        }
+        
+        const int first = gapStart > 0 ? int(std::lower_bound(matched.constBegin(), matched.constBegin() + last,
+                                                              rows.at(gapStart - 1)) - matched.constBegin()) + 1
+                                       : 0;
+        q->beginInsertRows(QModelIndex(), gapStart, gapStart + last - first);
+        
+        for (int i = first; i <= last; i++) {
+            rows[i] = matched.at(i);
+        }
+        
+        gapSize -= last - first + 1;
+        q->endInsertRows();
+        last = first - 1;
+    }
+    
+    gapStart = 0;
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::StationFilterModelPrivate::update" << count << rows.size();
+#endif
+    if (rows.size() != count) {
+        emit q->countChanged(rows.size());
+    }
+    
+    emit q->facetCountsChanged();
+}
+
+void StationFilterModelPrivate::_q_onSourceRowsInserted(const QModelIndex &, int first, int last) {
+    if (first == index.rowCount()) {
+        indexRows(first, last);
+    }
+    else {
+        _q_rebuild();
+    }
+}
+
+void StationFilterModelPrivate::_q_onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+    indexRows(topLeft.row(), qMin(bottomRight.row(), index.rowCount() - 1));
+}
+
+/*!
+    \internal
+    \brief Indexes every row of the source again.
+*/
+void StationFilterModelPrivate::_q_rebuild() {
+    index.clear();
+    
+    if (source) {
+        for (int row = 0; row < source->rowCount(); row++) {
+            index.appendRow(source->get(row));
+        }
+    }
+    
+    filter();
+}
+
+void StationFilterModelPrivate::_q_onSourceDestroyed() {
+    Q_Q(StationFilterModel);
+    
+    source = 0;
+    _q_rebuild();
+    emit q->sourceChanged();
+}
+
+}
+
+#include "moc_stationfiltermodel.cpp"
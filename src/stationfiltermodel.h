@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_STATIONFILTERMODEL_H
+#define CUTERADIO_STATIONFILTERMODEL_H
+
+#include "cuteradio_global.h"
+#include <QAbstractListModel>
+#include <QStringList>
+
+namespace CuteRadio {
+
+class StationsModel;
+class StationFilterModelPrivate;
+
+class CUTERADIOSHARED_EXPORT StationFilterModel : public QAbstractListModel
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+    Q_PROPERTY(CuteRadio::StationsModel* source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(QStringList facets READ facets WRITE setFacets NOTIFY facetsChanged)
+    Q_PROPERTY(QVariantMap selection READ selection WRITE setSelection RESET clearSelection NOTIFY selectionChanged)
+    Q_PROPERTY(MatchMode matchMode READ matchMode WRITE setMatchMode NOTIFY matchModeChanged)
+    
+    Q_ENUMS(MatchMode)
+    
+public:
+    enum MatchMode {
+        MatchAllFacets = 0,
+        MatchAnyFacet
+    };
+    
+    explicit StationFilterModel(QObject *parent = 0);
+    ~StationFilterModel();
+    
+    StationsModel* source() const;
+    void setSource(StationsModel *model);
+    
+    QStringList facets() const;
+    void setFacets(const QStringList &facets);
+    
+    QVariantMap selection() const;
+    void setSelection(const QVariantMap &selection);
+    void clearSelection();
+    
+    MatchMode matchMode() const;
+    void setMatchMode(MatchMode mode);
+    
+#if QT_VERSION >= 0x050000
+    QHash<int, QByteArray> roleNames() const;
+#endif
+    
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    
+    Q_INVOKABLE QVariantMap get(int row) const;
+    Q_INVOKABLE int sourceRow(int row) const;
+    
+    Q_INVOKABLE QStringList facetValues(const QString &facet) const;
+    Q_INVOKABLE QVariantMap facetCounts(const QString &facet) const;
+    
+Q_SIGNALS:
+    void countChanged(int count);
+    void sourceChanged();
+    void facetsChanged();
+    void selectionChanged();
+    void matchModeChanged();
+    void facetCountsChanged();
+    
+private:
+    QScopedPointer<StationFilterModelPrivate> d_ptr;
+    
+    Q_DECLARE_PRIVATE(StationFilterModel)
+    
+    Q_PRIVATE_SLOT(d_func(), void _q_onSourceRowsInserted(QModelIndex, int, int))
+    Q_PRIVATE_SLOT(d_func(), void _q_onSourceDataChanged(QModelIndex, QModelIndex))
+    Q_PRIVATE_SLOT(d_func(), void _q_rebuild())
+    Q_PRIVATE_SLOT(d_func(), void _q_onSourceDestroyed())
+    
+    Q_DISABLE_COPY(StationFilterModel)
+};
+
+}
+
+#endif // CUTERADIO_STATIONFILTERMODEL_H
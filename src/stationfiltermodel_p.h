@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_STATIONFILTERMODEL_P_H
+#define CUTERADIO_STATIONFILTERMODEL_P_H
+
+#include "stationfiltermodel.h"
+#include "facetindex_p.h"
+#include "stationsmodel.h"
+#include <QPointer>
+
+namespace CuteRadio {
+
+class StationFilterModelPrivate
+{
+
+public:
+    StationFilterModelPrivate(StationFilterModel *parent);
+    
+    int count() const;
+    int rowAt(int row) const;
+    
+    void indexRows(int first, int last);
+    
+    RowBitmap selectedRows(const QString &excludedFacet = QString()) const;
+    
+    void filter();
+    void update();
+    
+    void _q_onSourceRowsInserted(const QModelIndex &parent, int first, int last);
+    void _q_onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void _q_rebuild();
+    void _q_onSourceDestroyed();
+    
+    StationFilterModel *q_ptr;
+    
+    QPointer<StationsModel> source;
+    
+    FacetIndex index;
+    
+    QVariantMap selection;
+    
+    StationFilterModel::MatchMode matchMode;
+    
+    QVector<int> rows;
+    
+    // While update() moves rows, the gapSize entries of rows from gapStart are not rows of the model.
+    int gapStart;
+    int gapSize;
+    
+    Q_DECLARE_PUBLIC(StationFilterModel)
+};
+
+}
+
+#endif // CUTERADIO_STATIONFILTERMODEL_P_H
@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stationindex_p.h"
+#include <qmath.h>
+#include <algorithm>
+
+namespace CuteRadio {
+
+static const struct {
+    const char *name;
+    int weight;
+} INDEXED_FIELDS[] = {
+    { "title", 4 },
+    { "genre", 2 },
+    { "country", 2 },
+    { "language", 2 },
+    { "description", 1 }
+};
+
+static const int INDEXED_FIELD_COUNT = sizeof(INDEXED_FIELDS) / sizeof(INDEXED_FIELDS[0]);
+
+// Matches on a prefix of a term score less than exact matches.
+static const double PREFIX_MATCH_FACTOR = 0.5;
+
+static bool matchLessThan(const StationMatch &a, const StationMatch &b) {
+    return a.score == b.score ? a.station < b.station : a.score > b.score;
+}
+
+static bool sameIndexedFields(const QVariantMap &a, const QVariantMap &b) {
+    for (int i = 0; i < INDEXED_FIELD_COUNT; i++) {
+        if (a.value(INDEXED_FIELDS[i].name) != b.value(INDEXED_FIELDS[i].name)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+StationIndex::StationIndex() :
+    liveCount(0)
+{
+}
+
+/*!
+    \internal
+    \brief Returns the number of stations in the index.
+*/
+int StationIndex::size() const {
+    return liveCount;
+}
+
+/*!
+    \internal
+    \brief Returns true if a station with \a id is in the index.
+*/
+bool StationIndex::contains(const QString &id) const {
+    return ids.contains(id);
+}
+
+/*!
+    \internal
+    \brief Adds \a station to the index, replacing any station with the same id.
+    
+    Returns false if \a station is empty, or if its indexed fields are unchanged. In that case the stored 
+    station is still replaced, so properties that are not indexed, such as reachability, stay current.
+*/
+bool StationIndex::insert(const QVariantMap &station) {
+    if (station.isEmpty()) {
+        return false;
+    }
+    
+    const QString id = station.value("id").toString();
+    
+    if (!id.isEmpty()) {
+        const int existing = ids.value(id, -1);
+        
+        if (existing != -1) {
+            if (sameIndexedFields(stations.at(existing), station)) {
+                stations[existing] = station;
+                return false;
+            }
+            
+            live[existing] = false;
+            stations[existing] = QVariantMap();
+            liveCount--;
+        }
+        
+        ids[id] = stations.size();
+    }
+    
+    stations << station;
+    live << true;
+    liveCount++;
+    addPostings(stations.size() - 1);
+    
+    // Replaced stations leave stale postings behind, so rebuild once they outnumber the live ones.
+    if (stations.size() > liveCount * 2) {
+        compact();
+    }
+    
+    return true;
+}
+
+/*!
+    \internal
+    \brief Removes all stations from the index.
+*/
+void StationIndex::clear() {
+    postings.clear();
+    stations.clear();
+    live.clear();
+    ids.clear();
+    liveCount = 0;
+}
+
+/*!
+    \internal
+    \brief Returns the station at \a index, as returned in StationMatch::station.
+*/
+QVariantMap StationIndex::station(int index) const {
+    return stations.value(index);
+}
+
+/*!
+    \internal
+    \brief Returns at most \a limit stations matching every token of \a query, highest score first.
+    
+    The last token also matches terms that it is a prefix of, so partially typed words find results. Each match 
+    scores the field weight of the term multiplied by its inverse document frequency.
+*/
+QList<StationMatch> StationIndex::search(const QString &query, int limit) const {
+    QList<StationMatch> matches;
+    const QStringList tokens = tokenize(query);
+    
+    if ((tokens.isEmpty()) || (limit <= 0)) {
+        return matches;
+    }
+    
+    QHash<int, double> scores;
+    
+    for (int t = 0; t < tokens.size(); t++) {
+        const QString &token = tokens.at(t);
+        const bool prefix = (t == tokens.size() - 1);
+        QHash<int, double> tokenScores;
+        QMap<QString, QVector<Posting> >::const_iterator iterator =
+        prefix ? postings.lowerBound(token) : postings.constFind(token);
+        
+        while ((iterator != postings.constEnd()) && (iterator.key().startsWith(token))) {
+            const QVector<Posting> &list = iterator.value();
+            const double idf = qLn(1.0 + double(liveCount) / list.size());
+            const double factor = iterator.key().size() == token.size() ? 1.0 : PREFIX_MATCH_FACTOR;
+            
+            for (int i = 0; i < list.size(); i++) {
+                const Posting &posting = list.at(i);
+                
+                if ((live.at(posting.station)) && ((t == 0) || (scores.contains(posting.station)))) {
+                    double &score = tokenScores[posting.station];
+                    score = qMax(score, posting.weight * idf * factor);
+                }
+            }
+            
+            if (!prefix) {
+                break;
+            }
+            
+            ++iterator;
+        }
+        
+        if (t > 0) {
+            QMutableHashIterator<int, double> scoreIterator(scores);
+            
+            while (scoreIterator.hasNext()) {
+                scoreIterator.next();
+                
+                if (tokenScores.contains(scoreIterator.key())) {
+                    scoreIterator.value() += tokenScores.value(scoreIterator.key());
+                }
+                else {
+                    scoreIterator.remove();
+                }
+            }
+        }
+        else {
+            scores = tokenScores;
+        }
+        
+        if (scores.isEmpty()) {
+            return matches;
+        }
+    }
+    
+    QVector<StationMatch> all;
+    all.reserve(scores.size());
+    QHashIterator<int, double> iterator(scores);
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        StationMatch match;
+        match.station = iterator.key();
+        match.score = iterator.value();
+        all << match;
+    }
+    
+    const int count = qMin(limit, all.size());
+    std::partial_sort(all.begin(), all.begin() + count, all.end(), matchLessThan);
+    
+    for (int i = 0; i < count; i++) {
+        matches << all.at(i);
+    }
+    
+    return matches;
+}
+
+/*!
+    \internal
+    \brief Splits \a text into lower case words, with diacritics removed.
+*/
+QStringList StationIndex::tokenize(const QString &text) {
+    QStringList tokens;
+    const QString normalized = text.normalized(QString::NormalizationForm_KD).toLower();
+    QString token;
+    
+    for (int i = 0; i < normalized.size(); i++) {
+        const QChar c = normalized.at(i);
+        
+        if (c.isLetterOrNumber()) {
+            token.append(c);
+        }
+        else if (c.category() != QChar::Mark_NonSpacing) {
+            if (!token.isEmpty()) {
+                tokens << token;
+                token.clear();
+            }
+        }
+    }
+    
+    if (!token.isEmpty()) {
+        tokens << token;
+    }
+    
+    return tokens;
+}
+
+void StationIndex::addPostings(int index) {
+    const QVariantMap &station = stations.at(index);
+    QHash<QString, int> weights;
+    
+    for (int i = 0; i < INDEXED_FIELD_COUNT; i++) {
+        foreach (const QString &token, tokenize(station.value(INDEXED_FIELDS[i].name).toString())) {
+            weights[token] += INDEXED_FIELDS[i].weight;
+        }
+    }
+    
+    QHashIterator<QString, int> iterator(weights);
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        Posting posting;
+        posting.station = index;
+        posting.weight = iterator.value();
+        postings[iterator.key()] << posting;
+    }
+}
+
+void StationIndex::compact() {
+    const QList<QVariantMap> current = stations;
+    const QVector<bool> currentLive = live;
+    clear();
+    
+    for (int i = 0; i < current.size(); i++) {
+        if (currentLive.at(i)) {
+            insert(current.at(i));
+        }
+    }
+}
+
+}
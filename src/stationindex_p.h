@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_STATIONINDEX_P_H
+#define CUTERADIO_STATIONINDEX_P_H
+
+#include <QHash>
+#include <QMap>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+
+namespace CuteRadio {
+
+/*!
+    \internal
+    \brief A station matched by StationIndex::search().
+*/
+class StationMatch
+{
+
+public:
+    int station;
+    double score;
+};
+
+/*!
+    \internal
+    \brief An in-memory inverted index over station title, description, genre, country and language.
+    
+    Each station is stored once, keyed by id. Re-inserting a station with the same id replaces it.
+*/
+class StationIndex
+{
+
+public:
+    StationIndex();
+    
+    int size() const;
+    
+    bool contains(const QString &id) const;
+    bool insert(const QVariantMap &station);
+    void clear();
+    
+    QVariantMap station(int index) const;
+    
+    QList<StationMatch> search(const QString &query, int limit) const;
+    
+    static QStringList tokenize(const QString &text);
+
+private:
+    class Posting
+    {
+    
+    public:
+        int station;
+        int weight;
+    };
+    
+    void addPostings(int index);
+    void compact();
+    
+    QMap<QString, QVector<Posting> > postings;
+    
+    QList<QVariantMap> stations;
+    QVector<bool> live;
+    QHash<QString, int> ids;
+    
+    int liveCount;
+};
+
+}
+
+#endif // CUTERADIO_STATIONINDEX_P_H
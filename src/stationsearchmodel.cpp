@@ -0,0 +1,493 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stationsearchmodel.h"
+#include "stationsearchmodel_p.h"
+#include "stationsmodel.h"
+#ifdef CUTERADIO_DEBUG
+#include <QDebug>
+#endif
+
+namespace CuteRadio {
+
+static const int DEFAULT_SEARCH_LIMIT = 50;
+
+/*!
+    \class StationSearchModel
+    \brief A model for searching stations that have already been loaded.
+    
+    \ingroup models
+    
+    StationSearchModel keeps an in-memory inverted index over the title, description, genre, country and language 
+    of stations. Stations are added from the source StationsModel as its rows are loaded or changed, or by calling 
+    addStations(). The index keeps stations after they are removed or evicted from the source model.
+    
+    Setting the query property searches the index immediately. Each word of the query must match a word of the 
+    station, and the last word may be partially typed. Results are ranked by where the words match, with title 
+    matches scoring highest, and by how rare the words are.
+    
+    If serverFallback is enabled and the search finds fewer than limit stations, the query is also sent to the 
+    cuteRadio Data API, unless the source model has loaded the complete, unfiltered list of stations. Stations 
+    returned by the server are added to the index and appended to the results.
+    
+    StationSearchModel provides the same roles as StationsModel, plus the following:
+    
+    <table>
+        <tr>
+        <th>Role</th>
+        <th>Role name</th>
+        <th>Description</th>
+        </tr>
+        <tr>
+            <td>ScoreRole</td>
+            <td>score</td>
+            <td>The relevance of the station to the query. Stations found only by the server score 0.</td>
+        </tr>
+    </table>
+    
+    Example usage:
+    
+    \code
+    import QtQuick 1.0
+    import CuteRadio 1.0
+    
+    ListView {
+        id: view
+        
+        width: 800
+        height: 480
+        model: StationSearchModel {
+            source: stationsModel
+            query: searchField.text
+        }
+        delegate: Text {
+            width: view.width
+            height: 50
+            text: title
+        }
+    }
+    \endcode
+    
+    \sa StationsModel
+*/
+StationSearchModel::StationSearchModel(QObject *parent) :
+    Model(*new StationSearchModelPrivate(this), parent)
+{
+    Q_D(StationSearchModel);
+    d->roles[Qt::DisplayRole] = "title";
+    d->roles[IdRole] = "id";
+    d->roles[TitleRole] = "title";
+    d->roles[DescriptionRole] = "description";
+    d->roles[GenreRole] = "genre";
+    d->roles[CountryRole] = "country";
+    d->roles[LanguageRole] = "language";
+    d->roles[SourceRole] = "source";
+    d->roles[PlayCountRole] = "playCount";
+    d->roles[LastPlayedRole] = "lastPlayed";
+    d->roles[CreatorIdRole] = "creatorId";
+    d->roles[ApprovedRole] = "approved";
+    d->roles[FavouriteRole] = "favourite";
+    d->roles[ScoreRole] = "score";
+#if QT_VERSION < 0x050000
+    setRoleNames(d->roles);
+#endif
+    d->request = new ResourcesRequest(this);
+    connect(d->request, SIGNAL(finished(CuteRadio::Request*)), this, SLOT(_q_onRequestFinished()));
+}
+
+/*!
+    \property StationsModel* StationSearchModel::source
+    \brief The model from which stations are indexed.
+    
+    Existing rows are indexed when the source is set, and inserted or changed rows are indexed as they arrive. 
+    Changing the source does not remove stations that are already indexed.
+*/
+StationsModel* StationSearchModel::source() const {
+    Q_D(const StationSearchModel);
+    
+    return d->source;
+}
+
+void StationSearchModel::setSource(StationsModel *model) {
+    Q_D(StationSearchModel);
+    
+    if (model == d->source) {
+        return;
+    }
+    
+    if (d->source) {
+        disconnect(d->source, 0, this, 0);
+    }
+    
+    d->source = model;
+    
+    if (model) {
+        connect(model, SIGNAL(rowsInserted(QModelIndex, int, int)),
+                this, SLOT(_q_onSourceRowsInserted(QModelIndex, int, int)));
+        connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)),
+                this, SLOT(_q_onSourceDataChanged(QModelIndex, QModelIndex)));
+        connect(model, SIGNAL(destroyed()), this, SLOT(_q_onSourceDestroyed()));
+        d->indexRows(0, model->rowCount() - 1);
+    }
+    
+    emit sourceChanged();
+}
+
+/*!
+    \property QString StationSearchModel::query
+    \brief The search query.
+    
+    Setting the query updates the results immediately. An empty query gives no results.
+*/
+QString StationSearchModel::query() const {
+    Q_D(const StationSearchModel);
+    
+    return d->query;
+}
+
+void StationSearchModel::setQuery(const QString &query) {
+    Q_D(StationSearchModel);
+    
+    if (query != d->query) {
+        d->query = query;
+        d->search();
+        emit queryChanged();
+    }
+}
+
+/*!
+    \property int StationSearchModel::limit
+    \brief The maximum number of results.
+    
+    The default value is 50.
+*/
+int StationSearchModel::limit() const {
+    Q_D(const StationSearchModel);
+    
+    return d->limit;
+}
+
+void StationSearchModel::setLimit(int limit) {
+    Q_D(StationSearchModel);
+    
+    if (limit != d->limit) {
+        d->limit = limit;
+        d->search();
+        emit limitChanged();
+    }
+}
+
+/*!
+    \property bool StationSearchModel::serverFallback
+    \brief Whether the cuteRadio Data API is searched when the local results are incomplete.
+    
+    The default value is true.
+*/
+bool StationSearchModel::serverFallback() const {
+    Q_D(const StationSearchModel);
+    
+    return d->serverFallback;
+}
+
+void StationSearchModel::setServerFallback(bool enabled) {
+    Q_D(StationSearchModel);
+    
+    if (enabled != d->serverFallback) {
+        d->serverFallback = enabled;
+        emit serverFallbackChanged();
+    }
+}
+
+/*!
+    \property int StationSearchModel::stationCount
+    \brief The number of stations in the index.
+*/
+int StationSearchModel::stationCount() const {
+    Q_D(const StationSearchModel);
+    
+    return d->index.size();
+}
+
+/*!
+    \property enum StationSearchModel::status
+    \brief The status of the server search.
+    
+    \sa ResourcesRequest::status
+*/
+ResourcesRequest::Status StationSearchModel::status() const {
+    Q_D(const StationSearchModel);
+    
+    return d->request->status();
+}
+
+/*!
+    \brief Sets the QNetworkAccessManager instance to be used for server searches.
+    
+    StationSearchModel does not take ownership of \a manager.
+*/
+void StationSearchModel::setNetworkAccessManager(QNetworkAccessManager *manager) {
+    Q_D(StationSearchModel);
+    
+    d->request->setNetworkAccessManager(manager);
+}
+
+/*!
+    \brief Re-implemented from Model::data()
+*/
+QVariant StationSearchModel::data(const QModelIndex &index, int role) const {
+    if (role == ScoreRole) {
+        Q_D(const StationSearchModel);
+        
+        return d->scores.value(index.row());
+    }
+    
+    return Model::data(index, role);
+}
+
+/*!
+    \brief Adds \a stations to the index, for example stations restored from a cache.
+*/
+void StationSearchModel::addStations(const QVariantList &stations) {
+    Q_D(StationSearchModel);
+    
+    const int count = d->index.size();
+    bool changed = false;
+    
+    foreach (const QVariant &station, stations) {
+        changed |= d->index.insert(station.toMap());
+    }
+    
+    if (changed) {
+        d->search();
+    }
+    
+    if (d->index.size() != count) {
+        emit stationCountChanged(d->index.size());
+    }
+}
+
+/*!
+    \brief Removes all stations from the index.
+*/
+void StationSearchModel::clearIndex() {
+    Q_D(StationSearchModel);
+    
+    if (d->index.size() > 0) {
+        d->index.clear();
+        d->search();
+        emit stationCountChanged(0);
+    }
+}
+
+StationSearchModelPrivate::StationSearchModelPrivate(StationSearchModel *parent) :
+    ModelPrivate(parent),
+    request(0),
+    limit(DEFAULT_SEARCH_LIMIT),
+    serverFallback(true)
+{
+}
+
+void StationSearchModelPrivate::indexRows(int first, int last) {
+    if (!source) {
+        return;
+    }
+    
+    Q_Q(StationSearchModel);
+    
+    const int count = index.size();
+    bool changed = false;
+    QHash<QString, QVariantMap> updated;
+    
+    for (int row = first; row <= last; row++) {
+        const QVariantMap station = source->get(row);
+        
+        if (index.insert(station)) {
+            changed = true;
+        }
+        else if (!station.isEmpty()) {
+            updated.insert(station.value("id").toString(), station);
+        }
+    }
+    
+    if (changed) {
+        search();
+    }
+    else if (!updated.isEmpty()) {
+        // Only properties that are not indexed changed, so the matches stay the same.
+        for (int i = 0; i < items.size(); i++) {
+            const QVariantMap station = updated.value(items.at(i).value("id").toString());
+            
+            if ((!station.isEmpty()) && (station != items.at(i))) {
+                items[i] = station;
+                emit q->dataChanged(q->index(i), q->index(i));
+            }
+        }
+    }
+    
+    if (index.size() != count) {
+        emit q->stationCountChanged(index.size());
+    }
+}
+
+/*!
+    \internal
+    \brief Returns true if the source model holds every station, so the server cannot find any more.
+*/
+bool StationSearchModelPrivate::corpusComplete() const {
+    if ((!source) || (source->status() != ResourcesRequest::Ready) || (source->canFetchMore())
+        || (source->resource() != "stations")) {
+        return false;
+    }
+    
+    foreach (const QString &filter, source->filters().keys()) {
+        if ((filter != "limit") && (filter != "sort") && (filter != "sortDescending")) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+void StationSearchModelPrivate::search() {
+    Q_Q(StationSearchModel);
+    
+    const QList<StationMatch> matches = index.search(query, limit);
+    bool same = matches.size() == items.size();
+    
+    for (int i = 0; (same) && (i < matches.size()); i++) {
+        same = index.station(matches.at(i).station).value("id") == items.at(i).value("id");
+    }
+    
+    if (same) {
+        // The same stations matched in the same order, so the rows are updated without a reset.
+        for (int i = 0; i < matches.size(); i++) {
+            const QVariantMap station = index.station(matches.at(i).station);
+            
+            if ((station != items.at(i)) || (matches.at(i).score != scores.at(i))) {
+                items[i] = station;
+                scores[i] = matches.at(i).score;
+                emit q->dataChanged(q->index(i), q->index(i));
+            }
+        }
+    }
+    else {
+        q->beginResetModel();
+        items.clear();
+        scores.clear();
+        
+        foreach (const StationMatch &match, matches) {
+            items << index.station(match.station);
+            scores << match.score;
+        }
+        
+        q->endResetModel();
+        emit q->countChanged(q->rowCount());
+    }
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::StationSearchModelPrivate::search" << query << items.size() << "of" << index.size();
+#endif
+    if ((serverFallback) && (items.size() < limit) && (query != serverQuery) && (!query.trimmed().isEmpty())
+        && (!corpusComplete())) {
+        serverQuery = query;
+        searchServer();
+    }
+}
+
+void StationSearchModelPrivate::searchServer() {
+    if (request->status() == ResourcesRequest::Loading) {
+        // The search is restarted with the latest query when the canceled request finishes.
+        request->cancel();
+        return;
+    }
+    
+    Q_Q(StationSearchModel);
+    
+    QVariantMap filters;
+    filters["search"] = serverQuery;
+    filters["limit"] = limit;
+    requestQuery = serverQuery;
+    request->get("/stations", filters);
+    emit q->statusChanged(request->status());
+}
+
+void StationSearchModelPrivate::_q_onSourceRowsInserted(const QModelIndex &, int first, int last) {
+    indexRows(first, last);
+}
+
+void StationSearchModelPrivate::_q_onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+    indexRows(topLeft.row(), bottomRight.row());
+}
+
+void StationSearchModelPrivate::_q_onSourceDestroyed() {
+    Q_Q(StationSearchModel);
+    
+    source = 0;
+    emit q->sourceChanged();
+}
+
+void StationSearchModelPrivate::_q_onRequestFinished() {
+    Q_Q(StationSearchModel);
+    
+    if ((request->status() == ResourcesRequest::Ready) && (requestQuery == query)) {
+        const QVariantList list = request->result().toMap().value("items").toList();
+        
+        if (!list.isEmpty()) {
+            const int count = index.size();
+            QSet<QString> ids;
+            
+            foreach (const QVariantMap &item, items) {
+                ids << item.value("id").toString();
+            }
+            
+            QList<QVariantMap> found;
+            
+            foreach (const QVariant &v, list) {
+                const QVariantMap station = v.toMap();
+                index.insert(station);
+                
+                if ((items.size() + found.size() < limit) && (!ids.contains(station.value("id").toString()))) {
+                    found << station;
+                }
+            }
+            
+            if (!found.isEmpty()) {
+                q->beginInsertRows(QModelIndex(), items.size(), items.size() + found.size() - 1);
+                
+                foreach (const QVariantMap &station, found) {
+                    items << station;
+                    scores << 0.0;
+                }
+                
+                q->endInsertRows();
+                emit q->countChanged(q->rowCount());
+            }
+            
+            if (index.size() != count) {
+                emit q->stationCountChanged(index.size());
+            }
+        }
+    }
+    
+    emit q->statusChanged(request->status());
+    
+    if ((serverQuery != requestQuery) && (serverQuery == query)) {
+        searchServer();
+    }
+}
+
+}
+
+#include "moc_stationsearchmodel.cpp"
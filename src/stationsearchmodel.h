@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_STATIONSEARCHMODEL_H
+#define CUTERADIO_STATIONSEARCHMODEL_H
+
+#include "model.h"
+#include "resourcesrequest.h"
+
+namespace CuteRadio {
+
+class StationsModel;
+class StationSearchModelPrivate;
+
+class CUTERADIOSHARED_EXPORT StationSearchModel : public Model
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(CuteRadio::StationsModel* source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(QString query READ query WRITE setQuery NOTIFY queryChanged)
+    Q_PROPERTY(int limit READ limit WRITE setLimit NOTIFY limitChanged)
+    Q_PROPERTY(bool serverFallback READ serverFallback WRITE setServerFallback NOTIFY serverFallbackChanged)
+    Q_PROPERTY(int stationCount READ stationCount NOTIFY stationCountChanged)
+    Q_PROPERTY(CuteRadio::ResourcesRequest::Status status READ status NOTIFY statusChanged)
+    
+    Q_ENUMS(Roles)
+    
+public:
+    enum Roles {
+        IdRole = Qt::UserRole + 1,
+        TitleRole,
+        DescriptionRole,
+        GenreRole,
+        CountryRole,
+        LanguageRole,
+        SourceRole,
+        PlayCountRole,
+        LastPlayedRole,
+        CreatorIdRole,
+        ApprovedRole,
+        FavouriteRole,
+        ScoreRole
+    };
+    
+    explicit StationSearchModel(QObject *parent = 0);
+    
+    StationsModel* source() const;
+    void setSource(StationsModel *model);
+    
+    QString query() const;
+    void setQuery(const QString &query);
+    
+    int limit() const;
+    void setLimit(int limit);
+    
+    bool serverFallback() const;
+    void setServerFallback(bool enabled);
+    
+    int stationCount() const;
+    
+    ResourcesRequest::Status status() const;
+    
+    void setNetworkAccessManager(QNetworkAccessManager *manager);
+    
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    
+    Q_INVOKABLE void addStations(const QVariantList &stations);
+    
+public Q_SLOTS:
+    void clearIndex();
+    
+Q_SIGNALS:
+    void sourceChanged();
+    void queryChanged();
+    void limitChanged();
+    void serverFallbackChanged();
+    void stationCountChanged(int count);
+    void statusChanged(CuteRadio::ResourcesRequest::Status s);
+    
+private:
+    Q_DECLARE_PRIVATE(StationSearchModel)
+    
+    Q_PRIVATE_SLOT(d_func(), void _q_onSourceRowsInserted(QModelIndex, int, int))
+    Q_PRIVATE_SLOT(d_func(), void _q_onSourceDataChanged(QModelIndex, QModelIndex))
+    Q_PRIVATE_SLOT(d_func(), void _q_onSourceDestroyed())
+    Q_PRIVATE_SLOT(d_func(), void _q_onRequestFinished())
+    
+    Q_DISABLE_COPY(StationSearchModel)
+};
+
+}
+
+#endif // CUTERADIO_STATIONSEARCHMODEL_H
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_STATIONSEARCHMODEL_P_H
+#define CUTERADIO_STATIONSEARCHMODEL_P_H
+
+#include "stationsearchmodel.h"
+#include "model_p.h"
+#include "stationindex_p.h"
+#include "stationsmodel.h"
+#include <QPointer>
+
+namespace CuteRadio {
+
+class StationSearchModelPrivate : public ModelPrivate
+{
+
+public:
+    StationSearchModelPrivate(StationSearchModel *parent);
+    
+    void indexRows(int first, int last);
+    
+    bool corpusComplete() const;
+    
+    void search();
+    void searchServer();
+    
+    void _q_onSourceRowsInserted(const QModelIndex &parent, int first, int last);
+    void _q_onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void _q_onSourceDestroyed();
+    void _q_onRequestFinished();
+    
+    StationIndex index;
+    
+    QPointer<StationsModel> source;
+    
+    ResourcesRequest *request;
+    
+    QString query;
+    QString serverQuery;
+    QString requestQuery;
+    
+    int limit;
+    
+    bool serverFallback;
+    
+    QList<double> scores;
+    
+    Q_DECLARE_PUBLIC(StationSearchModel)
+};
+
+}
+
+#endif // CUTERADIO_STATIONSEARCHMODEL_P_H
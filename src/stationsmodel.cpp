@@ -16,6 +16,9 @@
 
 #include "stationsmodel.h"
 #include "resourcesmodel_p.h"
+#include "favourites_p.h"
+#include "playlistresolver_p.h"
+#include "streamprober_p.h"
 
 namespace CuteRadio {
 
@@ -94,7 +97,38 @@ namespace CuteRadio {
             <td>favourite</td>
             <td>Whether the station is in the authenticated user's favourites.</td>
         </tr>
+        <tr>
+            <td>ReachabilityRole</td>
+            <td>reachability</td>
+            <td>Whether the station source is reachable (see StreamProber::Reachability).</td>
+        </tr>
+        <tr>
+            <td>LatencyRole</td>
+            <td>latency</td>
+            <td>The time in milliseconds taken to probe the station source, or -1.</td>
+        </tr>
+        <tr>
+            <td>StreamUrlRole</td>
+            <td>streamUrl</td>
+            <td>The first stream url of the station source, or an empty string if its playlist is not resolved.</td>
+        </tr>
     </table>
+    
+    The genre, country and language properties are interned, so each distinct value is stored once however many 
+    stations share it.
+    
+    Once Favourites have been loaded, the FavouriteRole is taken from the shared set of favourites rather than 
+    from the station data, and changes made with Favourites::setFavourite() are shown immediately.
+    
+    The ReachabilityRole and LatencyRole are taken from the results of StreamProber. When probeSources is true, 
+    the source of each station is probed when either role is first requested, so only stations that are shown are 
+    probed, and the roles change when the result is received.
+    
+    The StreamUrlRole is taken from PlaylistResolver. When prefetchPlaylists is true, the playlist of each 
+    station is requested when its title or stream url is first requested, so the stream url of a station that is 
+    shown is usually known before it is played.
+    
+    \sa Model::setInternedProperties(), Favourites, StreamProber, PlaylistResolver
 */
 StationsModel::StationsModel(QObject *parent) :
     ResourcesModel(parent)
@@ -115,9 +149,93 @@ StationsModel::StationsModel(QObject *parent) :
     d->roles[CreatorIdRole] = "creatorId";
     d->roles[ApprovedRole] = "approved";
     d->roles[FavouriteRole] = "favourite";
+    d->roles[ReachabilityRole] = "reachability";
+    d->roles[LatencyRole] = "latency";
+    d->roles[StreamUrlRole] = "streamUrl";
 #if QT_VERSION < 0x050000
     setRoleNames(d->roles);
 #endif
+    setInternedProperties(QStringList() << "genre" << "country" << "language");
+    
+    FavouritesStore *favourites = FavouritesStore::instance();
+    connect(favourites, SIGNAL(favouriteChanged(QString, bool)), this, SLOT(onFavouriteChanged(QString, bool)));
+    connect(favourites, SIGNAL(favouritesReset()), this, SLOT(onFavouritesReset()));
+}
+
+/*!
+    \property bool StationsModel::probeSources
+    \brief Whether station sources are probed when their reachability is requested.
+    
+    The default value is false, which only shows results of probes that have already been made.
+    
+    \sa StreamProber
+*/
+
+/*!
+    \fn void StationsModel::probeSourcesChanged()
+    \brief Emitted when probeSources changes.
+*/
+bool StationsModel::probeSources() const {
+    Q_D(const ResourcesModel);
+    
+    return d->probeSources;
+}
+
+void StationsModel::setProbeSources(bool enabled) {
+    Q_D(ResourcesModel);
+    
+    if (enabled != d->probeSources) {
+        d->probeSources = enabled;
+        
+        if (enabled) {
+            connect(StreamProbeStore::instance(), SIGNAL(probed(QString, int, int)),
+                    this, SLOT(onSourceProbed(QString)), Qt::UniqueConnection);
+            
+            if (rowCount() > 0) {
+                emit dataChanged(index(0), index(rowCount() - 1));
+            }
+        }
+        
+        emit probeSourcesChanged();
+    }
+}
+
+/*!
+    \property bool StationsModel::prefetchPlaylists
+    \brief Whether station playlists are resolved when the station is shown.
+    
+    The default value is false, which only shows playlists that have already been resolved.
+    
+    \sa PlaylistResolver
+*/
+
+/*!
+    \fn void StationsModel::prefetchPlaylistsChanged()
+    \brief Emitted when prefetchPlaylists changes.
+*/
+bool StationsModel::prefetchPlaylists() const {
+    Q_D(const ResourcesModel);
+    
+    return d->prefetchPlaylists;
+}
+
+void StationsModel::setPrefetchPlaylists(bool enabled) {
+    Q_D(ResourcesModel);
+    
+    if (enabled != d->prefetchPlaylists) {
+        d->prefetchPlaylists = enabled;
+        
+        if (enabled) {
+            connect(PlaylistStore::instance(), SIGNAL(resolved(QString, QStringList)),
+                    this, SLOT(onPlaylistResolved(QString)), Qt::UniqueConnection);
+            
+            if (rowCount() > 0) {
+                emit dataChanged(index(0), index(rowCount() - 1));
+            }
+        }
+        
+        emit prefetchPlaylistsChanged();
+    }
 }
 
 int StationsModel::columnCount(const QModelIndex &) const {
@@ -125,6 +243,12 @@ int StationsModel::columnCount(const QModelIndex &) const {
 }
 
 QVariant StationsModel::data(const QModelIndex &index, int role) const {
+    Q_D(const ResourcesModel);
+    
+    if ((d->prefetchPlaylists) && ((role == TitleRole) || ((role == Qt::DisplayRole) && (index.column() == 0)))) {
+        PlaylistStore::instance()->resolve(ResourcesModel::data(index, SourceRole).toString());
+    }
+    
     if (role == Qt::DisplayRole) {
         switch (index.column()) {
         case 0:
@@ -139,6 +263,50 @@ QVariant StationsModel::data(const QModelIndex &index, int role) const {
             break;
         }
     }
+    else if (role == FavouriteRole) {
+        if (const FavouritesStore *favourites = FavouritesStore::loadedInstance()) {
+            return favourites->contains(ResourcesModel::data(index, IdRole).toString());
+        }
+    }
+    else if ((role == ReachabilityRole) || (role == LatencyRole)) {
+        const QString source = ResourcesModel::data(index, SourceRole).toString();
+        const SourceProbeResult *result = 0;
+        
+        if (d->probeSources) {
+            StreamProbeStore *prober = StreamProbeStore::instance();
+            prober->probe(source);
+            result = prober->result(source);
+        }
+        else if (const StreamProbeStore *prober = StreamProbeStore::existingInstance()) {
+            result = prober->result(source);
+        }
+        
+        if (role == ReachabilityRole) {
+            return result ? result->reachability : int(StreamProber::Unknown);
+        }
+        
+        return result ? result->latency : -1;
+    }
+    else if (role == StreamUrlRole) {
+        const QString source = ResourcesModel::data(index, SourceRole).toString();
+        
+        if (!PlaylistResolver::isPlaylist(source)) {
+            return source;
+        }
+        
+        const ResolvedPlaylist *playlist = 0;
+        
+        if (d->prefetchPlaylists) {
+            PlaylistStore *store = PlaylistStore::instance();
+            store->resolve(source);
+            playlist = store->playlist(source);
+        }
+        else if (const PlaylistStore *store = PlaylistStore::existingInstance()) {
+            playlist = store->playlist(source);
+        }
+        
+        return (playlist) && (!playlist->urls.isEmpty()) ? playlist->urls.first() : QString();
+    }
 
     return ResourcesModel::data(index, role);
 }
@@ -162,4 +330,49 @@ QVariant StationsModel::headerData(int section, Qt::Orientation orientation, int
     return QVariant();
 }
 
+void StationsModel::onFavouriteChanged(const QString &stationId, bool favourite) {
+    Q_D(ResourcesModel);
+    
+    for (int i = 0; i < d->items.size(); i++) {
+        QVariantMap &item = d->items[i];
+        
+        if (item.value("id").toString() == stationId) {
+            item["favourite"] = favourite;
+            const QModelIndex idx = index(i);
+            emit dataChanged(idx, idx);
+        }
+    }
+}
+
+void StationsModel::onSourceProbed(const QString &source) {
+    sourceChanged(source);
+}
+
+void StationsModel::onPlaylistResolved(const QString &source) {
+    sourceChanged(source);
+}
+
+/*!
+    \internal
+    \brief Emits dataChanged() for each station with \a source.
+*/
+void StationsModel::sourceChanged(const QString &source) {
+    Q_D(ResourcesModel);
+    
+    const int count = rowCount();
+    
+    for (int i = 0; i < count; i++) {
+        const QVariant value = d->snapshot.isOpen() ? d->snapshot.value(i, "source") : d->items.at(i).value("source");
+        
+        if (value.toString() == source) {
+            const QModelIndex idx = index(i);
+            emit dataChanged(idx, idx);
+        }
+    }
+}
+
+void StationsModel::onFavouritesReset() {
+    if (rowCount() > 0) {
+        emit dataChanged(index(0), index(rowCount() - 1));
+    }
 }
@@ -25,6 +25,10 @@ class CUTERADIOSHARED_EXPORT StationsModel : public ResourcesModel
 {
     Q_OBJECT
     
+    Q_PROPERTY(bool probeSources READ probeSources WRITE setProbeSources NOTIFY probeSourcesChanged)
+    Q_PROPERTY(bool prefetchPlaylists READ prefetchPlaylists WRITE setPrefetchPlaylists
+               NOTIFY prefetchPlaylistsChanged)
+    
     Q_ENUMS(Roles)
     
 public:
@@ -40,10 +44,19 @@ public:
         LastPlayedRole,
         CreatorIdRole,
         ApprovedRole,
-        FavouriteRole
+        FavouriteRole,
+        ReachabilityRole,
+        LatencyRole,
+        StreamUrlRole
     };
     
     explicit StationsModel(QObject *parent = 0);
+    
+    bool probeSources() const;
+    void setProbeSources(bool enabled);
+    
+    bool prefetchPlaylists() const;
+    void setPrefetchPlaylists(bool enabled);
 
     int columnCount(const QModelIndex &parent = QModelIndex()) const;
     
@@ -51,7 +64,19 @@ public:
 
     QVariant headerData(int section, Qt::Orientation orientation = Qt::Horizontal, int role = Qt::DisplayRole) const;
 
+Q_SIGNALS:
+    void probeSourcesChanged();
+    void prefetchPlaylistsChanged();
+
+private Q_SLOTS:
+    void onFavouriteChanged(const QString &stationId, bool favourite);
+    void onFavouritesReset();
+    void onSourceProbed(const QString &source);
+    void onPlaylistResolved(const QString &source);
+
 private:
+    void sourceChanged(const QString &source);
+    
     Q_DISABLE_COPY(StationsModel);
 };
 
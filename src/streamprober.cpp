@@ -0,0 +1,539 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "streamprober.h"
+#include "streamprober_p.h"
+#include "request_p.h"
+#include <QCoreApplication>
+#include <QMap>
+#include <QTimer>
+#include <QUrl>
+#ifdef CUTERADIO_DEBUG
+#include <QDebug>
+#endif
+
+namespace CuteRadio {
+
+// Expired results are purged when the cache grows beyond this size. If too few have expired, the oldest results 
+// are evicted until the cache is back to PURGED_PROBE_RESULTS, so that eviction is not repeated for every probe.
+static const int MAX_PROBE_RESULTS = 5000;
+static const int PURGED_PROBE_RESULTS = 4000;
+
+/*!
+    \class StreamProber
+    \brief Checks whether station stream sources are reachable.
+    
+    \ingroup requests
+    
+    StreamProber sends a HTTP HEAD request to each stream source and records whether the server responded, and 
+    how long it took. All StreamProber objects share one prober, so its settings and results are shared too.
+    
+    Probes run in the background with a bounded number in progress at once, both in total and for each host, and 
+    a probe that takes longer than timeout is treated as unreachable. Results are cached, so a source is not probed 
+    again until its result expires. Unreachable results expire sooner than reachable ones, so that a station that 
+    was briefly down is checked again. At most 5000 results are kept, and the oldest are dropped first.
+    
+    A server that responds with an error other than 404 (Not Found) is considered reachable, since many stream 
+    servers do not support HEAD requests. Sources that are not HTTP URLs are not probed, and are Unknown.
+    
+    Example usage:
+    
+    \code
+    import QtQuick 1.0
+    import CuteRadio 1.0
+    
+    ListView {
+        model: StationsModel {
+            probeSources: true
+        }
+        delegate: Text {
+            text: title
+            opacity: reachability == StreamProber.Unreachable ? 0.5 : 1
+        }
+    }
+    \endcode
+    
+    \sa StationsModel::probeSources
+*/
+
+/*!
+    \enum StreamProber::Reachability
+    \brief Whether a stream source is reachable.
+    
+    <table>
+        <tr>
+            <th>Value</th>
+            <th>Description</th>
+        </tr>
+        <tr>
+            <td>Unknown</td>
+            <td>The source has not been probed, or cannot be probed.</td>
+        </tr>
+        <tr>
+            <td>Reachable</td>
+            <td>The stream server responded.</td>
+        </tr>
+        <tr>
+            <td>Unreachable</td>
+            <td>The request failed, timed out or the stream was not found.</td>
+        </tr>
+    </table>
+*/
+StreamProber::StreamProber(QObject *parent) :
+    QObject(parent)
+{
+    StreamProbeStore *store = StreamProbeStore::instance();
+    connect(store, SIGNAL(pendingCountChanged(int)), this, SIGNAL(pendingCountChanged(int)));
+    connect(store, SIGNAL(probed(QString, int, int)), this, SIGNAL(probed(QString, int, int)));
+}
+
+/*!
+    \property int StreamProber::maximumConcurrentProbes
+    \brief The maximum number of probes in progress at once.
+    
+    The default value is 8.
+*/
+int StreamProber::maximumConcurrentProbes() const {
+    return StreamProbeStore::instance()->maximumConcurrentProbes;
+}
+
+void StreamProber::setMaximumConcurrentProbes(int maximum) {
+    StreamProbeStore *store = StreamProbeStore::instance();
+    maximum = qMax(1, maximum);
+    
+    if (maximum != store->maximumConcurrentProbes) {
+        store->maximumConcurrentProbes = maximum;
+        store->startProbes();
+        emit maximumConcurrentProbesChanged();
+    }
+}
+
+/*!
+    \property int StreamProber::maximumProbesPerHost
+    \brief The maximum number of probes of the same host in progress at once.
+    
+    The default value is 2.
+*/
+int StreamProber::maximumProbesPerHost() const {
+    return StreamProbeStore::instance()->maximumProbesPerHost;
+}
+
+void StreamProber::setMaximumProbesPerHost(int maximum) {
+    StreamProbeStore *store = StreamProbeStore::instance();
+    maximum = qMax(1, maximum);
+    
+    if (maximum != store->maximumProbesPerHost) {
+        store->maximumProbesPerHost = maximum;
+        store->startProbes();
+        emit maximumProbesPerHostChanged();
+    }
+}
+
+/*!
+    \property int StreamProber::timeout
+    \brief The time in milliseconds after which a probe is canceled and its source is unreachable.
+    
+    The default value is 5000.
+*/
+int StreamProber::timeout() const {
+    return StreamProbeStore::instance()->timeout;
+}
+
+void StreamProber::setTimeout(int timeout) {
+    StreamProbeStore *store = StreamProbeStore::instance();
+    timeout = qMax(1, timeout);
+    
+    if (timeout != store->timeout) {
+        store->timeout = timeout;
+        emit timeoutChanged();
+    }
+}
+
+/*!
+    \property int StreamProber::reachableCacheTime
+    \brief The time in milliseconds for which a reachable result is cached.
+    
+    The default value is 600000 (10 minutes).
+*/
+int StreamProber::reachableCacheTime() const {
+    return StreamProbeStore::instance()->reachableCacheTime;
+}
+
+void StreamProber::setReachableCacheTime(int time) {
+    StreamProbeStore *store = StreamProbeStore::instance();
+    time = qMax(0, time);
+    
+    if (time != store->reachableCacheTime) {
+        store->reachableCacheTime = time;
+        emit reachableCacheTimeChanged();
+    }
+}
+
+/*!
+    \property int StreamProber::unreachableCacheTime
+    \brief The time in milliseconds for which an unreachable result is cached.
+    
+    The default value is 120000 (2 minutes).
+*/
+int StreamProber::unreachableCacheTime() const {
+    return StreamProbeStore::instance()->unreachableCacheTime;
+}
+
+void StreamProber::setUnreachableCacheTime(int time) {
+    StreamProbeStore *store = StreamProbeStore::instance();
+    time = qMax(0, time);
+    
+    if (time != store->unreachableCacheTime) {
+        store->unreachableCacheTime = time;
+        emit unreachableCacheTimeChanged();
+    }
+}
+
+/*!
+    \property int StreamProber::pendingCount
+    \brief The number of sources that are queued or being probed.
+*/
+int StreamProber::pendingCount() const {
+    return StreamProbeStore::instance()->pendingCount();
+}
+
+/*!
+    \brief Returns the cached reachability of \a source.
+    
+    Expired results are still returned until the source is probed again.
+*/
+int StreamProber::reachability(const QString &source) const {
+    const SourceProbeResult *result = StreamProbeStore::instance()->result(source);
+    return result ? result->reachability : int(Unknown);
+}
+
+/*!
+    \brief Returns the time in milliseconds taken to probe \a source, or -1 if it is not reachable.
+*/
+int StreamProber::latency(const QString &source) const {
+    const SourceProbeResult *result = StreamProbeStore::instance()->result(source);
+    return result ? result->latency : -1;
+}
+
+/*!
+    \brief Probes \a source in the background, unless it is already queued or has an unexpired result.
+    
+    \sa probed()
+*/
+void StreamProber::probe(const QString &source) {
+    StreamProbeStore::instance()->probe(source);
+}
+
+/*!
+    \brief Cancels all queued and active probes.
+*/
+void StreamProber::cancel() {
+    StreamProbeStore::instance()->cancel();
+}
+
+/*!
+    \brief Removes all cached results.
+*/
+void StreamProber::clearCache() {
+    StreamProbeStore::instance()->clearCache();
+}
+
+/*!
+    \fn void StreamProber::probed(const QString &source, int reachability, int latency)
+    \brief Emitted when \a source has been probed.
+*/
+
+SourceProbe::SourceProbe(QObject *parent) :
+    Request(parent),
+    timer(new QTimer(this)),
+    timedOut(false)
+{
+    Q_D(Request);
+    
+    // A probe tests one url, so it must not be sent to another EndpointSelector endpoint. It is not queued by the 
+    // RateLimiter, since time spent waiting would count against its timeout and latency.
+    d->failover = false;
+    d->rateLimited = false;
+    setEngineMode(DirectEngine);
+    timer->setSingleShot(true);
+}
+
+/*!
+    \internal
+    \brief Sends a HEAD request to \a source, canceling it after \a timeout milliseconds.
+*/
+void SourceProbe::start(const QString &source, int timeout) {
+    this->source = source;
+    timedOut = false;
+    setUrl(QUrl(source));
+    elapsed.start();
+    timer->start(timeout);
+    head(false);
+}
+
+StreamProbeStore* StreamProbeStore::self = 0;
+
+StreamProbeStore::StreamProbeStore() :
+    QObject(QCoreApplication::instance()),
+    maximumConcurrentProbes(8),
+    maximumProbesPerHost(2),
+    timeout(5000),
+    reachableCacheTime(600000),
+    unreachableCacheTime(120000),
+    startQueued(false)
+{
+    clock.start();
+}
+
+StreamProbeStore::~StreamProbeStore() {
+    if (self == this) {
+        self = 0;
+    }
+}
+
+/*!
+    \internal
+    \brief Returns the prober, creating it if required.
+    
+    The prober is owned by the application object.
+*/
+StreamProbeStore* StreamProbeStore::instance() {
+    if (!self) {
+        self = new StreamProbeStore;
+    }
+    
+    return self;
+}
+
+/*!
+    \internal
+    \brief Returns the prober if it exists, otherwise 0.
+*/
+StreamProbeStore* StreamProbeStore::existingInstance() {
+    return self;
+}
+
+/*!
+    \internal
+    \brief Returns the cached result for \a source, or 0 if there is none.
+*/
+const SourceProbeResult* StreamProbeStore::result(const QString &source) const {
+    QHash<QString, SourceProbeResult>::const_iterator iterator = results.constFind(source);
+    return iterator != results.constEnd() ? &iterator.value() : 0;
+}
+
+int StreamProbeStore::pendingCount() const {
+    return pending.size();
+}
+
+/*!
+    \internal
+    \brief Queues \a source to be probed, unless it is already pending or has an unexpired result.
+    
+    Probes are started from the event loop, so this is safe to call while a model is returning data.
+*/
+void StreamProbeStore::probe(const QString &source) {
+    if ((source.isEmpty()) || (pending.contains(source))) {
+        return;
+    }
+    
+    const SourceProbeResult *r = result(source);
+    
+    if ((r) && (r->expires > clock.elapsed())) {
+        return;
+    }
+    
+    const QString scheme = QUrl(source).scheme().toLower();
+    
+    if ((scheme != "http") && (scheme != "https")) {
+        insertResult(source, StreamProber::Unknown, -1);
+        return;
+    }
+    
+    queue << source;
+    pending.insert(source);
+    emit pendingCountChanged(pending.size());
+    
+    if (!startQueued) {
+        startQueued = true;
+        QMetaObject::invokeMethod(this, "startProbes", Qt::QueuedConnection);
+    }
+}
+
+void StreamProbeStore::cancel() {
+    queue.clear();
+    pending.clear();
+    hostProbes.clear();
+    
+    foreach (SourceProbe *p, probes) {
+        p->disconnect(this);
+        p->cancel();
+        p->deleteLater();
+    }
+    
+    probes.clear();
+    emit pendingCountChanged(0);
+}
+
+void StreamProbeStore::clearCache() {
+    results.clear();
+}
+
+/*!
+    \internal
+    \brief Starts queued probes until a limit is reached.
+    
+    Sources whose host is at its limit are skipped, and stay at the front of the queue.
+*/
+void StreamProbeStore::startProbes() {
+    startQueued = false;
+    int i = 0;
+    
+    while ((probes.size() < maximumConcurrentProbes) && (i < queue.size())) {
+        const QString host = QUrl(queue.at(i)).host().toLower();
+        const int active = hostProbes.value(host);
+        
+        if (active >= maximumProbesPerHost) {
+            i++;
+            continue;
+        }
+        
+        SourceProbe *p = new SourceProbe(this);
+        p->host = host;
+        connect(p, SIGNAL(finished(CuteRadio::Request*)), this, SLOT(onProbeFinished(CuteRadio::Request*)));
+        connect(p->timer, SIGNAL(timeout()), this, SLOT(onProbeTimeout()));
+        hostProbes[host] = active + 1;
+        probes << p;
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::StreamProbeStore::startProbes" << queue.at(i);
+#endif
+        p->start(queue.takeAt(i), timeout);
+    }
+}
+
+void StreamProbeStore::onProbeFinished(Request *request) {
+    SourceProbe *p = static_cast<SourceProbe*>(request);
+    const int latency = int(p->elapsed.elapsed());
+    
+    if (p->status() == Request::Ready) {
+        finish(p, StreamProber::Reachable, latency);
+        return;
+    }
+    
+    if ((p->timedOut) || (p->status() == Request::Canceled)) {
+        finish(p, StreamProber::Unreachable, -1);
+        return;
+    }
+    
+    switch (p->error()) {
+    case Request::ContentNotFoundError:
+        finish(p, StreamProber::Unreachable, -1);
+        break;
+    case Request::ContentAccessDenied:
+    case Request::ContentOperationNotPermittedError:
+    case Request::AuthenticationRequiredError:
+    case Request::ContentReSendError:
+    case Request::UnknownContentError:
+    case Request::ProtocolInvalidOperationError:
+    case Request::ProtocolFailure:
+        // The server responded, even if it does not allow HEAD requests.
+        finish(p, StreamProber::Reachable, latency);
+        break;
+    case Request::ProtocolUnknownError:
+        finish(p, StreamProber::Unknown, -1);
+        break;
+    default:
+        finish(p, StreamProber::Unreachable, -1);
+        break;
+    }
+}
+
+void StreamProbeStore::onProbeTimeout() {
+    if (QTimer *timer = qobject_cast<QTimer*>(sender())) {
+        SourceProbe *p = static_cast<SourceProbe*>(timer->parent());
+#ifdef CUTERADIO_DEBUG
+        qDebug() << "CuteRadio::StreamProbeStore::onProbeTimeout" << p->source;
+#endif
+        p->timedOut = true;
+        p->cancel();
+    }
+}
+
+void StreamProbeStore::finish(SourceProbe *probe, int reachability, int latency) {
+    probe->timer->stop();
+    probe->disconnect(this);
+    probe->deleteLater();
+    probes.removeOne(probe);
+    
+    const int active = hostProbes.value(probe->host) - 1;
+    
+    if (active > 0) {
+        hostProbes[probe->host] = active;
+    }
+    else {
+        hostProbes.remove(probe->host);
+    }
+    
+    pending.remove(probe->source);
+    insertResult(probe->source, reachability, latency);
+    emit probed(probe->source, reachability, latency);
+    emit pendingCountChanged(pending.size());
+    startProbes();
+}
+
+void StreamProbeStore::insertResult(const QString &source, int reachability, int latency) {
+    if ((results.size() >= MAX_PROBE_RESULTS) && (!results.contains(source))) {
+        const qint64 now = clock.elapsed();
+        QMutableHashIterator<QString, SourceProbeResult> iterator(results);
+        
+        while (iterator.hasNext()) {
+            if (iterator.next().value().expires <= now) {
+                iterator.remove();
+            }
+        }
+        
+        if (results.size() >= MAX_PROBE_RESULTS) {
+            QMap<qint64, QString> oldest;
+            QHashIterator<QString, SourceProbeResult> resultIterator(results);
+            
+            while (resultIterator.hasNext()) {
+                resultIterator.next();
+                oldest.insertMulti(resultIterator.value().probed, resultIterator.key());
+            }
+            
+            QMapIterator<qint64, QString> oldestIterator(oldest);
+            
+            while ((results.size() > PURGED_PROBE_RESULTS) && (oldestIterator.hasNext())) {
+                results.remove(oldestIterator.next().value());
+            }
+        }
+    }
+    
+    SourceProbeResult &result = results[source];
+    result.reachability = reachability;
+    result.latency = latency;
+    result.probed = clock.elapsed();
+    result.expires = result.probed + (reachability == StreamProber::Unreachable ? unreachableCacheTime
+                                                                                  : reachableCacheTime);
+#ifdef CUTERADIO_DEBUG
+    qDebug() << "CuteRadio::StreamProbeStore::insertResult" << source << reachability << latency;
+#endif
+}
+
+}
+
+#include "moc_streamprober.cpp"
+#include "moc_streamprober_p.cpp"
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_STREAMPROBER_H
+#define CUTERADIO_STREAMPROBER_H
+
+#include "cuteradio_global.h"
+#include <QObject>
+
+namespace CuteRadio {
+
+class CUTERADIOSHARED_EXPORT StreamProber : public QObject
+{
+    Q_OBJECT
+    
+    Q_PROPERTY(int maximumConcurrentProbes READ maximumConcurrentProbes WRITE setMaximumConcurrentProbes
+               NOTIFY maximumConcurrentProbesChanged)
+    Q_PROPERTY(int maximumProbesPerHost READ maximumProbesPerHost WRITE setMaximumProbesPerHost
+               NOTIFY maximumProbesPerHostChanged)
+    Q_PROPERTY(int timeout READ timeout WRITE setTimeout NOTIFY timeoutChanged)
+    Q_PROPERTY(int reachableCacheTime READ reachableCacheTime WRITE setReachableCacheTime
+               NOTIFY reachableCacheTimeChanged)
+    Q_PROPERTY(int unreachableCacheTime READ unreachableCacheTime WRITE setUnreachableCacheTime
+               NOTIFY unreachableCacheTimeChanged)
+    Q_PROPERTY(int pendingCount READ pendingCount NOTIFY pendingCountChanged)
+    
+    Q_ENUMS(Reachability)
+    
+public:
+    enum Reachability {
+        Unknown = 0,
+        Reachable,
+        Unreachable
+    };
+    
+    explicit StreamProber(QObject *parent = 0);
+    
+    int maximumConcurrentProbes() const;
+    void setMaximumConcurrentProbes(int maximum);
+    
+    int maximumProbesPerHost() const;
+    void setMaximumProbesPerHost(int maximum);
+    
+    int timeout() const;
+    void setTimeout(int timeout);
+    
+    int reachableCacheTime() const;
+    void setReachableCacheTime(int time);
+    
+    int unreachableCacheTime() const;
+    void setUnreachableCacheTime(int time);
+    
+    int pendingCount() const;
+    
+    Q_INVOKABLE int reachability(const QString &source) const;
+    Q_INVOKABLE int latency(const QString &source) const;
+    
+public Q_SLOTS:
+    void probe(const QString &source);
+    void cancel();
+    void clearCache();
+    
+Q_SIGNALS:
+    void maximumConcurrentProbesChanged();
+    void maximumProbesPerHostChanged();
+    void timeoutChanged();
+    void reachableCacheTimeChanged();
+    void unreachableCacheTimeChanged();
+    void pendingCountChanged(int count);
+    void probed(const QString &source, int reachability, int latency);
+    
+private:
+    Q_DISABLE_COPY(StreamProber)
+};
+
+}
+
+#endif // CUTERADIO_STREAMPROBER_H
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUTERADIO_STREAMPROBER_P_H
+#define CUTERADIO_STREAMPROBER_P_H
+
+#include "streamprober.h"
+#include "request.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+class QTimer;
+
+namespace CuteRadio {
+
+/*!
+    \internal
+    \brief A HEAD request for one stream source.
+*/
+class SourceProbe : public Request
+{
+
+public:
+    explicit SourceProbe(QObject *parent = 0);
+    
+    void start(const QString &source, int timeout);
+    
+    QString source;
+    QString host;
+    
+    QElapsedTimer elapsed;
+    
+    QTimer *timer;
+    
+    bool timedOut;
+};
+
+/*!
+    \internal
+    \brief The cached result of probing a stream source.
+*/
+class SourceProbeResult
+{
+
+public:
+    int reachability;
+    int latency;
+    qint64 probed;
+    qint64 expires;
+};
+
+/*!
+    \internal
+    \brief The process-wide prober shared by every StreamProber and StationsModel.
+    
+    Sources are probed in the order they are requested, with at most maximumConcurrentProbes in progress, and at 
+    most maximumProbesPerHost in progress for any one host. Results, including failures, are cached until they 
+    expire, and a source is not probed again while it has an unexpired result.
+*/
+class StreamProbeStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static StreamProbeStore* instance();
+    static StreamProbeStore* existingInstance();
+    
+    ~StreamProbeStore();
+    
+    const SourceProbeResult* result(const QString &source) const;
+    
+    int pendingCount() const;
+    
+    void probe(const QString &source);
+    void cancel();
+    void clearCache();
+    
+    int maximumConcurrentProbes;
+    int maximumProbesPerHost;
+    int timeout;
+    int reachableCacheTime;
+    int unreachableCacheTime;
+    
+    QHash<QString, SourceProbeResult> results;
+    
+    QStringList queue;
+    QSet<QString> pending;
+    
+    QList<SourceProbe*> probes;
+    QHash<QString, int> hostProbes;
+    
+    QElapsedTimer clock;
+    
+    bool startQueued;
+
+Q_SIGNALS:
+    void pendingCountChanged(int count);
+    void probed(const QString &source, int reachability, int latency);
+
+public Q_SLOTS:
+    void startProbes();
+
+private Q_SLOTS:
+    void onProbeFinished(CuteRadio::Request *request);
+    void onProbeTimeout();
+
+private:
+    StreamProbeStore();
+    
+    void finish(SourceProbe *probe, int reachability, int latency);
+    void insertResult(const QString &source, int reachability, int latency);
+    
+    static StreamProbeStore *self;
+};
+
+}
+
+#endif // CUTERADIO_STREAMPROBER_P_H
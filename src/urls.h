@@ -21,6 +21,7 @@
 
 namespace CuteRadio {
 
+// The default API endpoint. Requests are sent to the endpoint selected by EndpointSelector.
 static const QString API_URL("http://marxoft.co.uk/api/cuteradio");
 
 static const QString COUNTRIES_URL(API_URL + "/countries");
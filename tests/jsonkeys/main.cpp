@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "json.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QDebug>
+
+using namespace QtJson;
+
+// Approximate heap size of a QString: allocation header plus UTF-16 data and terminator.
+static qint64 stringBytes(const QString &s) {
+    return 24 + (s.size() + 1) * 2;
+}
+
+// Returns the heap bytes used by the distinct key strings of all items in a parsed page.
+static qint64 keyBytes(const QVariant &page, int *copies) {
+    QSet<const QChar*> seen;
+    qint64 bytes = 0;
+    
+    foreach (const QVariant &item, page.toMap().value("items").toList()) {
+        const QVariantMap map = item.toMap();
+        QMapIterator<QString, QVariant> iterator(map);
+        
+        while (iterator.hasNext()) {
+            iterator.next();
+            
+            if (!seen.contains(iterator.key().constData())) {
+                seen.insert(iterator.key().constData());
+                bytes += stringBytes(iterator.key());
+            }
+        }
+    }
+    
+    *copies = seen.size();
+    return bytes;
+}
+
+// Returns the milliseconds taken to parse json the given number of times, with or without interning.
+static qint64 parseTime(const QString &json, int runs, bool interned) {
+    bool ok = true;
+    QElapsedTimer timer;
+    timer.start();
+    
+    for (int i = 0; i < runs; i++) {
+        if (interned) {
+            Json::parse(json, ok);
+        }
+        else {
+            Json::parse(json, ok, 0);
+        }
+    }
+    
+    return timer.elapsed();
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    
+    QStringList args = app.arguments();
+    args.removeFirst();
+    const int stations = args.isEmpty() ? 1000 : qMax(1, args.first().toInt());
+    
+    QVariantList items;
+    
+    for (int i = 0; i < stations; i++) {
+        QVariantMap station;
+        station["id"] = i;
+        station["title"] = QString("Station %1").arg(i);
+        station["description"] = QString("Description of station %1").arg(i);
+        station["genre"] = "Rock";
+        station["country"] = "UK";
+        station["language"] = "English";
+        station["source"] = QString("http://example.com/%1.m3u").arg(i);
+        station["playCount"] = i * 3;
+        station["lastPlayed"] = "2015-01-01T00:00:00Z";
+        station["creatorId"] = 1;
+        station["approved"] = true;
+        station["favourite"] = false;
+        station["lastModified"] = "2015-01-01T00:00:00Z";
+        items << station;
+    }
+    
+    QVariantMap page;
+    page["items"] = items;
+    const QString json = QString::fromUtf8(Json::serialize(page));
+    
+    bool ok = true;
+    int plainCopies = 0;
+    int internedCopies = 0;
+    const qint64 plain = keyBytes(Json::parse(json, ok, 0), &plainCopies);
+    const qint64 interned = keyBytes(Json::parse(json, ok), &internedCopies);
+    
+    qDebug() << "Stations:" << stations;
+    qDebug() << "Without interning:" << plainCopies << "key strings," << plain << "bytes";
+    qDebug() << "With interning:" << internedCopies << "key strings," << interned << "bytes";
+    qDebug() << "Saved:" << plain - interned << "bytes";
+    
+    const int runs = 20;
+    qDebug() << "Parse time for" << runs << "runs without interning:" << parseTime(json, runs, false) << "ms";
+    qDebug() << "Parse time for" << runs << "runs with interning:" << parseTime(json, runs, true) << "ms";
+    
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "request_p.h"
+#include "urls.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QDebug>
+
+using namespace CuteRadio;
+
+static void addQuery(QUrl *u, const QVariantMap &filters) {
+#if QT_VERSION >= 0x050000
+    QUrlQuery query(*u);
+    addUrlQueryItems(&query, filters);
+    u->setQuery(query);
+#else
+    addUrlQueryItems(u, filters);
+#endif
+}
+
+// The way requests were built before templates: url, auth header and headers are resolved on every call.
+static QNetworkRequest buildUncached(const QString &resourcePath, const QVariantMap &filters,
+                                     const QString &accessToken, const QVariantMap &headers) {
+    QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
+                            .arg(resourcePath));
+    addQuery(&u, filters);
+    QNetworkRequest request(u);
+    request.setRawHeader("Authorization", "Basic " + QByteArray(accessToken.toUtf8() + ":").toBase64());
+    addRequestHeaders(&request, headers);
+    return request;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    
+    QStringList args = app.arguments();
+    args.removeFirst();
+    const int iterations = args.isEmpty() ? 100000 : qMax(1, args.first().toInt());
+    
+    const QString resourcePath("/stations");
+    const QString accessToken("0123456789abcdef0123456789abcdef");
+    QVariantMap filters;
+    filters["limit"] = 20;
+    filters["genre"] = "Rock";
+    QVariantMap headers;
+    headers["X-Client"] = "libcuteradio";
+    headers["X-Client-Version"] = 1;
+    
+    QElapsedTimer timer;
+    int valid = 0;
+    
+    timer.start();
+    
+    for (int i = 0; i < iterations; i++) {
+        valid += buildUncached(resourcePath, filters, accessToken, headers).url().isValid();
+    }
+    
+    const qint64 uncached = qMax(qint64(1), timer.elapsed());
+    
+    timer.restart();
+    const QUrl base(API_URL + resourcePath);
+    const RequestTemplate requestTemplate(accessToken, headers);
+    
+    for (int i = 0; i < iterations; i++) {
+        QUrl u(base);
+        addQuery(&u, filters);
+        valid += requestTemplate.request(u).url().isValid();
+    }
+    
+    const qint64 templated = qMax(qint64(1), timer.elapsed());
+    
+    qDebug() << "Built" << valid << "requests";
+    qDebug() << "Uncached:" << iterations * qint64(1000) / uncached << "requests/s";
+    qDebug() << "Template:" << iterations * qint64(1000) / templated << "requests/s";
+    
+    return 0;
+}
@@ -0,0 +1,14 @@
+TEMPLATE = app
+TARGET = requesttemplates
+INSTALLS += target
+
+QT += network
+QT -= gui
+
+INCLUDEPATH += ../../src
+LIBS += -L../../lib -lcuteradio
+SOURCES += main.cpp
+
+unix {
+    target.path = /opt/libcuteradio/bin
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resourcesmodel.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QDebug>
+
+using namespace CuteRadio;
+
+static const int STATION_COUNT = 50000;
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    
+    const QString path = QDir::tempPath() + "/cuteradio-snapshot-test";
+    const QStringList genres = QStringList() << "Rock" << "Jazz" << "News" << "Talk" << "Dance" << "Metal";
+    const QStringList countries = QStringList() << "UK" << "USA" << "France" << "Germany" << "Brazil";
+    
+    {
+        QFile::remove(path);
+        ResourcesModel model;
+        model.setSnapshotPath(path);
+        
+        for (int i = 0; i < STATION_COUNT; i++) {
+            QVariantMap station;
+            station["id"] = QString::number(i);
+            station["title"] = QString("Station %1").arg(i);
+            station["description"] = QString("The best %1 around").arg(genres.at(i % genres.size()));
+            station["genre"] = genres.at(i % genres.size());
+            station["country"] = countries.at(i % countries.size());
+            station["playCount"] = i * 3;
+            station["approved"] = (i % 2) == 0;
+            station["tags"] = QStringList() << genres.at(i % genres.size()) << countries.at(i % countries.size());
+            model.append(station);
+        }
+        
+        QElapsedTimer timer;
+        timer.start();
+        const bool saved = model.saveSnapshot();
+        qDebug() << "Saved" << saved << model.rowCount() << "rows in" << timer.elapsed() << "ms";
+    }
+    
+    QElapsedTimer timer;
+    timer.start();
+    ResourcesModel model;
+    model.setSnapshotPath(path);
+    const int count = model.rowCount();
+    const QVariantMap first = model.get(0);
+    const QVariantMap last = model.get(count - 1);
+    qDebug() << "Restored" << count << "rows in" << timer.nsecsElapsed() / 1000 << "us";
+    qDebug() << first;
+    qDebug() << last;
+    
+    timer.restart();
+    
+    for (int i = 0; i < count; i++) {
+        model.data(model.index(i), Qt::UserRole + 1);
+    }
+    
+    qDebug() << "Read one role of every row in" << timer.elapsed() << "ms";
+    
+    model.clear();
+    qDebug() << "Rows after clear" << model.rowCount();
+    
+    QFile::remove(path);
+    
+    return 0;
+}
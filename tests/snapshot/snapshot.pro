@@ -0,0 +1,13 @@
+TEMPLATE = app
+TARGET = snapshot
+INSTALLS += target
+
+QT -= gui
+
+INCLUDEPATH += ../../src
+LIBS += -L../../lib -lcuteradio
+SOURCES += main.cpp
+
+unix {
+    target.path = /opt/libcuteradio/bin
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resourcesmodel.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QStringList>
+#include <QDebug>
+
+using namespace CuteRadio;
+
+static const int STATION_COUNT = 20000;
+
+static void sort(ResourcesModel &model, const QString &property, Qt::SortOrder order) {
+    QElapsedTimer timer;
+    timer.start();
+    
+    if (!model.sortItems(property, order)) {
+        qDebug() << "Cannot sort by" << property;
+        return;
+    }
+    
+    if (model.isSorting()) {
+        QEventLoop loop;
+        QObject::connect(&model, SIGNAL(sortingChanged()), &loop, SLOT(quit()));
+        loop.exec();
+    }
+    
+    qDebug() << "Sorted by" << property << (order == Qt::AscendingOrder ? "ascending" : "descending") << "in"
+             << timer.elapsed() << "ms:" << model.get(0).value(property).toString() << "..."
+             << model.get(model.rowCount() - 1).value(property).toString();
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    
+    const QStringList words = QStringList() << "Rock" << "jazz" << "Classic" << "news" << "electro" << "dance";
+    const QDateTime start = QDateTime::currentDateTime();
+    ResourcesModel model;
+    
+    for (int i = 0; i < STATION_COUNT; i++) {
+        QVariantMap station;
+        station["id"] = QString::number(i);
+        station["title"] = QString("%1 %2").arg(words.at((i * 7) % words.size())).arg((i * 7919) % STATION_COUNT);
+        station["playCount"] = (i * 31) % 1000;
+        
+        if (i % 10) {
+            station["lastPlayed"] = start.addSecs(-((i * 104729) % 100000)).toString(Qt::ISODate);
+        }
+        
+        model.append(station);
+    }
+    
+    sort(model, "title", Qt::AscendingOrder);
+    sort(model, "playCount", Qt::DescendingOrder);
+    sort(model, "lastPlayed", Qt::DescendingOrder);
+    
+    return 0;
+}
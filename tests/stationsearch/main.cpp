@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stationsearchmodel.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QDebug>
+
+using namespace CuteRadio;
+
+static const int STATION_COUNT = 20000;
+
+// Builds a synthetic catalog of stations with a mix of repeated words.
+static QVariantList stations() {
+    const QStringList words = QStringList() << "rock" << "jazz" << "classic" << "news" << "talk" << "dance"
+                                            << "radio" << "hits" << "country" << "metal" << "blues" << "indie";
+    const QStringList countries = QStringList() << "UK" << "USA" << "France" << "Germany" << "Brazil";
+    const QStringList languages = QStringList() << "English" << "French" << "German" << "Portuguese";
+    QVariantList list;
+    
+    for (int i = 0; i < STATION_COUNT; i++) {
+        QVariantMap station;
+        station["id"] = QString::number(i);
+        station["title"] = QString("%1 %2 FM %3").arg(words.at(i % words.size()))
+                                                  .arg(words.at((i / 7) % words.size())).arg(i);
+        station["description"] = QString("The best %1 around").arg(words.at((i / 3) % words.size()));
+        station["genre"] = words.at((i / 5) % words.size());
+        station["country"] = countries.at(i % countries.size());
+        station["language"] = languages.at(i % languages.size());
+        list << station;
+    }
+    
+    return list;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    
+    StationSearchModel model;
+    model.setServerFallback(false);
+    
+    QElapsedTimer timer;
+    timer.start();
+    model.addStations(stations());
+    qDebug() << "Indexed" << model.stationCount() << "stations in" << timer.elapsed() << "ms";
+    
+    const QStringList queries = QStringList() << "rock" << "jazz fm" << "clas" << "blues uk" << "FRANCE"
+                                              << "metal hits 1999" << "nothing";
+    
+    foreach (const QString &query, queries) {
+        timer.restart();
+        model.setQuery(query);
+        const qint64 elapsed = timer.nsecsElapsed() / 1000;
+        
+        qDebug() << query << ":" << model.rowCount() << "results in" << elapsed << "us"
+                 << (model.rowCount() > 0 ? model.get(0).value("title").toString() : QString());
+    }
+    
+    return 0;
+}
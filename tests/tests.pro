@@ -2,6 +2,11 @@ TEMPLATE = subdirs
 SUBDIRS += \
     countries \
     genres \
+    jsonkeys \
     languages \
+    requesttemplates \
     resources \
-    stations
+    snapshot \
+    sort \
+    stations \
+    stationsearch